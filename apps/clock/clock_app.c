@@ -1,6 +1,8 @@
 #include <stdint.h>
+#include <sys/time.h>
 #include <time.h>
 #include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
 #include "canvas.h"
 #include "app_manager.h"
 #include "framebuffer.h"
@@ -8,7 +10,10 @@
 #include "fonts.h"
 
 #define FADE_ANIM_DURATION  300
-#define FADE_ANIM_DELAY     20
+
+// Until SNTP sets the clock it's checked every second, so the synced time shows up quickly
+#define UNSYNCED_TICK_US    1000000
+#define MIN_SYNCED_YEAR     (2024 - 1900)
 
 enum clock_style {
     STYLE_SMALL = 0,
@@ -18,6 +23,16 @@ enum clock_style {
 uint8_t start_x_sm, start_y_sm;
 uint8_t start_x_lg, start_y_lg;
 
+static const crgb color = {255, 255, 255};
+
+struct clock_state {
+    struct tm timeinfo;     // Shown time
+    uint8_t style;
+};
+
+// Kept over hibernation
+static uint8_t saved_style = STYLE_SMALL;
+
 static void draw_clock(struct canvas *cv, struct tm *tm, uint8_t style, crgb color)
 {
     switch (style) {
@@ -47,18 +62,17 @@ static void draw_clock(struct canvas *cv, struct tm *tm, uint8_t style, crgb col
                            start_x_lg + 2 + digits_7x7_font.width, start_y_lg + 2 + digits_7x7_font.height, color);
             break;
     }
-
-    am_send_msg(AM_MSG_REFRESH);
 }
 
-void clock_ui_task(void *param)
+static uint8_t clock_init(struct canvas *cv, void **state)
 {
-    struct canvas *cv = (struct canvas *)param;
-
+    struct clock_state *s = pvPortMalloc(sizeof(struct clock_state));
+    if (s == NULL)
+        return 1;
     time_t now;
-    struct tm timeinfo, prev_timeinfo;
     time(&now);
-    localtime_r(&now, &timeinfo);
+    localtime_r(&now, &s->timeinfo);
+    s->style = saved_style;
 
     // Small style
     // 4 digits, 2 spaces (1 pixel each), 1 space between hours and minutes (2 pixels)
@@ -69,34 +83,60 @@ void clock_ui_task(void *param)
     start_x_lg = (cv->width - (digits_7x7_font.width * 2 + 2)) / 2;
     start_y_lg = (cv->height - (digits_7x7_font.height * 2 + 2)) / 2;
 
-    const crgb color = {255, 255, 255};
-    uint8_t style = STYLE_SMALL;
-
-    draw_clock(cv, &timeinfo, style, color);
-
-    while (1) {
-        time(&now);
-        localtime_r(&now, &timeinfo);
-
-        if (timeinfo.tm_hour != prev_timeinfo.tm_hour ||
-            timeinfo.tm_min != prev_timeinfo.tm_min) {
-            draw_clock(cv, &timeinfo, style, color);
-        }
-        prev_timeinfo = timeinfo;
-
-        // Process input events
-        uint32_t message;
-        if (xTaskNotifyWait(pdFALSE, ULONG_MAX, &message, pdMS_TO_TICKS(1000)) == pdFALSE)
-            continue;
-
-        if (message == EVENT_BTN_CLICK) {
-            // Switch clock style
-            style = !style;
-            anim_fade_out(cv, FADE_ANIM_DURATION, FADE_ANIM_DELAY);
-            struct canvas *temp_cv = cv_copy(cv);
-            draw_clock(temp_cv, &timeinfo, style, color);
-            anim_fade_in(cv, temp_cv, FADE_ANIM_DURATION, FADE_ANIM_DELAY);
-            cv_free(temp_cv);
-        }
-    }
+    *state = s;
+    return 0;
+}
+
+static bool clock_on_event(void *state, struct canvas *cv, const struct app_event *event)
+{
+    struct clock_state *s = state;
+    if (event->type != EVENT_CLICK)
+        return false;
+    // Switch clock style
+    s->style = !s->style;
+    anim_crossfade(cv, FADE_ANIM_DURATION, ANIM_EASE_IN_OUT);
+    cv_blank(cv);
+    return true;
+}
+
+static bool clock_on_tick(void *state, struct canvas *cv)
+{
+    struct clock_state *s = state;
+    struct timeval tv;
+    struct tm timeinfo;
+    gettimeofday(&tv, NULL);
+    localtime_r(&tv.tv_sec, &timeinfo);
+
+    // Shown minutes change only at the start of the next one
+    int64_t now_us = esp_timer_get_time();
+    if (timeinfo.tm_year < MIN_SYNCED_YEAR)
+        am_tick_at(now_us + UNSYNCED_TICK_US);
+    else
+        am_tick_at(now_us + (60 - timeinfo.tm_sec) * 1000000LL - tv.tv_usec);
+
+    bool changed = timeinfo.tm_hour != s->timeinfo.tm_hour || timeinfo.tm_min != s->timeinfo.tm_min;
+    s->timeinfo = timeinfo;
+    return changed;
+}
+
+static void clock_on_draw(void *state, struct canvas *cv)
+{
+    struct clock_state *s = state;
+    draw_clock(cv, &s->timeinfo, s->style, color);
+}
+
+static void clock_on_hibernate(void *state)
+{
+    struct clock_state *s = state;
+    saved_style = s->style;
+    vPortFree(s);
 }
+
+const struct am_app_ops clock_app_ops = {
+    .init = clock_init,
+    .on_event = clock_on_event,
+    .on_tick = clock_on_tick,
+    .on_draw = clock_on_draw,
+    .on_hibernate = clock_on_hibernate,
+    .tick_ms = AM_TICK_ON_CHANGE
+};
@@ -1 +1,3 @@
-void clock_ui_task(void *param);
+#include "app_manager.h"
+
+extern const struct am_app_ops clock_app_ops;
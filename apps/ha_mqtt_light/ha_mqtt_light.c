@@ -14,11 +14,11 @@
 
 #define MQTT_DISCOVERY_TOPIC    CONFIG_HA_LIGHT_DISCOVERY_PREFIX "/device/%s/config"
 
-#define UI_MSG_TOGGLE   0x8
-#define UI_MSG_UPDATE   0x10
+// Messages of EVENT_APP
+#define UI_MSG_TOGGLE   1
+#define UI_MSG_UPDATE   2
 
 #define FADE_ANIM_DURATION  300
-#define FADE_ANIM_DELAY     20
 
 enum mqtt_topic_type {
     STATUS_TOPIC_MAIN = 0,
@@ -81,7 +81,7 @@ static struct {
     crgb color;
 } cur_params = { false, 255, { 255, 255, 255 } };
 
-static TaskHandle_t ui_task_handle;
+static int8_t app_id = -1;
 
 static int8_t publish_main_state(struct mqtt_client *client)
 {
@@ -126,7 +126,7 @@ static void switch_handler(struct mqtt_client *client, char *topic, char *data)
     bool state = (strcmp(data, "ON") == 0) ? true : false;
     if (state != cur_params.state) {
         cur_params.state = state;
-        xTaskNotify(ui_task_handle, UI_MSG_TOGGLE, eSetBits);
+        am_post_event(app_id, UI_MSG_TOGGLE);
     }
     publish_main_state(client);
 }
@@ -137,7 +137,7 @@ static void brightness_handler(struct mqtt_client *client, char *topic, char *da
     uint8_t brightness = atoi(data);
     if (brightness != cur_params.brightness) {
         cur_params.brightness = brightness;
-        xTaskNotify(ui_task_handle, UI_MSG_UPDATE, eSetBits);
+        am_post_event(app_id, UI_MSG_UPDATE);
     }
     mqtt_publish(client, mqtt_topics[STATUS_TOPIC_BRIGHTNESS], data, 0, 0);
 }
@@ -163,7 +163,7 @@ static void rgb_handler(struct mqtt_client *client, char *topic, char *data)
     if (color[0] != cur_params.color.r || color[1] != cur_params.color.g || color[2] != cur_params.color.b) {
         crgb crgb_color = { color[0], color[1], color[2] };
         cur_params.color = crgb_color;
-        xTaskNotify(ui_task_handle, UI_MSG_UPDATE, eSetBits);
+        am_post_event(app_id, UI_MSG_UPDATE);
     }
     mqtt_publish(client, mqtt_topics[STATUS_TOPIC_RGB], data_bak, 0, 0);
 }
@@ -238,45 +238,40 @@ void ha_mqtt_light_ui_task(void *param)
 {
     struct canvas *cv = (struct canvas *)param;
 
-    ui_task_handle = xTaskGetCurrentTaskHandle();
+    app_id = am_get_app_id();
 
     struct mqtt_client *client = init_mqtt();
-    uint32_t message;
+    struct app_event event;
     while (1) {
-        if (xTaskNotifyWait(pdFALSE, ULONG_MAX, &message, portMAX_DELAY) == pdFALSE)
+        if (!am_event_wait(&event, portMAX_DELAY))
             continue;
 
-        if ((message & UI_MSG_TOGGLE) || (message & EVENT_BTN_CLICK)) {
+        if (event.type == EVENT_CLICK || (event.type == EVENT_APP && event.value == UI_MSG_TOGGLE)) {
             // Toggle light with fading animation
-            if (message == EVENT_BTN_CLICK) {
+            if (event.type == EVENT_CLICK) {
                 cur_params.state = !cur_params.state;
                 publish_main_state(client);
             }
+            anim_crossfade(cv, FADE_ANIM_DURATION, ANIM_EASE_IN_OUT);
             if (cur_params.state) {
-                struct canvas *temp_cv = cv_copy(cv);
-                cv_fill(temp_cv, crgb_mult(cur_params.color, cur_params.brightness / 255.f));
-                anim_fade_in(cv, temp_cv, FADE_ANIM_DURATION, FADE_ANIM_DELAY);
-                cv_free(temp_cv);
+                cv_fill(cv, crgb_mult(cur_params.color, cur_params.brightness / 255.f));
             } else {
-                anim_fade_out(cv, FADE_ANIM_DURATION, FADE_ANIM_DELAY);
+                cv_blank(cv);
             }
-        } else if (message & UI_MSG_UPDATE) {
+            am_send_msg(AM_MSG_REFRESH);
+        } else if (event.type == EVENT_APP && event.value == UI_MSG_UPDATE) {
             if (cur_params.state) {
                 cv_fill(cv, crgb_mult(cur_params.color, cur_params.brightness / 255.f));
             } else {
                 cv_blank(cv);
             }
             am_send_msg(AM_MSG_REFRESH);
-        } else if (message & EVENT_KNOB_RIGHT) {
-            if (cur_params.brightness < 255) {
-                cur_params.brightness = MIN(cur_params.brightness + CONFIG_HA_LIGHT_BRIGHTNESS_STEP, 255);
-                publish_brightness_state(client);
-                cv_fill(cv, crgb_mult(cur_params.color, cur_params.brightness / 255.f));
-                am_send_msg(AM_MSG_REFRESH);
-            }
-        } else if (message & EVENT_KNOB_LEFT) {
-            if (cur_params.brightness > 0) {
-                cur_params.brightness = MAX(cur_params.brightness - CONFIG_HA_LIGHT_BRIGHTNESS_STEP, 0);
+        } else if (event.type == EVENT_KNOB) {
+            // All steps turned since the last event at once
+            int32_t brightness = cur_params.brightness + event.value * CONFIG_HA_LIGHT_BRIGHTNESS_STEP;
+            brightness = MIN(MAX(brightness, 0), 255);
+            if (brightness != cur_params.brightness) {
+                cur_params.brightness = brightness;
                 publish_brightness_state(client);
                 cv_fill(cv, crgb_mult(cur_params.color, cur_params.brightness / 255.f));
                 am_send_msg(AM_MSG_REFRESH);
@@ -2,6 +2,7 @@
 #include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "app_manager.h"
 #include "canvas.h"
 
@@ -10,6 +11,7 @@
 #define SIN_FREQ            0.25
 #define SIN_Y_OFFSET        7
 #define SIN_FRAME_DELAY     50
+#define SIN_IDLE_FRAME_DELAY    100
 #define SIN_MIN_BRIGHTNESS  31
 #define SIN_MAX_BRIGHTNESS  248
 
@@ -30,57 +32,96 @@ void calculate_sine(int8_t *data, size_t size, float amp, uint8_t max_val)
     }
 }
 
-void sin_wave_ui_task(void *param)
-{
-    struct canvas *cv = (struct canvas *)param;
+struct sin_wave_state {
+    int8_t *data;
+    size_t size;
+    int8_t amp;
+    uint8_t x_off;
+    int64_t shift_us;   // Time of the last shift, the wave moves at the same speed at any frame rate
+};
 
-    // Draw sin wave
-    ESP_LOGI(TAG, "Drawing sin wave");
+// Kept over hibernation
+static int8_t saved_amp = 3;
 
+static uint8_t sin_wave_init(struct canvas *cv, void **state)
+{
+    struct sin_wave_state *s = pvPortMalloc(sizeof(struct sin_wave_state));
+    if (s == NULL)
+        return 1;
     // Calculate wave
-    size_t sin_size = (size_t) ceil(2 * M_PI / SIN_FREQ);
-    int8_t *sin_data = pvPortMalloc(sin_size * sizeof(int8_t));
-    int8_t sin_amp = 3;
-    calculate_sine(sin_data, sin_size, sin_amp, cv->height);
-
-    uint8_t x_off = 0;
-    while (1) {
-        cv_blank(cv);
-        // Draw wave
-        for (uint8_t x = 0; x < cv->width; x++) {
-            size_t data_idx = x + x_off;
-            if (data_idx >= sin_size)
-                data_idx -= sin_size;
+    s->size = (size_t) ceil(2 * M_PI / SIN_FREQ);
+    s->data = pvPortMalloc(s->size * sizeof(int8_t));
+    if (s->data == NULL) {
+        vPortFree(s);
+        return 1;
+    }
+    s->amp = saved_amp;
+    s->x_off = 0;
+    s->shift_us = esp_timer_get_time();
+    calculate_sine(s->data, s->size, s->amp, cv->height);
 
-            uint8_t brightness = SIN_MIN_BRIGHTNESS;
-            for (uint8_t y = sin_data[data_idx]; y < cv->height; y++) {
-                crgb cur_color = { .r = 0, .g = 0, .b = brightness };
-                cv_set_pixel(cv, x, y, cur_color);
-                if (brightness < SIN_MAX_BRIGHTNESS)
-                    brightness <<= 1;
-            }
-        }
-        am_send_msg(AM_MSG_REFRESH);
+    ESP_LOGI(TAG, "Drawing sin wave");
+    *state = s;
+    return 0;
+}
 
-        // Shift X
-        if (++x_off == sin_size)
-            x_off -= sin_size;
+static bool sin_wave_on_event(void *state, struct canvas *cv, const struct app_event *event)
+{
+    struct sin_wave_state *s = state;
+    if (event->type != EVENT_KNOB)
+        return false;
+    // Turning right makes waves higher
+    s->amp += event->value;
+    calculate_sine(s->data, s->size, s->amp, cv->height);
+    return true;
+}
 
-        ESP_LOGI(TAG, "Draw frame!");
-        uint32_t event;
-        if (xTaskNotifyWait(pdFALSE, ULONG_MAX, &event, pdMS_TO_TICKS(SIN_FRAME_DELAY)) == pdFALSE)
-            continue;
+static bool sin_wave_on_tick(void *state, struct canvas *cv)
+{
+    struct sin_wave_state *s = state;
+    // Shift X by one for every SIN_FRAME_DELAY passed
+    int64_t steps = (esp_timer_get_time() - s->shift_us) / (SIN_FRAME_DELAY * 1000);
+    if (steps <= 0)
+        return false;
+    s->shift_us += steps * SIN_FRAME_DELAY * 1000;
+    s->x_off = (s->x_off + steps % s->size) % s->size;
+    return true;
+}
 
-        switch (event) {
-            case EVENT_KNOB_LEFT:
-                sin_amp--;
-                calculate_sine(sin_data, sin_size, sin_amp, cv->height);
-                break;
+static void sin_wave_on_draw(void *state, struct canvas *cv)
+{
+    struct sin_wave_state *s = state;
+    cv_blank(cv);
+    // Draw wave
+    for (uint8_t x = 0; x < cv->width; x++) {
+        size_t data_idx = x + s->x_off;
+        if (data_idx >= s->size)
+            data_idx -= s->size;
 
-            case EVENT_KNOB_RIGHT:
-                sin_amp++;
-                calculate_sine(sin_data, sin_size, sin_amp, cv->height);
-                break;
+        uint8_t brightness = SIN_MIN_BRIGHTNESS;
+        for (uint8_t y = s->data[data_idx]; y < cv->height; y++) {
+            crgb cur_color = { .r = 0, .g = 0, .b = brightness };
+            cv_set_pixel(cv, x, y, cur_color);
+            if (brightness < SIN_MAX_BRIGHTNESS)
+                brightness <<= 1;
         }
     }
 }
+
+static void sin_wave_on_hibernate(void *state)
+{
+    struct sin_wave_state *s = state;
+    saved_amp = s->amp;
+    vPortFree(s->data);
+    vPortFree(s);
+}
+
+const struct am_app_ops sin_wave_app_ops = {
+    .init = sin_wave_init,
+    .on_event = sin_wave_on_event,
+    .on_tick = sin_wave_on_tick,
+    .on_draw = sin_wave_on_draw,
+    .on_hibernate = sin_wave_on_hibernate,
+    .tick_ms = SIN_FRAME_DELAY,
+    .idle_tick_ms = SIN_IDLE_FRAME_DELAY
+};
@@ -1 +1,3 @@
-void sin_wave_ui_task(void *param);
+#include "app_manager.h"
+
+extern const struct am_app_ops sin_wave_app_ops;
@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/param.h>
 #include <math.h>
@@ -11,7 +12,7 @@
 #include "animations.h"
 #include "http_client.h"
 
-#include "image_utils.h"
+#include "asset_cache.h"
 
 #define JSMN_HEADER
 #include "jsmn.h"
@@ -21,10 +22,12 @@
 
 #define JSON_TOKEN_COUNT    64
 
-#define UI_MSG_UPDATE   0x1
+// Messages of EVENT_APP
+#define UI_MSG_UPDATE   1
+#define UI_MSG_ICON     2
+#define UI_MSG_API_EXIT 3
 
 #define FADE_ANIM_DURATION  500
-#define FADE_ANIM_DELAY     20
 
 static const char *TAG = "weather_app";
 
@@ -37,8 +40,7 @@ enum weather_status {
     WEATHER_SNOWY,
     WEATHER_THUNDERSTORM
 };
-extern const char *base_path;
-static const char *weather_path = "/weather/";
+static const char *weather_path = "weather/";
 static const char *icon_files[] = {
     "sunny.qoi",
     "partly_cloudly.qoi",
@@ -49,8 +51,6 @@ static const char *icon_files[] = {
     "thunderstorm.qoi"
 };
 
-#define ICON_COUNT  (WEATHER_THUNDERSTORM + 1)
-
 static const char *url = "https://api.open-meteo.com/v1/forecast"
                          "?latitude=" CONFIG_WEATHER_LAT
                          "&longitude=" CONFIG_WEATHER_LON
@@ -60,8 +60,12 @@ static struct weather_info {
     enum weather_status status;
     int8_t temperature;
 } cur_weather;
+// cur_weather holds a forecast, it's kept over hibernation and shown right away on start
+static bool has_weather = false;
 
-static TaskHandle_t ui_task_handle;
+static int8_t app_id = -1;
+static TaskHandle_t api_task_handle;
+static volatile bool api_stop;
 
 static const crgb color = {255, 255, 255};
 
@@ -161,14 +165,23 @@ static int8_t fetch_api(struct weather_info* info)
     return 0;
 }
 
-static void draw_canvas(struct canvas *cv, struct image_desc *icons)
+// Takes the icon from the shared cache, UI task is notified with UI_MSG_ICON if it isn't loaded yet
+static struct asset *request_icon(enum weather_status status)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%s%s", weather_path, icon_files[status]);
+    return asset_acquire_async(name, app_id, UI_MSG_ICON);
+}
+
+static void draw_canvas(struct canvas *cv, const struct image_desc *icon)
 {
     uint8_t digits_x = cv->width - (digits_3x5_font.width * 2 + 1 + 4);  // 2 digits, 1px spacing, deg sign and 1px padding
     uint8_t digits_y = cv->height - digits_3x5_font.height;
     uint8_t deg_sign_x = cv->width - 3;
 
-    // Draw icon
-    cv_draw_image(cv, &icons[cur_weather.status], 0, 0);
+    // Draw icon, unless it's still loading
+    if (icon != NULL)
+        cv_draw_image(cv, icon, 0, 0);
 
     // Draw temperature
     int8_t temp = abs(cur_weather.temperature);
@@ -186,88 +199,102 @@ static void draw_canvas(struct canvas *cv, struct image_desc *icons)
 void weather_api_task(void *params)
 {
     ESP_LOGI(TAG, "Created API task");
-    while (1) {
+    while (!api_stop) {
+        uint32_t delay = API_FETCH_DELAY;
         if (fetch_api(&cur_weather) != 0) {
             ESP_LOGE(TAG, "Failed to fetch forecast!");
-            vTaskDelay(pdMS_TO_TICKS(API_FETCH_FAIL_DELAY));
-            continue;
+            delay = API_FETCH_FAIL_DELAY;
+        } else {
+            has_weather = true;
+            am_post_event(app_id, UI_MSG_UPDATE);
         }
-
-        xTaskNotify(ui_task_handle, UI_MSG_UPDATE, eSetBits);
-        vTaskDelay(pdMS_TO_TICKS(API_FETCH_DELAY));
+        // Woken up early to stop
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(delay));
     }
+    // Retried, the UI task waits for it
+    while (!am_post_event(app_id, UI_MSG_API_EXIT))
+        vTaskDelay(pdMS_TO_TICKS(100));
+    vTaskDelete(NULL);
+}
+
+// Stops the API task and releases the icon, the forecast stays in cur_weather
+static void hibernate(struct asset *icon)
+{
+    api_stop = true;
+    xTaskNotifyGive(api_task_handle);
+    struct app_event event;
+    do {
+        am_event_wait(&event, portMAX_DELAY);
+    } while (event.type != EVENT_APP || event.value != UI_MSG_API_EXIT);
+    asset_release(icon);
+    am_app_hibernated();
 }
 
 void weather_ui_task(void *param)
 {
     struct canvas *cv = (struct canvas *)param;
 
-    ui_task_handle = xTaskGetCurrentTaskHandle();
-
-    uint8_t digits_x = cv->width - (digits_3x5_font.width * 2 + 1 + 4);  // 2 digits, 1px spacing, deg sign and 1px padding
-    uint8_t digits_y = cv->height - digits_3x5_font.height;
-    uint8_t deg_sign_x = cv->width - 3;
-
-    // Preload all images
-    struct image_desc icons[ICON_COUNT];
-    struct image_desc img_desc;
-    char path[64];
-    for (uint8_t i = 0; i < ICON_COUNT; i++) {
-        strcpy(path, base_path);
-        strcat(path, weather_path);
-        strcat(path, icon_files[i]);
-        uint8_t ret = load_image_file(path, &img_desc);
-        if (ret)
-            while (1) { vTaskSuspend(NULL); }  // Halt task
-
-        icons[i] = img_desc;
+    app_id = am_get_app_id();
+    api_stop = false;
+    xTaskCreate(weather_api_task, "weather_background", 8 * 1024, NULL, 1, &api_task_handle);
+
+    struct app_event event;
+    bool restored = has_weather;
+    if (!restored) {
+        uint8_t digits_x = cv->width - (digits_3x5_font.width * 2 + 1 + 4);  // 2 digits, 1px spacing, deg sign and 1px padding
+        uint8_t digits_y = cv->height - digits_3x5_font.height;
+        uint8_t deg_sign_x = cv->width - 3;
+
+        // Draw placeholder
+        cv_draw_line_h(cv, digits_x, digits_x + 2, digits_y + 2, color);
+        cv_draw_line_h(cv, digits_x + 4, digits_x + 4 + 2, digits_y + 2, color);
+        cv_draw_rect(cv, deg_sign_x, deg_sign_x + 2, digits_y - 1, digits_y + 1, color);
+        am_send_msg(AM_MSG_REFRESH);
+
+        // Pulse the placeholder until the first forecast arrives
+        anim_fade(cv, 0, 255, FADE_ANIM_DURATION, ANIM_EASE_IN_OUT, ANIM_LOOP);
+        do {
+            am_event_wait(&event, portMAX_DELAY);
+            if (event.type == EVENT_HIBERNATE)
+                hibernate(NULL);
+        } while (event.type != EVENT_APP || event.value != UI_MSG_UPDATE);
     }
 
-    // Draw placeholder
-    cv_draw_line_h(cv, digits_x, digits_x + 2, digits_y + 2, color);
-    cv_draw_line_h(cv, digits_x + 4, digits_x + 4 + 2, digits_y + 2, color);
-    cv_draw_rect(cv, deg_sign_x, deg_sign_x + 2, digits_y - 1, digits_y + 1, color);
+    // Crossfade takes over the pulsing fade from its current brightness
+    struct asset *icon = request_icon(cur_weather.status);
+    if (!restored)
+        anim_crossfade(cv, FADE_ANIM_DURATION, ANIM_EASE_IN_OUT);
+    cv_blank(cv);
+    draw_canvas(cv, asset_image(icon));
     am_send_msg(AM_MSG_REFRESH);
-    struct canvas *placeholder_cv = cv_copy(cv);
-
-    // Start background task and display loading animation
-    xTaskCreate(weather_api_task, "weather_background", 8 * 1024, NULL, 1, NULL);
-    uint32_t message;
-    bool anim_dir = 1;
-    while (1) {
-        if (anim_dir)
-            anim_fade_in(cv, placeholder_cv, FADE_ANIM_DURATION, FADE_ANIM_DELAY);
-        else
-            anim_fade_out(cv, FADE_ANIM_DURATION, FADE_ANIM_DELAY);
-
-        if (xTaskNotifyWait(pdFALSE, ULONG_MAX, &message, 0) == pdTRUE)
-            if (message & UI_MSG_UPDATE)
-                break;
-        
-        anim_dir = !anim_dir;
-    }
-
-    if (anim_dir == 1) {
-        // Fade out before displaying new data
-        anim_fade_out(cv, FADE_ANIM_DURATION, FADE_ANIM_DELAY);
-    }
-    struct canvas *temp_cv = cv_copy(cv);
-    draw_canvas(temp_cv, icons);
-    anim_fade_in(cv, temp_cv, FADE_ANIM_DURATION, FADE_ANIM_DELAY);
-    cv_free(temp_cv);
 
     struct weather_info prev_weather = cur_weather;
     while (1) {
-        if (xTaskNotifyWait(pdFALSE, ULONG_MAX, &message, portMAX_DELAY) == pdFALSE || !(message & UI_MSG_UPDATE))
+        if (!am_event_wait(&event, portMAX_DELAY))
+            continue;
+        if (event.type == EVENT_HIBERNATE)
+            hibernate(icon);
+        if (event.type != EVENT_APP)
             continue;
 
-        if (cur_weather.status != prev_weather.status || cur_weather.temperature != prev_weather.temperature) {
-            anim_fade_out(cv, FADE_ANIM_DURATION, FADE_ANIM_DELAY);
-            struct canvas *temp_cv = cv_copy(cv);
-            draw_canvas(temp_cv, icons);
-            anim_fade_in(cv, temp_cv, FADE_ANIM_DURATION, FADE_ANIM_DELAY);
-            cv_free(temp_cv);
+        bool redraw = false;
+        if (event.value == UI_MSG_UPDATE) {
+            if (cur_weather.status != prev_weather.status) {
+                asset_release(icon);
+                icon = request_icon(cur_weather.status);
+            }
+            redraw = cur_weather.status != prev_weather.status || cur_weather.temperature != prev_weather.temperature;
+            prev_weather = cur_weather;
+        }
+        // Icon finished loading after the forecast was drawn
+        if (event.value == UI_MSG_ICON)
+            redraw = true;
+
+        if (redraw) {
+            anim_crossfade(cv, FADE_ANIM_DURATION, ANIM_EASE_IN_OUT);
+            cv_blank(cv);
+            draw_canvas(cv, asset_image(icon));
+            am_send_msg(AM_MSG_REFRESH);
         }
-        prev_weather = cur_weather;
     }
 }
@@ -5,12 +5,11 @@
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "canvas.h"
-#include "image_utils.h"
+#include "asset_cache.h"
 #include "app_manager.h"
 
 extern bool wifi_is_connected;
-extern const char *base_path;
-static const char *wifi_path_base = "/wifi/";
+static const char *wifi_path_base = "wifi/";
 
 #define RSSI_LEVEL_COUNT    4
 static const int8_t rssi_thresholds[] = { -70, -60, -50};
@@ -24,9 +23,11 @@ static const char *rssi_icon_files[] = {
 
 #define RSSI_CHECK_DELAY    2000
 
+#define UI_MSG_ICON         1
+
 static const char *TAG = "wifi_status";
 
-static void draw_icon_centered(struct canvas *cv, struct image_desc *icon)
+static void draw_icon_centered(struct canvas *cv, const struct image_desc *icon)
 {
     uint8_t x = (cv->width - icon->width) / 2;
     uint8_t y = (cv->height - icon->height) / 2;
@@ -38,23 +39,14 @@ void wifi_status_ui_task(void *param)
 {
     struct canvas *cv = (struct canvas *)param;
 
-    // Preload all images
-    struct image_desc rssi_icons[RSSI_LEVEL_COUNT + 1];  // +1 for empty image
-    struct image_desc img_desc;
-    char path[64];
-    for (uint8_t i = 0; i < RSSI_LEVEL_COUNT + 1; i++) {
-        strcpy(path, base_path);
-        strcat(path, wifi_path_base);
-        strcat(path, rssi_icon_files[i]);
-        uint8_t ret = load_image_file(path, &img_desc);
-        if (ret)
-            while (1) { vTaskSuspend(NULL); }  // Halt task
-
-        rssi_icons[i] = img_desc;
-    }
+    // Only the shown icon is held, the rest can be evicted from the shared cache
+    struct asset *icon = NULL;
+    uint8_t icon_idx = UINT8_MAX;
+    char name[64];
 
     int rssi;
     while (1) {
+        uint8_t idx = icon_idx;
         if (wifi_is_connected) {
             esp_err_t ret = esp_wifi_sta_get_rssi(&rssi);
             if (ret == ESP_OK) {
@@ -63,12 +55,30 @@ void wifi_status_ui_task(void *param)
                     level++;
 
                 ESP_LOGI(TAG, "RSSI: %d, level: %d", rssi, level);
-                draw_icon_centered(cv, &rssi_icons[level + 1]);
+                idx = level + 1;
             } else
                 ESP_LOGW(TAG, "Failed to get RSSI!");
         } else {
-            draw_icon_centered(cv, &rssi_icons[0]);
+            idx = 0;
+        }
+
+        if (idx != icon_idx) {
+            asset_release(icon);
+            strcpy(name, wifi_path_base);
+            strcat(name, rssi_icon_files[idx]);
+            icon = asset_acquire_async(name, am_get_app_id(), UI_MSG_ICON);
+            icon_idx = idx;
+        }
+        // Drawn when the loader notifies us if the icon isn't ready yet
+        const struct image_desc *image = asset_image(icon);
+        if (image != NULL)
+            draw_icon_centered(cv, image);
+
+        struct app_event event;
+        if (am_event_wait(&event, pdMS_TO_TICKS(RSSI_CHECK_DELAY)) && event.type == EVENT_HIBERNATE) {
+            // Nothing to keep, the icon is picked again on start
+            asset_release(icon);
+            am_app_hibernated();
         }
-        vTaskDelay(pdMS_TO_TICKS(RSSI_CHECK_DELAY));
     }
 }
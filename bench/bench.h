@@ -0,0 +1,35 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sdkconfig.h"
+
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Prints a result as a table row, or as a JSON line if BENCH_JSON is set (see run_benches.py)
+static inline void bench_report(const char *name, uint32_t iterations, uint64_t ns)
+{
+    if (getenv("BENCH_JSON") != NULL)
+        printf("{\"name\": \"%s\", \"width\": %d, \"height\": %d, \"iterations\": %u, \"ns\": %llu}\n",
+               name, CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT, iterations, (unsigned long long) ns);
+    else
+        printf("%-24s %3dx%-3d %10llu ns\n", name, CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT,
+               (unsigned long long) ns);
+}
+
+// Runs body `iterations` times and reports the average time of one run
+#define BENCH_RUN(name, iterations, body) do {                                   \
+        uint64_t __start = bench_now_ns();                                       \
+        for (uint32_t __i = 0; __i < (iterations); __i++) { body; }              \
+        bench_report(name, iterations, (bench_now_ns() - __start) / (iterations)); \
+    } while (0)
+
+#endif
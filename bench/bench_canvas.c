@@ -0,0 +1,81 @@
+/* Canvas primitives, slide frames and animation effects computed by the render task */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "animations.h"
+#include "canvas.h"
+#include "fonts.h"
+#include "framebuffer.h"
+#include "led_strip.h"
+
+#define ITERATIONS  20000
+
+// Long enough to stay in the middle of the animation during the whole run
+#define ANIM_DURATION   (3600 * 1000)
+
+static const crgb color = { 255, 128, 0 };
+
+static void fill_noise(struct canvas *cv)
+{
+    srand(1);
+    for (size_t i = 0; i < cv->width * cv->height; i++) {
+        crgb px = { rand() & 0xff, rand() & 0xff, rand() & 0xff };
+        cv->buf[i] = px;
+    }
+}
+
+int main(void)
+{
+    struct canvas *cv = cv_init(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT);
+    struct canvas *child = cv_init(CONFIG_HC_MATRIX_WIDTH / 2, CONFIG_HC_MATRIX_HEIGHT / 2);
+    fill_noise(child);
+
+    BENCH_RUN("cv_fill", ITERATIONS, cv_fill(cv, color));
+    BENCH_RUN("cv_draw_symbol_3x5", ITERATIONS, {
+        for (uint8_t d = 0; d < 10; d++)
+            cv_draw_symbol(cv, &digits_3x5_font, d, (d * 4) % (CONFIG_HC_MATRIX_WIDTH - 3), 0, color);
+    });
+    BENCH_RUN("cv_draw_symbol_7x7", ITERATIONS, {
+        for (uint8_t d = 0; d < 10; d++)
+            cv_draw_symbol(cv, &digits_7x7_font, d, (d * 8) % (CONFIG_HC_MATRIX_WIDTH - 7), 0, color);
+    });
+    BENCH_RUN("cv_draw_cv", ITERATIONS, cv_draw_cv(cv, child, 2, 2));
+
+    // One slide between two apps, every offset as the render task draws them
+    struct canvas *cv_l = cv_init(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT);
+    struct canvas *cv_r = cv_init(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT);
+    cv_enable_double_buffer(cv_l);
+    cv_enable_double_buffer(cv_r);
+    fill_noise(cv_l);
+    cv_present(cv_l);
+    cv_fill(cv_r, color);
+    cv_present(cv_r);
+    led_strip_handle_t output = NULL;
+    struct framebuffer *fb = fb_init(output, 255);
+    BENCH_RUN("slide_frames", ITERATIONS / 10, {
+        for (uint8_t off = 1; off <= CONFIG_HC_MATRIX_WIDTH; off++)
+            cv_draw_slide_to_fb(fb, cv_l, cv_r, off);
+    });
+    BENCH_RUN("slide_frames_refresh", ITERATIONS / 10, {
+        for (uint8_t off = 1; off <= CONFIG_HC_MATRIX_WIDTH; off++) {
+            cv_draw_slide_to_fb(fb, cv_l, cv_r, off);
+            fb_refresh(fb);
+        }
+    });
+
+    // Output of animations for one frame, apps' canvas is left as is
+    anim_init();
+    fill_noise(cv);
+    crgb *out = malloc(cv->width * cv->height * sizeof(crgb));
+    anim_t anim = anim_fade(cv, 255, 0, ANIM_DURATION, ANIM_EASE_IN_OUT, 0);
+    BENCH_RUN("anim_fade", ITERATIONS, anim_apply(cv, cv->buf, out));
+    anim_t move = anim_move(cv, 3, 1, 3, 1, ANIM_DURATION, ANIM_EASE_LINEAR);
+    BENCH_RUN("anim_fade_move", ITERATIONS, anim_apply(cv, cv->buf, out));
+    anim_cancel(anim);
+    anim_cancel(move);
+    anim_crossfade(cv, ANIM_DURATION, ANIM_EASE_LINEAR);
+    BENCH_RUN("anim_crossfade", ITERATIONS, anim_apply(cv, cv->buf, out));
+    return 0;
+}
@@ -0,0 +1,52 @@
+/* Framebuffer output stage: float brightness (old path) vs LUT vs direct SPI encoding */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "framebuffer.h"
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+#include "led_spi.h"
+#else
+#include "led_strip.h"
+#endif
+
+#define ITERATIONS  2000
+
+#if !CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+// Output stage as it was before the LUT, kept as a baseline
+static void fb_refresh_float(struct framebuffer *fb)
+{
+    for (uint8_t y = 0; y < CONFIG_HC_MATRIX_HEIGHT; y++)
+        for (uint8_t x = 0; x < CONFIG_HC_MATRIX_WIDTH; x++) {
+            crgb pixel = crgb_mult(fb->buf[y][x], fb->brightness / 255.f);
+            led_strip_set_pixel(fb->output, y * CONFIG_HC_MATRIX_WIDTH + x, pixel.r, pixel.g, pixel.b);
+        }
+    led_strip_refresh(fb->output);
+}
+#endif
+
+int main(void)
+{
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+    struct led_spi *output;
+    led_spi_new(0, CONFIG_HC_MATRIX_WIDTH * CONFIG_HC_MATRIX_HEIGHT, SPI2_HOST, &output);
+    const char *name = "fb_refresh_spi";
+#else
+    led_strip_handle_t output = NULL;
+    const char *name = "fb_refresh_lut";
+#endif
+    struct framebuffer *fb = fb_init(output, 128);
+    srand(1);
+    for (uint8_t y = 0; y < CONFIG_HC_MATRIX_HEIGHT; y++)
+        for (uint8_t x = 0; x < CONFIG_HC_MATRIX_WIDTH; x++) {
+            crgb px = { rand() & 0xff, rand() & 0xff, rand() & 0xff };
+            fb->buf[y][x] = px;
+        }
+
+#if !CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+    BENCH_RUN("fb_refresh_float", ITERATIONS, fb_refresh_float(fb));
+#endif
+    BENCH_RUN(name, ITERATIONS, { fb_mark_dirty_all(fb); fb_refresh(fb); });
+    BENCH_RUN("fb_refresh_unchanged", ITERATIONS, fb_refresh(fb));
+    return 0;
+}
@@ -0,0 +1,187 @@
+/* Image blitting: float RGBA blending (old path) vs premultiplied integer blit,
+ * direct color vs palette-indexed images */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "bench.h"
+#include "canvas.h"
+#include "image_utils.h"
+#include "qoi.h"
+
+#define ITERATIONS  2000
+
+static const char *icon_files[] = {
+    "weather/cloudly.qoi", "weather/heavy_rain.qoi", "weather/light_rain.qoi",
+    "weather/partly_cloudly.qoi", "weather/snowy.qoi", "weather/sunny.qoi",
+    "weather/thunderstorm.qoi", "wifi/empty.qoi", "wifi/level1.qoi", "wifi/level2.qoi",
+    "wifi/level3.qoi", "wifi/level4.qoi"
+};
+#define ICON_COUNT  (sizeof(icon_files) / sizeof(icon_files[0]))
+
+// cv_draw_image() as it was before images were converted at load time, kept as a baseline
+static void draw_image_float(struct canvas *cv, const uint8_t *pixels, uint8_t width, uint8_t height,
+                             uint8_t x, uint8_t y)
+{
+    for (uint8_t i = 0; i < (cv->height < height ? cv->height : height); i++) {
+        if (y + i >= cv->height)
+            break;
+        for (uint8_t j = 0; j < (cv->width < width ? cv->width : width); j++) {
+            if (x + j >= cv->width)
+                break;
+            size_t pos = (i * width + j) * 4;
+            crgb cv_px = cv_get_pixel(cv, x + j, y + i);
+            float alpha = pixels[pos + 3] / 255.f;
+            crgb final;
+            final.r = pixels[pos] * alpha + cv_px.r * (1 - alpha);
+            final.g = pixels[pos + 1] * alpha + cv_px.g * (1 - alpha);
+            final.b = pixels[pos + 2] * alpha + cv_px.b * (1 - alpha);
+            cv_set_pixel(cv, x + j, y + i, final);
+        }
+    }
+}
+
+// Expands palette-indexed image into direct color one, same pixels
+static void to_direct(const struct image_desc *img, struct image_desc *out)
+{
+    size_t count = img->width * img->height;
+    crgb *pixels = malloc(count * sizeof(crgb));
+    uint8_t *alpha = img->alpha != NULL ? malloc(count) : NULL;
+    for (uint8_t y = 0; y < img->height; y++) {
+        for (uint8_t x = 0; x < img->width; x++) {
+            uint8_t idx = image_index(&img->indices[y * image_stride(img)], img->bpp, x);
+            pixels[y * img->width + x] = img->pixels[idx];
+            if (alpha != NULL)
+                alpha[y * img->width + x] = img->alpha[idx];
+        }
+    }
+    *out = *img;
+    out->bpp = 0;
+    out->colors = 0;
+    out->pixels = pixels;
+    out->alpha = alpha;
+    out->indices = NULL;
+}
+
+static size_t image_ram(const struct image_desc *img)
+{
+    size_t count = img->bpp ? img->colors : img->width * img->height;
+    return count * sizeof(crgb) + (img->alpha != NULL ? count : 0) + img->height * sizeof(struct image_row) +
+           (img->bpp ? image_stride(img) * img->height : 0);
+}
+
+static void fill_noise(struct canvas *cv)
+{
+    srand(1);
+    for (size_t i = 0; i < cv->width * cv->height; i++) {
+        crgb px = { rand() & 0xff, rand() & 0xff, rand() & 0xff };
+        cv->buf[i] = px;
+    }
+}
+
+int main(void)
+{
+    uint8_t *rgba[ICON_COUNT];
+    qoi_desc qoi[ICON_COUNT];
+    struct image_desc icons[ICON_COUNT];
+    char path[256];
+    for (size_t i = 0; i < ICON_COUNT; i++) {
+        snprintf(path, sizeof(path), "%s/%s", IMAGE_DIR, icon_files[i]);
+        rgba[i] = qoi_read(path, &qoi[i], 4);
+        if (rgba[i] == NULL || image_from_rgba(rgba[i], 4, qoi[i].width, qoi[i].height, &icons[i])) {
+            fprintf(stderr, "Failed to load %s\n", path);
+            return 1;
+        }
+    }
+
+    // Icons have few colors, so they are loaded palette-indexed
+    struct image_desc direct[ICON_COUNT];
+    size_t rgba_ram = 0, direct_ram = 0, indexed_ram = 0;
+    for (size_t i = 0; i < ICON_COUNT; i++) {
+        if (icons[i].bpp == 0) {
+            fprintf(stderr, "%s wasn't loaded palette-indexed\n", icon_files[i]);
+            return 1;
+        }
+        to_direct(&icons[i], &direct[i]);
+        rgba_ram += qoi[i].width * qoi[i].height * 4;
+        direct_ram += image_ram(&direct[i]);
+        indexed_ram += image_ram(&icons[i]);
+    }
+    printf("%-24s %zu bytes RGBA, %zu direct, %zu indexed\n", "icons_ram", rgba_ram, direct_ram, indexed_ram);
+
+    // Both paths must give the same picture, up to rounding
+    struct canvas *cv_float = cv_init(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT);
+    struct canvas *cv = cv_init(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT);
+    int max_diff = 0;
+    for (size_t i = 0; i < ICON_COUNT; i++) {
+        fill_noise(cv_float);
+        fill_noise(cv);
+        draw_image_float(cv_float, rgba[i], qoi[i].width, qoi[i].height, 1, 1);
+        cv_draw_image(cv, &icons[i], 1, 1);
+        for (size_t p = 0; p < cv->width * cv->height; p++) {
+            max_diff = MAX(max_diff, abs(cv->buf[p].r - cv_float->buf[p].r));
+            max_diff = MAX(max_diff, abs(cv->buf[p].g - cv_float->buf[p].g));
+            max_diff = MAX(max_diff, abs(cv->buf[p].b - cv_float->buf[p].b));
+        }
+    }
+    if (max_diff > 1) {
+        fprintf(stderr, "Integer blit differs from float one by %d\n", max_diff);
+        return 1;
+    }
+    // Indexed images must be drawn exactly like direct color ones
+    for (size_t i = 0; i < ICON_COUNT; i++) {
+        fill_noise(cv_float);
+        fill_noise(cv);
+        cv_draw_image(cv_float, &direct[i], -2, 3);
+        cv_draw_image(cv, &icons[i], -2, 3);
+        if (memcmp(cv->buf, cv_float->buf, sizeof(crgb) * cv->width * cv->height) != 0) {
+            fprintf(stderr, "Indexed %s differs from direct color one\n", icon_files[i]);
+            return 1;
+        }
+    }
+
+    // Noise has too many colors for a palette, so it stays direct color without alpha
+    uint8_t *noise = malloc(qoi[0].width * qoi[0].height * 3);
+    for (size_t p = 0; p < qoi[0].width * qoi[0].height * 3; p++)
+        noise[p] = rand() & 0xff;
+    struct image_desc opaque;
+    if (image_from_rgba(noise, 3, qoi[0].width, qoi[0].height, &opaque) || opaque.bpp != 0) {
+        fprintf(stderr, "Failed to make an opaque direct color image\n");
+        return 1;
+    }
+
+    BENCH_RUN("qoi_read_icons", ITERATIONS / 10, {
+        for (size_t i = 0; i < ICON_COUNT; i++) {
+            qoi_desc desc;
+            snprintf(path, sizeof(path), "%s/%s", IMAGE_DIR, icon_files[i]);
+            free(qoi_read(path, &desc, 4));
+        }
+    });
+    BENCH_RUN("draw_image_float", ITERATIONS, {
+        for (size_t i = 0; i < ICON_COUNT; i++)
+            draw_image_float(cv, rgba[i], qoi[i].width, qoi[i].height, 0, 0);
+    });
+    BENCH_RUN("draw_image", ITERATIONS, {
+        for (size_t i = 0; i < ICON_COUNT; i++)
+            cv_draw_image(cv, &direct[i], 0, 0);
+    });
+    BENCH_RUN("draw_image_rgb", ITERATIONS, {
+        for (size_t i = 0; i < ICON_COUNT; i++)
+            cv_draw_image(cv, &opaque, 0, 0);
+    });
+    BENCH_RUN("draw_image_indexed", ITERATIONS, {
+        for (size_t i = 0; i < ICON_COUNT; i++)
+            cv_draw_image(cv, &icons[i], 0, 0);
+    });
+    BENCH_RUN("draw_image_clipped", ITERATIONS, {
+        for (size_t i = 0; i < ICON_COUNT; i++)
+            cv_draw_image(cv, &direct[i], -4, CONFIG_HC_MATRIX_HEIGHT - 8);
+    });
+    BENCH_RUN("draw_indexed_clipped", ITERATIONS, {
+        for (size_t i = 0; i < ICON_COUNT; i++)
+            cv_draw_image(cv, &icons[i], -4, CONFIG_HC_MATRIX_HEIGHT - 8);
+    });
+    return 0;
+}
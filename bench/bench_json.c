@@ -0,0 +1,82 @@
+/* Parsing of a recorded Open-Meteo response the way the weather app does it */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "jsmn.h"
+
+#define ITERATIONS  20000
+// Same as JSON_TOKEN_COUNT of the weather app
+#define TOKEN_COUNT 64
+
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc(size + 1);
+    if (data != NULL && fread(data, 1, size, f) == size) {
+        data[size] = 0;
+    } else {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+// Returns the value token of key in the object at tokens[obj], or -1
+static int find_key(const char *json, const jsmntok_t *tokens, int count, int obj, const char *key)
+{
+    size_t len = strlen(key);
+    int i = obj + 1;
+    for (int pair = 0; pair < tokens[obj].size && i + 1 < count; pair++) {
+        const jsmntok_t *k = &tokens[i];
+        if (k->type == JSMN_STRING && k->end - k->start == len && strncmp(&json[k->start], key, len) == 0)
+            return i + 1;
+        // Skip the value with all its children
+        int end = tokens[i + 1].end;
+        for (i += 2; i < count && tokens[i].start < end; i++);
+    }
+    return -1;
+}
+
+int main(void)
+{
+    char *json = read_file(DATA_DIR "/open_meteo.json");
+    if (json == NULL) {
+        fprintf(stderr, "Failed to load %s\n", DATA_DIR "/open_meteo.json");
+        return 1;
+    }
+    size_t len = strlen(json);
+    jsmn_parser parser;
+    jsmntok_t tokens[TOKEN_COUNT];
+
+    jsmn_init(&parser);
+    int count = jsmn_parse(&parser, json, len, tokens, TOKEN_COUNT);
+    int cur = count > 0 ? find_key(json, tokens, count, 0, "current") : -1;
+    if (cur < 0 || find_key(json, tokens, count, cur, "temperature_2m") < 0 ||
+        find_key(json, tokens, count, cur, "weather_code") < 0) {
+        fprintf(stderr, "Failed to parse the response: %d\n", count);
+        return 1;
+    }
+
+    BENCH_RUN("jsmn_parse", ITERATIONS, {
+        jsmn_init(&parser);
+        jsmn_parse(&parser, json, len, tokens, TOKEN_COUNT);
+    });
+    BENCH_RUN("jsmn_parse_lookup", ITERATIONS, {
+        jsmn_init(&parser);
+        count = jsmn_parse(&parser, json, len, tokens, TOKEN_COUNT);
+        cur = find_key(json, tokens, count, 0, "current");
+        find_key(json, tokens, count, cur, "temperature_2m");
+        find_key(json, tokens, count, cur, "weather_code");
+    });
+    free(json);
+    return 0;
+}
@@ -0,0 +1,114 @@
+/* Drawing .qoi files: full decode with qoi_read() and conversion (old path) vs streaming
+ * decode into the canvas. Both are checked to give the same pixels */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "canvas.h"
+#include "image_utils.h"
+#include "qoi_stream.h"
+#include "qoi.h"
+
+#define ITERATIONS  500
+
+#define LARGE_SIZE  128
+#define LARGE_FILE  "bench_large.qoi"
+
+static const char *icon_files[] = {
+    "weather/cloudly.qoi", "weather/heavy_rain.qoi", "weather/light_rain.qoi",
+    "weather/partly_cloudly.qoi", "weather/snowy.qoi", "weather/sunny.qoi",
+    "weather/thunderstorm.qoi", "wifi/empty.qoi", "wifi/level1.qoi", "wifi/level2.qoi",
+    "wifi/level3.qoi", "wifi/level4.qoi"
+};
+#define ICON_COUNT  (sizeof(icon_files) / sizeof(icon_files[0]))
+
+static char icon_paths[ICON_COUNT][256];
+
+// Background-like picture with gradients and a translucent band
+static int write_large_image(void)
+{
+    uint8_t *rgba = malloc(LARGE_SIZE * LARGE_SIZE * 4);
+    for (int y = 0; y < LARGE_SIZE; y++) {
+        for (int x = 0; x < LARGE_SIZE; x++) {
+            uint8_t *px = &rgba[(y * LARGE_SIZE + x) * 4];
+            px[0] = x * 2;
+            px[1] = y * 2;
+            px[2] = (x ^ y) & 0xf0;
+            px[3] = (y / 16) % 3 == 1 ? 128 + x : 255;
+        }
+    }
+    qoi_desc desc = { .width = LARGE_SIZE, .height = LARGE_SIZE, .channels = 4, .colorspace = QOI_SRGB };
+    int ret = qoi_write(LARGE_FILE, rgba, &desc);
+    free(rgba);
+    return ret;
+}
+
+// What drawing an image file took before streaming
+static uint8_t draw_file_full(struct canvas *cv, const char *path, int16_t x, int16_t y)
+{
+    struct image_desc img;
+    if (load_image_file(path, &img))
+        return 1;
+    cv_draw_image(cv, &img, x, y);
+    free_image(&img);
+    return 0;
+}
+
+static void fill_noise(struct canvas *cv)
+{
+    srand(1);
+    for (size_t i = 0; i < cv->width * cv->height; i++) {
+        crgb px = { rand() & 0xff, rand() & 0xff, rand() & 0xff };
+        cv->buf[i] = px;
+    }
+}
+
+static int compare(const char *path, int16_t x, int16_t y)
+{
+    struct canvas *a = cv_init(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT);
+    struct canvas *b = cv_init(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT);
+    fill_noise(a);
+    fill_noise(b);
+    int ret = draw_file_full(a, path, x, y) || qoi_stream_draw(b, path, x, y) ||
+              memcmp(a->buf, b->buf, sizeof(crgb) * a->width * a->height) != 0;
+    if (ret)
+        fprintf(stderr, "Streaming decode of %s at %d, %d differs\n", path, x, y);
+    cv_free(a);
+    cv_free(b);
+    return ret;
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < ICON_COUNT; i++)
+        snprintf(icon_paths[i], sizeof(icon_paths[i]), "%s/%s", IMAGE_DIR, icon_files[i]);
+    if (write_large_image() == 0) {
+        fprintf(stderr, "Failed to write %s\n", LARGE_FILE);
+        return 1;
+    }
+
+    for (size_t i = 0; i < ICON_COUNT; i++)
+        if (compare(icon_paths[i], 1, 1) || compare(icon_paths[i], -3, CONFIG_HC_MATRIX_HEIGHT - 6))
+            return 1;
+    if (compare(LARGE_FILE, 0, 0) || compare(LARGE_FILE, -40, -70))
+        return 1;
+
+    struct canvas *cv = cv_init(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT);
+    BENCH_RUN("icons_full", ITERATIONS, {
+        for (size_t i = 0; i < ICON_COUNT; i++)
+            draw_file_full(cv, icon_paths[i], 0, 0);
+    });
+    BENCH_RUN("icons_stream", ITERATIONS, {
+        for (size_t i = 0; i < ICON_COUNT; i++)
+            qoi_stream_draw(cv, icon_paths[i], 0, 0);
+    });
+    BENCH_RUN("large_full", ITERATIONS, draw_file_full(cv, LARGE_FILE, 0, 0));
+    BENCH_RUN("large_stream", ITERATIONS, qoi_stream_draw(cv, LARGE_FILE, 0, 0));
+    BENCH_RUN("large_stream_bottom", ITERATIONS,
+              qoi_stream_draw(cv, LARGE_FILE, 0, CONFIG_HC_MATRIX_HEIGHT - LARGE_SIZE));
+    cv_free(cv);
+    remove(LARGE_FILE);
+    return 0;
+}
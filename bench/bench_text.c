@@ -0,0 +1,46 @@
+/* Text: full string redraw every frame vs incremental marquee */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "canvas.h"
+#include "text.h"
+
+#define ITERATIONS  20000
+
+static const char *text = "Погода: +23°C, ветер 5 м/с. Weather: sunny, 23°C";
+
+static const crgb color = { 255, 255, 255 };
+static const crgb bg = { 0, 0, 0 };
+
+int main(void)
+{
+    struct canvas *cv = cv_init(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT);
+    struct marquee m;
+    if (marquee_init(&m, cv, &text_font, text, 0, 0, CONFIG_HC_MATRIX_WIDTH, color, bg))
+        return 1;
+
+    // After a full period the area must look exactly like at the start
+    size_t area = CONFIG_HC_MATRIX_WIDTH * text_font.height * sizeof(crgb);
+    crgb *start = malloc(area);
+    memcpy(start, cv->buf, area);
+    for (uint16_t i = 0; i < m.text_width + text_font.spacing + m.gap; i++)
+        marquee_step(&m);
+    if (memcmp(start, cv->buf, area) != 0) {
+        fprintf(stderr, "Marquee doesn't repeat after %d columns\n", m.text_width + text_font.spacing + m.gap);
+        return 1;
+    }
+
+    int16_t pos = 0;
+    BENCH_RUN("text_redraw", ITERATIONS, {
+        memset(cv->buf, 0, area);
+        cv_draw_text(cv, &text_font, text, -pos, 0, color);
+        pos = (pos + 1) % m.text_width;
+    });
+    BENCH_RUN("marquee_step", ITERATIONS, marquee_step(&m));
+    BENCH_RUN("text_measure", ITERATIONS, text_measure(&text_font, text));
+    marquee_free(&m);
+    return 0;
+}
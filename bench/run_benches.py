@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Runs every benchmark of a build directory and writes the results as one JSON document,
+so runs on different commits can be compared:
+
+    cmake -S bench -B build_bench && cmake --build build_bench
+    python3 bench/run_benches.py build_bench -o results.json
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+
+def git_commit():
+    try:
+        return subprocess.run(['git', 'rev-parse', 'HEAD'], capture_output=True, text=True,
+                              cwd=os.path.dirname(os.path.abspath(__file__)), check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Runs host benchmarks with JSON output')
+    parser.add_argument('build_dir')
+    parser.add_argument('-o', '--output', help='output file, stdout by default')
+    parser.add_argument('-f', '--filter', default='', help='run only benchmarks containing this string')
+    args = parser.parse_args()
+
+    names = sorted(f for f in os.listdir(args.build_dir)
+                   if f.startswith('bench_') and args.filter in f and
+                   os.access(os.path.join(args.build_dir, f), os.X_OK) and
+                   os.path.isfile(os.path.join(args.build_dir, f)))
+    if not names:
+        sys.exit(f'No benchmarks in {args.build_dir}')
+
+    results = []
+    failed = False
+    env = dict(os.environ, BENCH_JSON='1')
+    for name in names:
+        print(f'Running {name}', file=sys.stderr)
+        proc = subprocess.run([os.path.join(args.build_dir, name)], capture_output=True, text=True, env=env)
+        if proc.returncode != 0:
+            print(f'{name} failed: {proc.stderr.strip()}', file=sys.stderr)
+            failed = True
+            continue
+        # Other lines are informational, like memory usage
+        for line in proc.stdout.splitlines():
+            if line.startswith('{'):
+                results.append(dict(json.loads(line), bench=name))
+
+    doc = json.dumps({'commit': git_commit(), 'results': results}, indent=2)
+    if args.output:
+        with open(args.output, 'w') as fd:
+            fd.write(doc + '\n')
+    else:
+        print(doc)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,14 @@
+#ifndef __BENCH_ESP_ERR_H__
+#define __BENCH_ESP_ERR_H__
+
+typedef int esp_err_t;
+
+#define ESP_OK          0
+#define ESP_FAIL        -1
+#define ESP_ERR_NO_MEM  0x101
+
+#define ESP_ERROR_CHECK(x)  (void)(x)
+
+static inline const char *esp_err_to_name(esp_err_t err) { return err == ESP_OK ? "ESP_OK" : "ESP_FAIL"; }
+
+#endif
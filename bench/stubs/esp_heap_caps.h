@@ -0,0 +1,10 @@
+#ifndef __BENCH_ESP_HEAP_CAPS_H__
+#define __BENCH_ESP_HEAP_CAPS_H__
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_DMA  (1 << 3)
+
+#define heap_caps_calloc(n, size, caps)  calloc(n, size)
+
+#endif
@@ -0,0 +1,21 @@
+// Minimal FreeRTOS stand-in for host benchmarks
+#ifndef __BENCH_FREERTOS_H__
+#define __BENCH_FREERTOS_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef void *TaskHandle_t;
+
+#define portMAX_DELAY       0xffffffffUL
+
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+#define pvPortMalloc(sz)    malloc(sz)
+#define vPortFree(p)        free(p)
+
+static inline void vTaskDelay(TickType_t ticks) { (void) ticks; }
+
+#endif
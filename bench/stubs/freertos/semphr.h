@@ -0,0 +1,14 @@
+#ifndef __BENCH_SEMPHR_H__
+#define __BENCH_SEMPHR_H__
+
+#include "freertos/FreeRTOS.h"
+
+// Benchmarks are single-threaded, mutexes do nothing
+typedef void *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void) { return (SemaphoreHandle_t) 1; }
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) { (void) sem; (void) ticks; return 1; }
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) { (void) sem; return 1; }
+static inline void vSemaphoreDelete(SemaphoreHandle_t sem) { (void) sem; }
+
+#endif
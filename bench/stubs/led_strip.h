@@ -0,0 +1,14 @@
+// Null LED backend, pixels are stored in memory and never sent anywhere
+#ifndef __BENCH_LED_STRIP_H__
+#define __BENCH_LED_STRIP_H__
+
+#include <stdint.h>
+#include "led_strip_types.h"
+
+#include "esp_err.h"
+
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
+esp_err_t led_strip_refresh(led_strip_handle_t strip);
+esp_err_t led_strip_clear(led_strip_handle_t strip);
+
+#endif
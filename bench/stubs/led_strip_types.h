@@ -0,0 +1,6 @@
+#ifndef __BENCH_LED_STRIP_TYPES_H__
+#define __BENCH_LED_STRIP_TYPES_H__
+
+typedef struct led_strip_t *led_strip_handle_t;
+
+#endif
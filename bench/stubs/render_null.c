@@ -0,0 +1,11 @@
+// Render task stand-in: benchmarks call the drawing code directly, frame requests are dropped
+#include "render.h"
+
+void render_request(void)
+{
+}
+
+void render_request_at(int64_t time_us)
+{
+    (void) time_us;
+}
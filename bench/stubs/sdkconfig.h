@@ -0,0 +1,24 @@
+// Host configuration for benchmarks, geometry is passed from CMake
+#ifndef CONFIG_HC_MATRIX_WIDTH
+#define CONFIG_HC_MATRIX_WIDTH 16
+#endif
+#ifndef CONFIG_HC_MATRIX_HEIGHT
+#define CONFIG_HC_MATRIX_HEIGHT 16
+#endif
+#define CONFIG_HC_MATRIX_TYPE_SERPENTINE 1
+#define CONFIG_HC_MATRIX_SERPENTINE_DIR_NORMAL 1
+#define CONFIG_HC_FB_BRIGHTNESS 255
+#define CONFIG_HC_FB_GAMMA 22
+#define CONFIG_HC_FB_WHITE_BALANCE_R 255
+#define CONFIG_HC_FB_WHITE_BALANCE_G 255
+#define CONFIG_HC_FB_WHITE_BALANCE_B 255
+#define CONFIG_HC_AM_MAX_APPS 8
+#define CONFIG_HC_AM_SLIDE_FRAME_DELAY 20
+#define CONFIG_HC_MATRIX_ROTATION 0
+#define CONFIG_HC_MATRIX_ROTATION_0 1
+#define CONFIG_HC_MATRIX_TILES_X 1
+#define CONFIG_HC_MATRIX_TILES_Y 1
+#define CONFIG_HC_MATRIX_TILE_CHAIN_ROWS 1
+#define CONFIG_HC_MATRIX_TILE_INVERSED_MASK 0x0
+#define CONFIG_HC_STRIP_COLOR_ORDER_GRB 1
+#define CONFIG_HC_ANIM_MAX 8
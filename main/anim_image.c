@@ -0,0 +1,229 @@
+/* Animated images: palette-indexed frames with deltas, decoded one frame at a time.
+ * Layout of .hca file, all numbers are little-endian:
+ *   header   "HCA" and version byte 1, u8 width, u8 height, u8 bits per index, u8 palette size - 1,
+ *            u16 frame count, u16 reserved
+ *   palette  RGBA per entry, alpha is not premultiplied
+ *   frames   u16 delay in ms, u8 type, u8 reserved, u16 data size, then data:
+ *            keyframe - rows of packed indices like in .hci images,
+ *            delta    - spans of u8 y, u8 x, u8 length followed by its packed indices */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "anim_image.h"
+#include "image_utils.h"
+
+#define TAG "anim_image"
+
+#define HCA_MAGIC           "HCA\x01"
+#define HCA_HEADER_SIZE     12
+#define HCA_FRAME_HEADER    6
+
+#define FRAME_KEY   0
+#define FRAME_DELTA 1
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+// Parses animation at data, frames are used in place. Only the palette is allocated
+uint8_t anim_image_open(const uint8_t *data, size_t size, struct anim_image *img)
+{
+    memset(img, 0, sizeof(*img));
+    if (size < HCA_HEADER_SIZE || memcmp(data, HCA_MAGIC, 4) != 0) {
+        ESP_LOGE(TAG, "Not an animated image");
+        return 1;
+    }
+    img->width = data[4];
+    img->height = data[5];
+    img->bpp = data[6];
+    img->colors = data[7] + 1;
+    img->frame_count = read_u16(&data[8]);
+    size_t palette_size = img->colors * 4;
+    if ((img->bpp != 1 && img->bpp != 2 && img->bpp != 4 && img->bpp != 8) || img->colors > (1 << img->bpp) ||
+        img->frame_count == 0 || size < HCA_HEADER_SIZE + palette_size) {
+        ESP_LOGE(TAG, "Invalid animated image header");
+        return 1;
+    }
+    img->frames = data + HCA_HEADER_SIZE + palette_size;
+    img->frames_size = size - HCA_HEADER_SIZE - palette_size;
+
+    // Frames must fit and the first one has to be a keyframe, so playback can always restart
+    size_t pos = 0;
+    for (uint16_t i = 0; i < img->frame_count; i++) {
+        if (pos + HCA_FRAME_HEADER > img->frames_size ||
+            pos + HCA_FRAME_HEADER + read_u16(&img->frames[pos + 4]) > img->frames_size ||
+            (i == 0 && img->frames[pos + 2] != FRAME_KEY)) {
+            ESP_LOGE(TAG, "Animated image is truncated");
+            return 1;
+        }
+        pos += HCA_FRAME_HEADER + read_u16(&img->frames[pos + 4]);
+    }
+
+    crgb *palette = pvPortMalloc(img->colors * sizeof(crgb));
+    uint8_t *inv_alpha = pvPortMalloc(img->colors);
+    if (palette == NULL || inv_alpha == NULL) {
+        ESP_LOGE(TAG, "Out of memory!");
+        vPortFree(palette);
+        vPortFree(inv_alpha);
+        return 1;
+    }
+    bool opaque = true;
+    for (uint16_t i = 0; i < img->colors; i++) {
+        const uint8_t *px = &data[HCA_HEADER_SIZE + i * 4];
+        crgb color = { mul_div255(px[0], px[3]), mul_div255(px[1], px[3]), mul_div255(px[2], px[3]) };
+        palette[i] = color;
+        inv_alpha[i] = 255 - px[3];
+        if (px[3] != 255)
+            opaque = false;
+    }
+    if (opaque) {
+        vPortFree(inv_alpha);
+        inv_alpha = NULL;
+    }
+    img->palette = palette;
+    img->alpha = inv_alpha;
+    return 0;
+}
+
+// Reads the whole .hca file, encoded frames are much smaller than decoded ones
+uint8_t anim_image_load_file(const char *filename, struct anim_image *img)
+{
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to load %s!", filename);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = size > 0 ? pvPortMalloc(size) : NULL;
+    if (data == NULL || fread(data, 1, size, f) != size || anim_image_open(data, size, img)) {
+        ESP_LOGE(TAG, "Failed to load %s!", filename);
+        vPortFree(data);
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+    img->data = data;
+    return 0;
+}
+
+void anim_image_free(struct anim_image *img)
+{
+    vPortFree((void *)img->palette);
+    vPortFree((void *)img->alpha);
+    vPortFree(img->data);
+    memset(img, 0, sizeof(*img));
+}
+
+// Writes len packed indices into frame, returns 1 if some of them are out of palette
+static uint8_t unpack_indices(const struct anim_image *img, const uint8_t *src, uint8_t len, uint8_t *dst)
+{
+    for (uint8_t i = 0; i < len; i++) {
+        dst[i] = image_index(src, img->bpp, i);
+        if (dst[i] >= img->colors)
+            return 1;
+    }
+    return 0;
+}
+
+// Applies the frame at dec->pos to the decoded one
+static uint8_t decode_frame(struct anim_image_decoder *dec)
+{
+    const struct anim_image *img = dec->img;
+    const uint8_t *hdr = &img->frames[dec->pos];
+    const uint8_t *p = hdr + HCA_FRAME_HEADER;
+    const uint8_t *end = p + read_u16(&hdr[4]);
+    size_t stride = (img->width * img->bpp + 7) / 8;
+
+    if (hdr[2] == FRAME_KEY) {
+        if (end - p < stride * img->height)
+            return 1;
+        for (uint8_t y = 0; y < img->height; y++)
+            if (unpack_indices(img, &p[y * stride], img->width, &dec->frame[y * img->width]))
+                return 1;
+    } else {
+        while (p < end) {
+            if (end - p < 3)
+                return 1;
+            uint8_t y = p[0], x = p[1], len = p[2];
+            size_t span_size = (len * img->bpp + 7) / 8;
+            p += 3;
+            if (y >= img->height || x + len > img->width || end - p < span_size)
+                return 1;
+            if (unpack_indices(img, p, len, &dec->frame[y * img->width + x]))
+                return 1;
+            p += span_size;
+        }
+    }
+    dec->delay_ms = read_u16(&hdr[0]);
+    dec->pos = end - img->frames;
+    return 0;
+}
+
+// Allocates one frame and decodes the first one into it
+uint8_t anim_image_decoder_init(struct anim_image_decoder *dec, const struct anim_image *img)
+{
+    dec->img = img;
+    dec->index = 0;
+    dec->pos = 0;
+    dec->frame = pvPortMalloc(img->width * img->height);
+    if (dec->frame == NULL) {
+        ESP_LOGE(TAG, "Out of memory!");
+        return 1;
+    }
+    if (decode_frame(dec)) {
+        ESP_LOGE(TAG, "Corrupted frame 0");
+        anim_image_decoder_free(dec);
+        return 1;
+    }
+    return 0;
+}
+
+// Moves to the next frame, after the last one playback restarts from the first keyframe
+uint8_t anim_image_next_frame(struct anim_image_decoder *dec)
+{
+    if (++dec->index == dec->img->frame_count) {
+        dec->index = 0;
+        dec->pos = 0;
+    }
+    if (decode_frame(dec)) {
+        ESP_LOGE(TAG, "Corrupted frame %d", dec->index);
+        return 1;
+    }
+    return 0;
+}
+
+void anim_image_decoder_free(struct anim_image_decoder *dec)
+{
+    vPortFree(dec->frame);
+    dec->frame = NULL;
+}
+
+// Blends the decoded frame into out with its top left corner at x, y
+void anim_image_draw(const struct anim_image_decoder *dec, crgb *out, uint8_t out_width, uint8_t out_height,
+                     int16_t x, int16_t y)
+{
+    const struct anim_image *img = dec->img;
+    int16_t x1 = MAX(x, 0), x2 = MIN(x + img->width, out_width) - 1;
+    int16_t y1 = MAX(y, 0), y2 = MIN(y + img->height, out_height) - 1;
+    for (int16_t cy = y1; cy <= y2; cy++) {
+        const uint8_t *src = &dec->frame[(cy - y) * img->width];
+        crgb *dst = &out[cy * out_width];
+        for (int16_t cx = x1; cx <= x2; cx++) {
+            uint8_t idx = src[cx - x];
+            uint8_t inv_alpha = img->alpha != NULL ? img->alpha[idx] : 0;
+            if (inv_alpha == 255)
+                continue;
+            const crgb *color = &img->palette[idx];
+            dst[cx].r = color->r + mul_div255(dst[cx].r, inv_alpha);
+            dst[cx].g = color->g + mul_div255(dst[cx].g, inv_alpha);
+            dst[cx].b = color->b + mul_div255(dst[cx].b, inv_alpha);
+        }
+    }
+}
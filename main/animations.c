@@ -1,33 +1,474 @@
-/* Animations that can be used inside apps */
+/* Animations that can be used inside apps.
+ * They never touch the app canvas: every frame the render task computes the output
+ * from the presented canvas (and the snapshot for crossfades), so apps keep drawing and
+ * handling events while animations run. Animations ending at their identity
+ * (full brightness, no offset, white tint) are removed, others hold the final value
+ * until cancelled or retargeted. Animated images are played on top of the canvas content,
+ * the render task is woken up only when their next frame is due */
 
+#include <stdint.h>
+#include <string.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "anim_image.h"
 #include "animations.h"
-#include "framebuffer.h"
-#include "app_manager.h"
+#include "render.h"
+#include "sdkconfig.h"
 
-void anim_fade_out(struct canvas *cv, uint32_t duration_ms, uint32_t delay_ms)
+#define TAG "animations"
+
+// Progress and eased values are 0..ANIM_ONE
+#define ANIM_ONE    256
+
+enum anim_type {
+    ANIM_CROSSFADE = 0,
+    ANIM_FADE,
+    ANIM_MOVE,
+    ANIM_COLOR,
+    ANIM_IMAGE
+};
+
+// Shortest frame delay of animated images
+#define IMAGE_MIN_DELAY_US  10000
+
+struct anim {
+    struct canvas *cv;      // NULL for unused slots
+    uint8_t type;
+    uint8_t ease;
+    uint8_t flags;
+    uint8_t gen;            // Makes handles of finished animations stale
+    int64_t start_us;
+    int64_t duration_us;
+    int16_t from[3];
+    int16_t to[3];
+    crgb *snapshot;         // Crossfade only: what was on screen when it started
+    struct anim_image_decoder *decoder;     // Image only, from[] holds its position
+    int64_t next_us;        // Image only: when its next frame is due
+};
+
+static struct anim anims[CONFIG_HC_ANIM_MAX];
+static SemaphoreHandle_t anim_mutex = NULL;
+
+void anim_init(void)
+{
+    anim_mutex = xSemaphoreCreateMutex();
+}
+
+static uint16_t ease_value(uint8_t ease, uint16_t p)
+{
+    uint16_t q = ANIM_ONE - p;
+    switch (ease) {
+        case ANIM_EASE_IN:
+            return p * p / ANIM_ONE;
+        case ANIM_EASE_OUT:
+            return ANIM_ONE - q * q / ANIM_ONE;
+        case ANIM_EASE_IN_OUT:
+            return p < ANIM_ONE / 2 ? p * p * 2 / ANIM_ONE : ANIM_ONE - q * q * 2 / ANIM_ONE;
+        default:
+            return p;
+    }
+}
+
+// Eased progress at the moment now, done is set once the animation reached its end
+static uint16_t anim_progress(const struct anim *a, int64_t now, bool *done)
+{
+    int64_t elapsed = now - a->start_us;
+    *done = false;
+    if (elapsed < 0)
+        return 0;
+    if (a->duration_us <= 0) {
+        *done = true;
+        return ANIM_ONE;
+    }
+
+    uint16_t p;
+    if (a->flags & ANIM_LOOP) {
+        int64_t cycle = elapsed / a->duration_us;
+        p = (elapsed % a->duration_us) * ANIM_ONE / a->duration_us;
+        if (cycle & 1)
+            p = ANIM_ONE - p;
+    } else if (elapsed >= a->duration_us) {
+        *done = true;
+        p = ANIM_ONE;
+    } else {
+        p = elapsed * ANIM_ONE / a->duration_us;
+    }
+    return ease_value(a->ease, p);
+}
+
+static void anim_value(const struct anim *a, uint16_t e, int16_t value[3])
+{
+    for (uint8_t i = 0; i < 3; i++)
+        value[i] = a->from[i] + (a->to[i] - a->from[i]) * e / ANIM_ONE;
+}
+
+static bool is_identity(const struct anim *a)
+{
+    switch (a->type) {
+        case ANIM_IMAGE:
+            return false;
+        case ANIM_FADE:
+            return a->to[0] == 255;
+        case ANIM_MOVE:
+            return a->to[0] == 0 && a->to[1] == 0;
+        case ANIM_COLOR:
+            return a->to[0] == 255 && a->to[1] == 255 && a->to[2] == 255;
+        default:
+            return true;
+    }
+}
+
+static void anim_free(struct anim *a)
 {
-    uint32_t max_brightness = duration_ms / delay_ms;
-    uint32_t brightness = max_brightness;
-    while (brightness-- > 0) {
-        // Dim all pixels in canvas
-        for (uint32_t i = 0; i < (cv->width * cv->height); i++)
-            cv->buf[i] = crgb_mult(cv->buf[i], (float)brightness / (float)max_brightness);
+    vPortFree(a->snapshot);
+    a->snapshot = NULL;
+    if (a->decoder != NULL) {
+        anim_image_decoder_free(a->decoder);
+        vPortFree(a->decoder);
+        a->decoder = NULL;
+    }
+    a->cv = NULL;
+}
 
-        am_send_msg(AM_MSG_REFRESH);
-        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+// Moves image to the frame shown at the moment now. Without ANIM_LOOP the last frame is held,
+// returns when the next frame is due
+static int64_t image_advance(struct anim *a, int64_t now)
+{
+    struct anim_image_decoder *dec = a->decoder;
+    for (uint16_t i = 0; i < dec->img->frame_count && now >= a->next_us; i++) {
+        if (!(a->flags & ANIM_LOOP) && dec->index == dec->img->frame_count - 1)
+            return INT64_MAX;
+        if (anim_image_next_frame(dec))
+            return INT64_MAX;
+        a->next_us += MAX((int64_t)dec->delay_ms * 1000, IMAGE_MIN_DELAY_US);
     }
+    // Far behind (the canvas wasn't shown for a while), go on from the current frame
+    if (now >= a->next_us)
+        a->next_us = now + MAX((int64_t)dec->delay_ms * 1000, IMAGE_MIN_DELAY_US);
+    return a->next_us;
 }
 
-void anim_fade_in(struct canvas *cv, struct canvas *cv_new, uint32_t duration_ms, uint32_t delay_ms)
+// Renders pixels of cv with all its animations at the moment now into out.
+// Finished animations are removed. Returns when the next frame is needed:
+// now if some of them are still running, INT64_MAX if none is
+static int64_t apply_locked(struct canvas *cv, const crgb *pixels, crgb *out, int64_t now)
 {
-    uint32_t max_brightness = duration_ms / delay_ms;
-    uint32_t brightness = 0;
-    while (brightness++ < max_brightness) {
-        for (uint32_t i = 0; i < (cv->width * cv->height); i++)
-            cv->buf[i] = crgb_mult(cv_new->buf[i], (float)brightness / (float)max_brightness);
+    const struct anim *crossfade = NULL;
+    uint16_t blend = ANIM_ONE;
+    int16_t dx = 0, dy = 0;
+    uint8_t scale[3] = { 255, 255, 255 };
+    int64_t next_us = INT64_MAX;
+    const crgb *src = pixels;
 
-        am_send_msg(AM_MSG_REFRESH);
-        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    for (uint8_t i = 0; i < CONFIG_HC_ANIM_MAX; i++) {
+        struct anim *a = &anims[i];
+        if (a->cv != cv)
+            continue;
+        if (a->type == ANIM_IMAGE) {
+            // Images become part of the content, other effects apply to them as well
+            if (src == pixels) {
+                memcpy(out, pixels, cv->width * cv->height * sizeof(crgb));
+                src = out;
+            }
+            next_us = MIN(next_us, image_advance(a, now));
+            anim_image_draw(a->decoder, out, cv->width, cv->height, a->from[0], a->from[1]);
+            continue;
+        }
+        bool done;
+        uint16_t e = anim_progress(a, now, &done);
+        int16_t v[3];
+        anim_value(a, e, v);
+        switch (a->type) {
+            case ANIM_CROSSFADE:
+                crossfade = a;
+                blend = e;
+                break;
+            case ANIM_FADE:
+                for (uint8_t c = 0; c < 3; c++)
+                    scale[c] = mul_div255(scale[c], v[0]);
+                break;
+            case ANIM_MOVE:
+                dx += v[0];
+                dy += v[1];
+                break;
+            case ANIM_COLOR:
+                for (uint8_t c = 0; c < 3; c++)
+                    scale[c] = mul_div255(scale[c], v[c]);
+                break;
+        }
+        if (!done)
+            next_us = now;
+    }
+
+    bool tinted = scale[0] != 255 || scale[1] != 255 || scale[2] != 255;
+    // Source may be out itself, then pixels are walked away from the shift
+    // so every one is read before it's overwritten
+    bool backwards = dy > 0 || (dy == 0 && dx > 0);
+    size_t count = cv->width * cv->height;
+    for (size_t n = 0; n < count; n++) {
+        size_t i = backwards ? count - 1 - n : n;
+        int16_t x = i % cv->width;
+        int16_t y = i / cv->width;
+        int16_t sx = x - dx;
+        int16_t sy = y - dy;
+        crgb px = { 0, 0, 0 };
+        if (sx >= 0 && sx < cv->width && sy >= 0 && sy < cv->height)
+            px = src[sy * cv->width + sx];
+        if (crossfade != NULL) {
+            // Always computed from the snapshot, so nothing is accumulated between frames
+            crgb old = crossfade->snapshot[y * cv->width + x];
+            px.r = old.r + (px.r - old.r) * blend / ANIM_ONE;
+            px.g = old.g + (px.g - old.g) * blend / ANIM_ONE;
+            px.b = old.b + (px.b - old.b) * blend / ANIM_ONE;
+        }
+        if (tinted) {
+            px.r = mul_div255(px.r, scale[0]);
+            px.g = mul_div255(px.g, scale[1]);
+            px.b = mul_div255(px.b, scale[2]);
+        }
+        out[i] = px;
+    }
+
+    // Crossfades end with the canvas itself, value animations only if they end at identity
+    for (uint8_t i = 0; i < CONFIG_HC_ANIM_MAX; i++) {
+        struct anim *a = &anims[i];
+        if (a->cv != cv)
+            continue;
+        bool done;
+        anim_progress(a, now, &done);
+        if (done && is_identity(a))
+            anim_free(a);
+    }
+    return next_us;
+}
+
+static anim_t anim_start(struct canvas *cv, uint8_t type, const int16_t from[3], const int16_t to[3],
+                         uint32_t duration_ms, enum anim_ease ease, uint8_t flags, crgb *snapshot,
+                         struct anim_image_decoder *decoder)
+{
+    anim_t handle = -1;
+    xSemaphoreTake(anim_mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < CONFIG_HC_ANIM_MAX; i++) {
+        struct anim *a = &anims[i];
+        if (a->cv != NULL)
+            continue;
+        a->cv = cv;
+        a->type = type;
+        a->ease = ease;
+        a->flags = flags;
+        a->gen = (a->gen + 1) & 0x7f;
+        a->start_us = esp_timer_get_time();
+        a->duration_us = (int64_t)duration_ms * 1000;
+        memcpy(a->from, from, sizeof(a->from));
+        memcpy(a->to, to, sizeof(a->to));
+        a->snapshot = snapshot;
+        a->decoder = decoder;
+        if (decoder != NULL)
+            a->next_us = a->start_us + MAX((int64_t)decoder->delay_ms * 1000, IMAGE_MIN_DELAY_US);
+        handle = (a->gen << 8) | i;
+        break;
+    }
+    xSemaphoreGive(anim_mutex);
+
+    if (handle < 0) {
+        ESP_LOGE(TAG, "No free animation slots!");
+        vPortFree(snapshot);
+        if (decoder != NULL) {
+            anim_image_decoder_free(decoder);
+            vPortFree(decoder);
+        }
+        return -1;
+    }
+    render_request();
+    return handle;
+}
+
+// Returns animation by handle, NULL if it's already finished. Must be called with anim_mutex taken
+static struct anim *anim_get(anim_t anim)
+{
+    if (anim < 0 || (anim & 0xff) >= CONFIG_HC_ANIM_MAX)
+        return NULL;
+    struct anim *a = &anims[anim & 0xff];
+    if (a->cv == NULL || a->gen != (anim >> 8))
+        return NULL;
+    return a;
+}
+
+// Blends from what is on screen now into the canvas content. Call it before drawing new content.
+// The snapshot is taken from the presented frame, anything drawn but not presented yet fades in.
+// Other effects of the canvas are frozen into the snapshot and removed,
+// so starting a crossfade in the middle of another one continues smoothly. Images keep playing
+anim_t anim_crossfade(struct canvas *cv, uint32_t duration_ms, enum anim_ease ease)
+{
+    crgb *snapshot = pvPortMalloc(cv->width * cv->height * sizeof(crgb));
+    if (snapshot == NULL) {
+        ESP_LOGE(TAG, "Out of memory!");
+        return -1;
     }
+    // Same lock order as the render task: front first, then animations
+    const crgb *pixels = cv_lock_front(cv, NULL);
+    xSemaphoreTake(anim_mutex, portMAX_DELAY);
+    apply_locked(cv, pixels, snapshot, esp_timer_get_time());
+    for (uint8_t i = 0; i < CONFIG_HC_ANIM_MAX; i++)
+        if (anims[i].cv == cv && anims[i].type != ANIM_IMAGE)
+            anim_free(&anims[i]);
+    xSemaphoreGive(anim_mutex);
+    cv_unlock_front(cv);
+
+    const int16_t none[3] = { 0 };
+    return anim_start(cv, ANIM_CROSSFADE, none, none, duration_ms, ease, 0, snapshot, NULL);
+}
+
+// Scales brightness of the canvas from one level to another, 255 is the original brightness
+anim_t anim_fade(struct canvas *cv, uint8_t from, uint8_t to, uint32_t duration_ms, enum anim_ease ease, uint8_t flags)
+{
+    const int16_t v_from[3] = { from };
+    const int16_t v_to[3] = { to };
+    return anim_start(cv, ANIM_FADE, v_from, v_to, duration_ms, ease, flags, NULL, NULL);
+}
+
+// Shifts the canvas content, uncovered pixels are black
+anim_t anim_move(struct canvas *cv, int8_t dx_from, int8_t dy_from, int8_t dx_to, int8_t dy_to,
+                 uint32_t duration_ms, enum anim_ease ease)
+{
+    const int16_t v_from[3] = { dx_from, dy_from };
+    const int16_t v_to[3] = { dx_to, dy_to };
+    return anim_start(cv, ANIM_MOVE, v_from, v_to, duration_ms, ease, 0, NULL, NULL);
+}
+
+// Multiplies the canvas by a color, white keeps the original colors
+anim_t anim_color(struct canvas *cv, crgb from, crgb to, uint32_t duration_ms, enum anim_ease ease)
+{
+    const int16_t v_from[3] = { from.r, from.g, from.b };
+    const int16_t v_to[3] = { to.r, to.g, to.b };
+    return anim_start(cv, ANIM_COLOR, v_from, v_to, duration_ms, ease, 0, NULL, NULL);
+}
+
+// Plays animated image on top of the canvas with its top left corner at x, y.
+// With ANIM_LOOP it starts over after the last frame, otherwise the last frame stays until cancelled.
+// img must stay valid while the animation exists
+anim_t anim_play(struct canvas *cv, const struct anim_image *img, int16_t x, int16_t y, uint8_t flags)
+{
+    struct anim_image_decoder *decoder = pvPortMalloc(sizeof(*decoder));
+    if (decoder == NULL) {
+        ESP_LOGE(TAG, "Out of memory!");
+        return -1;
+    }
+    if (anim_image_decoder_init(decoder, img)) {
+        vPortFree(decoder);
+        return -1;
+    }
+    const int16_t pos[3] = { x, y };
+    return anim_start(cv, ANIM_IMAGE, pos, pos, 0, ANIM_EASE_LINEAR, flags, NULL, decoder);
+}
+
+// Restarts animation from its current value to a new one
+static bool anim_retarget(anim_t anim, uint8_t type, const int16_t to[3], uint32_t duration_ms)
+{
+    xSemaphoreTake(anim_mutex, portMAX_DELAY);
+    struct anim *a = anim_get(anim);
+    bool ok = a != NULL && a->type == type;
+    if (ok) {
+        int64_t now = esp_timer_get_time();
+        bool done;
+        anim_value(a, anim_progress(a, now, &done), a->from);
+        memcpy(a->to, to, sizeof(a->to));
+        a->start_us = now;
+        a->duration_us = (int64_t)duration_ms * 1000;
+        a->flags &= ~ANIM_LOOP;
+    }
+    xSemaphoreGive(anim_mutex);
+    if (ok)
+        render_request();
+    return ok;
+}
+
+bool anim_fade_to(anim_t anim, uint8_t to, uint32_t duration_ms)
+{
+    const int16_t v_to[3] = { to };
+    return anim_retarget(anim, ANIM_FADE, v_to, duration_ms);
+}
+
+bool anim_move_to(anim_t anim, int8_t dx, int8_t dy, uint32_t duration_ms)
+{
+    const int16_t v_to[3] = { dx, dy };
+    return anim_retarget(anim, ANIM_MOVE, v_to, duration_ms);
+}
+
+bool anim_color_to(anim_t anim, crgb to, uint32_t duration_ms)
+{
+    const int16_t v_to[3] = { to.r, to.g, to.b };
+    return anim_retarget(anim, ANIM_COLOR, v_to, duration_ms);
+}
+
+// Removes animation immediately, the canvas is shown as is from the next frame
+void anim_cancel(anim_t anim)
+{
+    xSemaphoreTake(anim_mutex, portMAX_DELAY);
+    struct anim *a = anim_get(anim);
+    if (a != NULL)
+        anim_free(a);
+    xSemaphoreGive(anim_mutex);
+    render_request();
+}
+
+// Removes all animations of cv, before the canvas is freed
+void anim_cancel_all(struct canvas *cv)
+{
+    xSemaphoreTake(anim_mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < CONFIG_HC_ANIM_MAX; i++) {
+        if (anims[i].cv == cv)
+            anim_free(&anims[i]);
+    }
+    xSemaphoreGive(anim_mutex);
+}
+
+bool anim_is_active(struct canvas *cv)
+{
+    bool active = false;
+    xSemaphoreTake(anim_mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < CONFIG_HC_ANIM_MAX && !active; i++)
+        active = anims[i].cv == cv;
+    xSemaphoreGive(anim_mutex);
+    return active;
+}
+
+// True while an animation of cv still changes the picture: a tween before its end or an image
+// with frames left. Finished ones holding their last value or frame don't count
+bool anim_is_running(struct canvas *cv)
+{
+    bool running = false;
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(anim_mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < CONFIG_HC_ANIM_MAX && !running; i++) {
+        const struct anim *a = &anims[i];
+        if (a->cv != cv)
+            continue;
+        if (a->type == ANIM_IMAGE) {
+            running = (a->flags & ANIM_LOOP) || a->decoder->index < a->decoder->img->frame_count - 1;
+        } else {
+            bool done;
+            anim_progress(a, now, &done);
+            running = !done;
+        }
+    }
+    xSemaphoreGive(anim_mutex);
+    return running;
+}
+
+// Called from the render task: puts presented pixels of cv with its animations into out
+// and keeps frames coming while any of them is running or an image frame is pending
+void anim_apply(struct canvas *cv, const crgb *pixels, crgb *out)
+{
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(anim_mutex, portMAX_DELAY);
+    int64_t next_us = apply_locked(cv, pixels, out, now);
+    xSemaphoreGive(anim_mutex);
+    if (next_us <= now)
+        render_request();
+    else if (next_us != INT64_MAX)
+        render_request_at(next_us);
 }
@@ -1,9 +1,17 @@
 #include <stdint.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "animations.h"
 #include "app_manager.h"
 #include "canvas.h"
 #include "framebuffer.h"
+#include "metrics.h"
+#include "overlay.h"
+#include "render.h"
 #include "sdkconfig.h"
 
 #define TAG "app_manager"
@@ -12,52 +20,373 @@
 #define APP_STACK_SIZE      (8 * 1024)
 #define AM_TASK_PRIORITY    (tskIDLE_PRIORITY + 3)
 #define AM_WIN_PRIORITY     (tskIDLE_PRIORITY + 2)
+#define AM_WARM_PRIORITY    (tskIDLE_PRIORITY + 1)
+
+// Hidden apps are checked for hibernation this often (in ms)
+#define HIBERNATE_CHECK_PERIOD  5000
+
+// Sent to AM by window_hibernated(), next to AM_MSG_* bits
+#define AM_MSG_HIBERNATED   0x80000000
+// Set when some window gets its first frame or fails to start
+#define AM_FIRST_FRAME_BIT  (1 << 0)
+
+// What AM wants from the app of a window
+enum am_win_level {
+    WIN_HIDDEN = 0,
+    WIN_WARM,       // Neighbour of the current window, runs slowly to keep its canvas current
+    WIN_SHOWN
+};
 
 struct am_window_data
 {
-    TaskHandle_t handle;
-    struct canvas *canvas;
+    TaskHandle_t handle;        // Task of task-based app, NULL for cooperative ones
+    struct canvas *canvas;      // NULL until the app is started and while it hibernates
+    int64_t hidden_us;          // When the window was hidden last time
+    volatile bool hibernating;  // Asked to hibernate, cleared by the app side once the canvas is freed
+    volatile bool ready;        // Canvas holds a frame presented by the app since it started
+
+    // Cooperative apps, owned by the app loop
+    void *state;
+    int64_t next_tick_us;
+    enum am_app_state status;   // Task-based apps: AM_APP_HIBERNATED after hibernation only
+    bool failed;                // init() failed, the app isn't started again
+    bool slowed;                // Ticks are slowed down as the window is warm or idle
+    int64_t active_us;          // Last input event or running animation
+    volatile enum am_win_level level;   // Set by AM, the loop starts, resumes or suspends the app to match
+    struct event_queue events;  // Consumed by the app task or the app loop
+
+    // Activity for stats, changed under loop_lock
+    uint32_t wakeups;
+    uint64_t busy_us;
+    int64_t wake_us;            // Task-based apps: when am_event_wait() returned, 0 while waiting
 };
 
 static TaskHandle_t am_handle = NULL;
+static EventGroupHandle_t first_frame_group = NULL;
 static struct am_window_data win_data[CONFIG_HC_AM_MAX_APPS];
 static struct am_app_info *app_info = NULL;
 static uint8_t win_idx = 0;
+static uint8_t win_count = 0;
+
+// Single task running all cooperative apps
+static TaskHandle_t loop_handle = NULL;
+static portMUX_TYPE loop_lock = portMUX_INITIALIZER_UNLOCKED;
+static int8_t loop_app = -1;    // Window whose callbacks are running
+
+// Slide animation state, read by the render task
+static struct {
+    struct canvas *cv_l;
+    struct canvas *cv_r;
+    uint8_t offset;
+    bool active;
+    bool redraw;
+    int64_t last_frame_us;  // For metrics, 0 before the first frame
+    int64_t switch_us;      // For metrics, when switch to window switch_idx was requested, 0 if none
+    uint8_t switch_idx;
+} slide;
+
+// Canvas whose front buffer was sent directly last time, owned by the render task
+static struct canvas *presented = NULL;
+// Output of animations of the current window, owned by the render task
+static struct canvas *anim_cv = NULL;
+
+// Switch latency ends with the first frame showing the new window drawn by its app
+static void switch_presented(int64_t start)
+{
+    if (slide.switch_us != 0 && win_idx == slide.switch_idx && win_data[win_idx].ready) {
+        metrics_stage_add(METRICS_STAGE_SWITCH, start - slide.switch_us);
+        slide.switch_us = 0;
+    }
+}
 
-static void redraw_fb(struct framebuffer *fb, struct canvas *cv)
+// Render task callback, presents the current window (or slide animation) with overlays
+static void present_fb(struct framebuffer *fb)
 {
-    // TODO: rewrite framebuffer and remove this shit
-    for (uint8_t y = 0; y < cv->height; y++)
-        for (uint8_t x = 0; x < cv->width; x++)
-            fb->buf[y][x] = cv->buf[y * cv->width + x];
+    if (slide.active) {
+        int64_t start = metrics_start();
+        cv_draw_slide_to_fb(fb, slide.cv_l, slide.cv_r, slide.offset);
+        overlay_blend_fb(fb);
+        metrics_stage_end(METRICS_STAGE_COMPOSE, start);
+        if (slide.last_frame_us != 0) {
+            int64_t interval = start - slide.last_frame_us;
+            metrics_stage_add(METRICS_STAGE_SLIDE_INTERVAL, interval);
+            if (interval > (CONFIG_HC_AM_SLIDE_FRAME_DELAY + portTICK_PERIOD_MS) * 1000)
+                metrics_add(METRICS_SLIDE_OVERRUNS, 1);
+        }
+        slide.last_frame_us = start;
+        switch_presented(start);
+        metrics_add(METRICS_SLIDE_FRAMES, 1);
+        fb_refresh(fb);
+        slide.redraw = true;
+        presented = NULL;
+        return;
+    }
+
+    struct canvas *cv = win_data[win_idx].canvas;
+    bool full = slide.redraw;
+    slide.redraw = false;
+    slide.last_frame_us = 0;
+    switch_presented(metrics_start());
+    if (anim_is_active(cv)) {
+        // Animations are computed from the presented frame, the app canvas itself is never touched
+        int64_t start = metrics_start();
+        struct cv_rect unused;
+        const crgb *pixels = cv_lock_front(cv, &unused);
+        anim_apply(cv, pixels, anim_cv->buf);
+        cv_unlock_front(cv);
+        metrics_stage_end(METRICS_STAGE_ANIM, start);
+        cv_mark_dirty_all(anim_cv);
+        cv = anim_cv;
+        full = true;
+    }
+    int64_t start = metrics_start();
+    if (overlay_compose(fb, cv, full)) {
+        metrics_stage_end(METRICS_STAGE_COMPOSE, start);
+        fb_refresh(fb);
+        presented = NULL;
+        return;
+    }
 
+    // No overlays, LEDs are fed straight from the front buffer of canvas. It stays locked
+    // until the frame is encoded, so the app can't swap it in the middle
+    struct cv_rect d;
+    const crgb *pixels = cv_lock_front(cv, &d);
+    if (presented == cv && !full) {
+        // Both buffers of canvas hold the same frame except the changed area,
+        // so flipping between them doesn't need a full resend
+        fb->src = pixels;
+        if (d.x1 <= d.x2)
+            fb_mark_dirty(fb, d.y1, d.y2);
+    } else {
+        fb_set_source(fb, pixels);
+        fb_mark_dirty_all(fb);
+    }
     fb_refresh(fb);
+    cv_unlock_front(cv);
+    presented = cv;
 }
 
-static void play_slide_anim(struct framebuffer *fb, struct canvas *cv_l, struct canvas *cv_r, bool dir)
+// Slides from the current window to new_idx one, the new window becomes current
+static void play_slide_anim(uint8_t new_idx)
 {
+    bool dir = new_idx > win_idx;
+    struct canvas *cv_l = win_data[dir ? win_idx : new_idx].canvas;
+    struct canvas *cv_r = win_data[dir ? new_idx : win_idx].canvas;
     uint8_t width = cv_l->width;
-    uint8_t height = cv_l->height;
     uint8_t off_start = dir ? 1 : (width - 1);
     uint8_t off_end = dir ? width : 0;
 
-    for (int8_t off = off_start; (dir ? off <= off_end: off >= off_end); (dir ? off++ : off--)) {
-        // Draw the left canvas with start offset
-        for (uint8_t y = 0; y < height; y++)
-            for (uint8_t x = off; x < width; x++)
-                fb->buf[y][x - off] = cv_l->buf[y * width + x];
-        
-        // Draw the right canvas on the rest of FB
-        for (uint8_t y = 0; y < height; y++)
-            for (uint8_t x = 0; x < off; x++)
-                fb->buf[y][width - off + x] = cv_r->buf[y * width + x];
+    slide.cv_l = cv_l;
+    slide.cv_r = cv_r;
+    slide.offset = off_start;
+    slide.active = true;
+    // Switch only when the render task doesn't look at the window anymore
+    win_idx = new_idx;
 
-        fb_refresh(fb);
-        vTaskDelay(pdMS_TO_TICKS(CONFIG_HC_AM_SLIDE_FRAME_DELAY));
+    TickType_t last_wake = xTaskGetTickCount();
+    for (int16_t off = off_start; (dir ? off <= off_end : off >= off_end); (dir ? off++ : off--)) {
+        slide.offset = off;
+        render_request();
+        xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONFIG_HC_AM_SLIDE_FRAME_DELAY));
+    }
+
+    // Framebuffer holds the last slide frame, so the new window is redrawn fully (see present_fb)
+    slide.active = false;
+    render_request();
+}
+
+static void window_alloc_canvas(struct am_window_data *win)
+{
+    win->canvas = cv_init(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT);
+    // Apps draw into the back buffer while the render task sends the front one to LEDs
+    cv_enable_double_buffer(win->canvas);
+    win->ready = false;
+}
+
+// Frees the canvas of a hidden window once its app hibernated, called from the app side
+static void window_hibernated(struct am_window_data *win)
+{
+    anim_cancel_all(win->canvas);
+    cv_free(win->canvas);
+    portENTER_CRITICAL(&loop_lock);
+    win->canvas = NULL;
+    win->status = AM_APP_HIBERNATED;
+    win->handle = NULL;
+    win->hibernating = false;
+    win->wake_us = 0;
+    portEXIT_CRITICAL(&loop_lock);
+    // AM may be waiting to show the window again
+    xTaskNotify(am_handle, AM_MSG_HIBERNATED, eSetBits);
+}
+
+static bool window_hibernating(struct am_window_data *win)
+{
+    portENTER_CRITICAL(&loop_lock);
+    bool hibernating = win->hibernating;
+    portEXIT_CRITICAL(&loop_lock);
+    return hibernating;
+}
+
+// Wakes whoever takes events of window idx. The task handle is read under loop_lock,
+// so a hibernating task can't be deleted in between
+static void window_notify(uint8_t idx)
+{
+    if (app_info[idx].ops != NULL) {
+        xTaskNotifyGive(loop_handle);
+        return;
     }
+    portENTER_CRITICAL(&loop_lock);
+    if (win_data[idx].handle != NULL)
+        xTaskNotifyGive(win_data[idx].handle);
+    portEXIT_CRITICAL(&loop_lock);
 }
 
-static int launch_window_task(struct am_app_info info, struct am_window_data *data)
+// Counts wakeups of the app of win and the time it was busy
+static void activity_add(struct am_window_data *win, uint32_t wakeups, int64_t busy_us)
+{
+    portENTER_CRITICAL(&loop_lock);
+    win->wakeups += wakeups;
+    win->busy_us += busy_us;
+    portEXIT_CRITICAL(&loop_lock);
+}
+
+// Presents the canvas of window idx drawn by its app
+static void present_window(uint8_t idx)
+{
+    struct canvas *cv = win_data[idx].canvas;
+    if (cv_is_dirty(cv))
+        metrics_app_draw(idx, cv->draw_start_us);
+    cv_present(cv);
+    if (!win_data[idx].ready) {
+        win_data[idx].ready = true;
+        xEventGroupSetBits(first_frame_group, AM_FIRST_FRAME_BIT);
+    }
+}
+
+// Brings a cooperative app to the state AM wants and runs its pending events and ticks.
+// Returns time of the next tick, INT64_MAX if it isn't ticking
+static int64_t loop_run_window(uint8_t idx, int64_t now)
+{
+    struct am_window_data *win = &win_data[idx];
+    const struct am_app_ops *ops = app_info[idx].ops;
+    bool redraw = false;
+    bool woke = false;
+
+    loop_app = idx;
+    if (win->hibernating) {
+        if (win->status == AM_APP_RUNNING && ops->on_suspend != NULL)
+            ops->on_suspend(win->state);
+        if (win->status != AM_APP_STOPPED)
+            ops->on_hibernate(win->state);
+        win->state = NULL;
+        window_hibernated(win);
+        loop_app = -1;
+        return INT64_MAX;
+    }
+    bool active = win->level != WIN_HIDDEN;
+    if (active && (win->status == AM_APP_STOPPED || win->status == AM_APP_HIBERNATED) && !win->failed) {
+        if (ops->init != NULL && ops->init(win->canvas, &win->state) != 0) {
+            ESP_LOGE(TAG, "Failed to init %s", app_info[idx].name);
+            win->failed = true;
+            xEventGroupSetBits(first_frame_group, AM_FIRST_FRAME_BIT);
+        } else {
+            win->status = AM_APP_RUNNING;
+            win->next_tick_us = now;
+            win->active_us = now;
+            redraw = true;
+        }
+        woke = true;
+    } else if (active && win->status == AM_APP_SUSPENDED) {
+        win->status = AM_APP_RUNNING;
+        win->next_tick_us = now;
+        win->active_us = now;
+    } else if (!active && win->status == AM_APP_RUNNING) {
+        if (ops->on_suspend != NULL)
+            ops->on_suspend(win->state);
+        win->status = AM_APP_SUSPENDED;
+    }
+    if (win->status != AM_APP_RUNNING) {
+        loop_app = -1;
+        return INT64_MAX;
+    }
+
+    struct app_event event;
+    while (evq_pop(&win->events, &event)) {
+        if (event.type != EVENT_APP && event.type != EVENT_HIBERNATE)
+            win->active_us = now;
+        if (ops->on_event != NULL)
+            redraw |= ops->on_event(win->state, win->canvas, &event);
+        woke = true;
+    }
+
+    int64_t next = INT64_MAX;
+    if (ops->on_tick != NULL) {
+        int64_t period = ops->tick_ms * 1000LL;
+        bool slowed = false;
+        if (period > 0 && win->level == WIN_WARM) {
+            period = MAX(period, CONFIG_HC_AM_WARM_TICK_MS * 1000LL);
+            slowed = true;
+        } else if (period > 0 && ops->idle_tick_ms > 0) {
+            if (anim_is_running(win->canvas))
+                win->active_us = now;
+            if (now - win->active_us >= CONFIG_HC_AM_IDLE_TIME * 1000LL) {
+                period = MAX(period, ops->idle_tick_ms * 1000LL);
+                slowed = true;
+            }
+        }
+        // The rate goes up right away on switch, input or animation
+        if (win->slowed && !slowed)
+            win->next_tick_us = MIN(win->next_tick_us, now);
+        win->slowed = slowed;
+
+        if (now >= win->next_tick_us) {
+            int64_t due = win->next_tick_us;
+            // Apps changing on their own schedule ask for the next tick in on_tick()
+            win->next_tick_us = INT64_MAX;
+            redraw |= ops->on_tick(win->state, win->canvas);
+            // Late ticks aren't caught up
+            if (period > 0)
+                win->next_tick_us = MIN(win->next_tick_us, MAX(due + period, now));
+            woke = true;
+        }
+        next = win->next_tick_us;
+    }
+
+    if (redraw) {
+        if (ops->on_draw != NULL)
+            ops->on_draw(win->state, win->canvas);
+        present_window(idx);
+        // Frames of warm windows wait for the switch
+        if (idx == win_idx)
+            render_request();
+    }
+    if (woke)
+        activity_add(win, 1, esp_timer_get_time() - now);
+    loop_app = -1;
+    return next;
+}
+
+// Runs all cooperative apps, sleeps until the nearest tick or a notification from AM
+static void app_loop_task(void *param)
+{
+    const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+    while (1) {
+        int64_t next = INT64_MAX;
+        for (uint8_t i = 0; i < win_count; i++) {
+            if (app_info[i].ops != NULL)
+                next = MIN(next, loop_run_window(i, esp_timer_get_time()));
+        }
+
+        TickType_t timeout = portMAX_DELAY;
+        if (next != INT64_MAX) {
+            int64_t wait = next - esp_timer_get_time();
+            timeout = wait > 0 ? (wait + tick_us - 1) / tick_us : 0;
+        }
+        ulTaskNotifyTake(pdTRUE, timeout);
+    }
+}
+
+static int launch_window_task(struct am_app_info info, struct am_window_data *data, UBaseType_t priority)
 {
     ESP_LOGI(TAG, "Launching %s task", info.name);
     return xTaskCreate(
@@ -65,45 +394,226 @@ static int launch_window_task(struct am_app_info info, struct am_window_data *da
         info.name,
         APP_STACK_SIZE,
         data->canvas,
-        AM_WIN_PRIORITY,
+        priority,
         &data->handle
     );
 }
 
+// Starts or resumes the app of window idx, either shown or warm. Task-based apps get their own task,
+// running below the shown one while warm. Cooperative ones are switched by the app loop.
+// Returns false if the app is still hibernating, AM gets AM_MSG_HIBERNATED once it's done
+static bool app_show(uint8_t idx, enum am_win_level level)
+{
+    struct am_window_data *win = &win_data[idx];
+    // Apps release their resources quickly, unless a task is in the middle of blocking I/O
+    if (window_hibernating(win)) {
+        ESP_LOGI(TAG, "Waiting for %s to hibernate...", app_info[idx].name);
+        return false;
+    }
+    if (win->canvas == NULL)
+        window_alloc_canvas(win);
+    win->hidden_us = 0;
+    bool was_hidden = win->level == WIN_HIDDEN;
+    win->level = level;
+
+    UBaseType_t priority = level == WIN_WARM ? AM_WARM_PRIORITY : AM_WIN_PRIORITY;
+    const char *how = level == WIN_WARM ? "warm" : "shown";
+    if (app_info[idx].ops != NULL) {
+        ESP_LOGI(TAG, "Run %s %s...", app_info[idx].name, how);
+        xTaskNotifyGive(loop_handle);
+    } else if (win->handle == NULL) {
+        ESP_LOGI(TAG, "Start %s task %s...", app_info[idx].name, how);
+        launch_window_task(app_info[idx], win, priority);
+    } else {
+        if (was_hidden)
+            ESP_LOGI(TAG, "Resume %s task %s...", app_info[idx].name, how);
+        vTaskPrioritySet(win->handle, priority);
+        vTaskResume(win->handle);
+    }
+    return true;
+}
+
+static void app_hide(uint8_t idx)
+{
+    struct am_window_data *win = &win_data[idx];
+    if (win->level == WIN_HIDDEN)
+        return;
+    win->level = WIN_HIDDEN;
+    win->hidden_us = esp_timer_get_time();
+    if (app_info[idx].ops != NULL) {
+        ESP_LOGI(TAG, "Hide %s...", app_info[idx].name);
+        xTaskNotifyGive(loop_handle);
+    } else {
+        ESP_LOGI(TAG, "Suspend %s task...", app_info[idx].name);
+        vTaskSuspend(win->handle);
+    }
+}
+
+static bool can_hibernate(uint8_t idx)
+{
+    if (app_info[idx].ops != NULL)
+        return app_info[idx].ops->on_hibernate != NULL;
+    return app_info[idx].hibernate && win_data[idx].handle != NULL;
+}
+
+// Asks the app of hidden window idx to release everything but its minimal state.
+// The canvas is freed by the app loop or by the app task in am_app_hibernated().
+// Returns false if the request didn't fit into the event queue of the task
+static bool app_hibernate(uint8_t idx)
+{
+    struct am_window_data *win = &win_data[idx];
+    // Set before the app can see the request, window_hibernated() clears it
+    portENTER_CRITICAL(&loop_lock);
+    win->hibernating = true;
+    portEXIT_CRITICAL(&loop_lock);
+    ESP_LOGI(TAG, "Hibernate %s...", app_info[idx].name);
+    if (app_info[idx].ops == NULL) {
+        struct app_event event = { .type = EVENT_HIBERNATE, .count = 1, .time_us = esp_timer_get_time() };
+        if (!evq_push(&win->events, &event)) {
+            portENTER_CRITICAL(&loop_lock);
+            win->hibernating = false;
+            portEXIT_CRITICAL(&loop_lock);
+            return false;
+        }
+        // Suspended task has to run to clean up
+        vTaskResume(win->handle);
+    }
+    window_notify(idx);
+    return true;
+}
+
+// Hibernates hidden apps idle for CONFIG_HC_AM_HIBERNATE_TIMEOUT, all of them when heap runs low
+// and the least recently shown ones above CONFIG_HC_AM_MAX_LIVE_APPS. Warm neighbours are kept.
+// Returns ticks until the next check
+static TickType_t hibernate_check(void)
+{
+    const int64_t timeout_us = CONFIG_HC_AM_HIBERNATE_TIMEOUT * 1000000LL;
+    int64_t now = esp_timer_get_time();
+    bool low_heap = false;
+#if !CONFIG_IDF_TARGET_LINUX
+    low_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT) < CONFIG_HC_AM_HIBERNATE_MIN_HEAP;
+#endif
+
+    uint8_t live = 0;
+    for (uint8_t i = 0; i < win_count; i++) {
+        if (win_data[i].canvas != NULL && !window_hibernating(&win_data[i]))
+            live++;
+    }
+
+    bool pending;
+    while (1) {
+        int8_t lru = -1;
+        pending = false;
+        for (uint8_t i = 0; i < win_count; i++) {
+            struct am_window_data *win = &win_data[i];
+            if (win->level != WIN_HIDDEN || win->canvas == NULL || window_hibernating(win) || !can_hibernate(i))
+                continue;
+            if (low_heap || (timeout_us > 0 && now - win->hidden_us >= timeout_us)) {
+                if (app_hibernate(i))
+                    live--;
+                continue;
+            }
+            pending = true;
+            if (lru < 0 || win->hidden_us < win_data[lru].hidden_us)
+                lru = i;
+        }
+        if (CONFIG_HC_AM_MAX_LIVE_APPS == 0 || live <= CONFIG_HC_AM_MAX_LIVE_APPS || lru < 0 ||
+            !app_hibernate(lru))
+            break;
+        live--;
+    }
+    if (pending && (timeout_us > 0 || CONFIG_HC_AM_HIBERNATE_MIN_HEAP > 0))
+        return pdMS_TO_TICKS(HIBERNATE_CHECK_PERIOD);
+    return portMAX_DELAY;
+}
+
+// Keeps the windows next to the current one warm and hides the rest
+static void update_neighbours(void)
+{
+    for (uint8_t i = 0; i < win_count; i++) {
+        if (i == win_idx)
+            continue;
+#if CONFIG_HC_AM_PREWARM
+        if (i + 1 == win_idx || i == win_idx + 1) {
+            app_show(i, WIN_WARM);
+            continue;
+        }
+#endif
+        app_hide(i);
+    }
+}
+
+// Waits up to CONFIG_HC_AM_FIRST_FRAME_TIMEOUT for the app of window idx to present a frame,
+// so the slide doesn't show an empty or stale canvas
+static void wait_first_frame(uint8_t idx)
+{
+    struct am_window_data *win = &win_data[idx];
+    int64_t deadline = esp_timer_get_time() + CONFIG_HC_AM_FIRST_FRAME_TIMEOUT * 1000LL;
+    // Cleared before checking, so a frame arriving in between still wakes us up
+    xEventGroupClearBits(first_frame_group, AM_FIRST_FRAME_BIT);
+    while (!win->ready && !win->failed) {
+        int64_t left_us = deadline - esp_timer_get_time();
+        if (left_us <= 0) {
+            ESP_LOGW(TAG, "No frame from %s in time", app_info[idx].name);
+            metrics_add(METRICS_SWITCH_TIMEOUTS, 1);
+            return;
+        }
+        // Other windows set the bit as well, the loop checks again
+        const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+        xEventGroupWaitBits(first_frame_group, AM_FIRST_FRAME_BIT, pdTRUE, pdTRUE,
+                            (left_us + tick_us - 1) / tick_us);
+    }
+}
+
 static void window_manager_task(void *param)
 {
     struct am_params *params = (struct am_params *)param;
     app_info = params->apps;
-    struct framebuffer *fb = params->framebuffer;
 
-    // Allocate memory for canvases
+    // Canvases are allocated when apps are started
     ESP_LOGI(TAG, "Available windows:");
-    uint8_t win_count = 0;
+    bool has_coop = false;
     for (uint8_t i = 0; (void *)(app_info[i].name) != NULL; i++) {
-        struct am_window_data new_win = {
-            .handle = NULL,
-            .canvas = cv_init(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT)
-        };
-        win_data[i] = new_win;
+        has_coop |= app_info[i].ops != NULL;
+        evq_init(&win_data[i].events);
         win_count++;
         ESP_LOGI(TAG, "    %s", app_info[i].name);
         if (app_info[i].name == params->default_app)
             win_idx = i;
     }
 
-    // Start first window task
-    launch_window_task(app_info[win_idx], &win_data[win_idx]);
+    anim_cv = cv_init(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT);
+    // The render task shows the current window right away
+    window_alloc_canvas(&win_data[win_idx]);
+    render_start(params->framebuffer, present_fb);
+
+    // Cooperative apps share the stack of one task
+    if (has_coop && xTaskCreate(app_loop_task, "app_loop", APP_STACK_SIZE, NULL,
+                                AM_WIN_PRIORITY, &loop_handle) != pdPASS)
+        ESP_LOGE(TAG, "Failed to start app loop task");
 
+    // Start first window and its neighbours
+    app_show(win_idx, WIN_SHOWN);
+    update_neighbours();
+
+    // Switch waiting for its window to finish hibernating
+    uint32_t pending = 0;
     while(1) {
         // Wait for notification
-        uint32_t message;
-        xTaskNotifyWait(pdFALSE, ULONG_MAX, &message, portMAX_DELAY);
-        
-        if (message & AM_MSG_REFRESH) {
-            // Redraw framebuffer
-            redraw_fb(fb, win_data[win_idx].canvas);
-            ESP_LOGI(TAG, "Redraw FB");
-        } else if (message & AM_MSG_PREVAPP || message & AM_MSG_NEXTAPP) {
+        uint32_t message = 0;
+        xTaskNotifyWait(pdFALSE, ULONG_MAX, &message, hibernate_check());
+
+        bool retry = false;
+        if (message & AM_MSG_HIBERNATED) {
+            // Neighbours that were hibernating can be warmed now
+            update_neighbours();
+            if (!(message & (AM_MSG_PREVAPP | AM_MSG_NEXTAPP))) {
+                message |= pending;
+                retry = pending != 0;
+            }
+        }
+
+        if (message & AM_MSG_PREVAPP || message & AM_MSG_NEXTAPP) {
             // Switch apps
             if ((message & AM_MSG_PREVAPP && win_idx == 0) ||
                 (message & AM_MSG_NEXTAPP && win_idx == (win_count - 1))) {
@@ -111,31 +621,25 @@ static void window_manager_task(void *param)
                 continue;
             }
 
-            uint8_t prev_idx = win_idx;
-            uint8_t l_idx, r_idx;
-            if (message & AM_MSG_NEXTAPP) {
-                l_idx = win_idx;
-                r_idx = ++win_idx;
-            } else {
-                r_idx = win_idx;
-                l_idx = --win_idx;
+            uint8_t new_idx = (message & AM_MSG_NEXTAPP) ? win_idx + 1 : win_idx - 1;
+            // Latency of a retried switch counts from the first request
+            if (!retry) {
+                slide.switch_idx = new_idx;
+                slide.switch_us = esp_timer_get_time();
             }
-            if (win_data[win_idx].handle == NULL) {
-                ESP_LOGI(TAG, "Start %s task...", app_info[win_idx].name);
-                launch_window_task(app_info[win_idx], &win_data[win_idx]);
-            } else {
-                ESP_LOGI(TAG, "Resume %s task...", app_info[win_idx].name);
-                vTaskResume(win_data[win_idx].handle);
+            if (!app_show(new_idx, WIN_SHOWN)) {
+                // Input keeps working meanwhile, a newer switch replaces this one
+                pending = message & (AM_MSG_PREVAPP | AM_MSG_NEXTAPP);
+                continue;
             }
+            pending = 0;
+            wait_first_frame(new_idx);
 
             ESP_LOGI(TAG, "Playing animation...");
-            play_slide_anim(fb,
-                            win_data[l_idx].canvas,
-                            win_data[r_idx].canvas,
-                            (message & AM_MSG_NEXTAPP) != 0);
+            play_slide_anim(new_idx);
 
-            ESP_LOGI(TAG, "Suspend %s task...", app_info[prev_idx].name);
-            vTaskSuspend(win_data[prev_idx].handle);
+            // The previous window stays warm as a neighbour of the new one
+            update_neighbours();
         }
     }
 }
@@ -147,6 +651,9 @@ void launch_am_task(struct am_params *params)
         ESP_LOGE(TAG, "AM task is already running!");
         return;
     }
+    overlay_init();
+    anim_init();
+    first_frame_group = xEventGroupCreate();
     int ret = xTaskCreate(
         window_manager_task,
         "window_manager",
@@ -159,19 +666,161 @@ void launch_am_task(struct am_params *params)
         ESP_LOGE(TAG, "Failed to start AM task");
 }
 
+// Window of the calling app task or of the cooperative app in a callback, -1 if none
+static int8_t caller_window(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (self == loop_handle)
+        return loop_app;
+    for (uint8_t i = 0; i < win_count; i++) {
+        if (win_data[i].handle == self)
+            return i;
+    }
+    return -1;
+}
+
+// Refresh requests go straight to the render task without waking AM.
+// When sent from a window task (or a callback of cooperative app), its canvas is presented first.
+// Frames of warm windows don't need the render task until they are switched to
 void am_send_msg(uint32_t message)
 {
-    xTaskNotify(am_handle, message, eSetBits);
+    if (message & AM_MSG_REFRESH) {
+        int8_t idx = caller_window();
+        if (idx >= 0)
+            present_window(idx);
+        if (idx < 0 || idx == win_idx)
+            render_request();
+    }
+    message &= ~AM_MSG_REFRESH;
+    if (message) {
+        metrics_input_dispatch(am_handle);
+        xTaskNotify(am_handle, message, eSetBits);
+    }
 }
 
+// Canvases can't be presented from ISR, so this only requests a new frame
 void am_send_msg_from_isr(uint32_t message, BaseType_t *higher_task_wakeup)
 {
-    xTaskNotifyFromISR(am_handle, message, eSetBits, higher_task_wakeup);
+    if (message & AM_MSG_REFRESH)
+        render_request_from_isr(higher_task_wakeup);
+    message &= ~AM_MSG_REFRESH;
+    if (message)
+        xTaskNotifyFromISR(am_handle, message, eSetBits, higher_task_wakeup);
+}
+
+// Sends input event with the time it happened to the current window
+void am_send_input_event(enum app_event_type type, int32_t value, int64_t time_us)
+{
+    uint8_t idx = win_idx;
+    struct app_event event = { .type = type, .count = 1, .value = value, .time_us = time_us };
+    if (!evq_push(&win_data[idx].events, &event)) {
+        ESP_LOGW(TAG, "Event queue of %s is full, input event %d dropped", app_info[idx].name, type);
+        return;
+    }
+    metrics_input_dispatch(app_info[idx].ops != NULL ? loop_handle : win_data[idx].handle);
+    window_notify(idx);
+}
+
+// Posts EVENT_APP with message to app (see am_get_app_id()), from any task.
+// Returns false if the queue is full
+bool am_post_event(int8_t app, int32_t message)
+{
+    if (app < 0 || app >= win_count)
+        return false;
+    struct app_event event = { .type = EVENT_APP, .count = 1, .value = message, .time_us = esp_timer_get_time() };
+    if (!evq_push(&win_data[app].events, &event)) {
+        ESP_LOGW(TAG, "Event queue of %s is full, message %ld dropped", app_info[app].name, (long) message);
+        return false;
+    }
+    window_notify(app);
+    return true;
+}
+
+// Takes the next event of the calling app task, waits up to timeout for it
+bool am_event_wait(struct app_event *event, TickType_t timeout)
+{
+    int8_t idx = caller_window();
+    if (idx < 0 || app_info[idx].ops != NULL) {
+        ESP_LOGE(TAG, "am_event_wait() called outside of app task!");
+        return false;
+    }
+    // The app is busy from one wait to the next
+    struct am_window_data *win = &win_data[idx];
+    if (win->wake_us != 0)
+        activity_add(win, 0, esp_timer_get_time() - win->wake_us);
+
+    TimeOut_t start;
+    vTaskSetTimeOutState(&start);
+    bool taken = true;
+    while (!evq_pop(&win->events, event)) {
+        // Every event notifies the task, so a notification may be left from ones already taken
+        if (xTaskCheckForTimeOut(&start, &timeout) == pdTRUE) {
+            taken = false;
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, timeout);
+    }
+    win->wake_us = esp_timer_get_time();
+    activity_add(win, 1, 0);
+    return taken;
+}
+
+// Id of the calling app for am_post_event(), -1 if called outside of apps.
+// Background tasks of an app take it from the app task
+int8_t am_get_app_id(void)
+{
+    return caller_window();
+}
+
+// Asks for on_tick() of the calling cooperative app at esp_timer time time_us, for content
+// changing on its own schedule. Earlier requests win, ticks of tick_ms come anyway
+void am_tick_at(int64_t time_us)
+{
+    if (loop_app < 0 || xTaskGetCurrentTaskHandle() != loop_handle) {
+        ESP_LOGE(TAG, "am_tick_at() called outside of cooperative app!");
+        return;
+    }
+    struct am_window_data *win = &win_data[loop_app];
+    win->next_tick_us = MIN(win->next_tick_us, time_us);
+}
+
+// Wakeups of app idx and the time it was busy since start, cooperative apps are busy in callbacks
+void am_get_app_activity(uint8_t idx, uint32_t *wakeups, uint64_t *busy_us)
+{
+    *wakeups = 0;
+    *busy_us = 0;
+    if (idx >= win_count)
+        return;
+    portENTER_CRITICAL(&loop_lock);
+    *wakeups = win_data[idx].wakeups;
+    *busy_us = win_data[idx].busy_us;
+    portEXIT_CRITICAL(&loop_lock);
+}
+
+// Called by a task-based app on EVENT_HIBERNATE once it released its resources, never returns.
+// The task is started from scratch when the window is shown again, its queue is kept
+void am_app_hibernated(void)
+{
+    int8_t idx = caller_window();
+    if (idx < 0 || loop_handle == xTaskGetCurrentTaskHandle()) {
+        ESP_LOGE(TAG, "am_app_hibernated() called outside of app task!");
+        return;
+    }
+    ESP_LOGI(TAG, "%s hibernated", app_info[idx].name);
+    window_hibernated(&win_data[idx]);
+    vTaskDelete(NULL);
 }
 
-void am_send_input_event(uint32_t event)
+// State of app idx (in the list of get_apps_list())
+enum am_app_state am_get_app_state(uint8_t idx)
 {
-    xTaskNotify(win_data[win_idx].handle, event, eSetBits);
+    if (idx >= win_count)
+        return AM_APP_STOPPED;
+    if (app_info[idx].ops != NULL)
+        return win_data[idx].status;
+    if (win_data[idx].handle == NULL)
+        return win_data[idx].status;
+    return eTaskGetState(win_data[idx].handle) == eSuspended ? AM_APP_SUSPENDED : AM_APP_RUNNING;
 }
 
 // TODO: Rework app info gathering
@@ -2,22 +2,30 @@
 #define __APPS_H__
 
 #define APP_INFO(app_name)  { .name = #app_name, .ui_task = app_name ## _ui_task }
+#define APP_INFO_HIBERNATE(app_name)  { .name = #app_name, .ui_task = app_name ## _ui_task, .hibernate = true }
+#define COOP_APP_INFO(app_name)  { .name = #app_name, .ops = &app_name ## _app_ops }
 
 #include "app_manager.h"
+#include "sdkconfig.h"
 
 /* App headers go here */
 #include "sin_wave.h"
 #include "clock_app.h"
 #include "wifi_status_app.h"
 #include "weather_app.h"
+#if !CONFIG_IDF_TARGET_LINUX
 #include "ha_mqtt_light.h"
+#endif
 
 static struct am_app_info registered_apps[] = {
-    APP_INFO(wifi_status),
-    APP_INFO(clock),
+    APP_INFO_HIBERNATE(wifi_status),
+    COOP_APP_INFO(clock),
+#if !CONFIG_IDF_TARGET_LINUX
+    // No MQTT client in the host build
     APP_INFO(ha_mqtt_light),
-    APP_INFO(weather),
-    APP_INFO(sin_wave),
+#endif
+    APP_INFO_HIBERNATE(weather),
+    COOP_APP_INFO(sin_wave),
     { /* sentinel */}
 };
 
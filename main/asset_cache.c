@@ -0,0 +1,287 @@
+/* Shared image cache. Images are looked up by asset name, loaded once and handed out
+ * with reference counts, so apps showing the same icon share it. Released images stay
+ * cached until RAM taken by images decoded from files exceeds the budget, then least
+ * recently used ones are freed. Images from the asset pack point into flash and only
+ * take a slot. Files are decoded either by the caller or by the loader task */
+
+#include <stdint.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "app_manager.h"
+#include "asset_cache.h"
+#include "assets.h"
+#include "sdkconfig.h"
+
+#define TAG "asset_cache"
+
+#define ASSET_NAME_MAX      48
+#define LOADER_STACK_SIZE   4096
+
+// Task waiting for another one to finish decoding, lives on the waiter's stack
+struct load_waiter {
+    StaticSemaphore_t done_buf;
+    SemaphoreHandle_t done;
+    struct load_waiter *next;
+};
+
+struct asset {
+    char name[ASSET_NAME_MAX];  // Empty for unused slots
+    struct image_desc image;
+    size_t size;                // Heap taken by the image, 0 if it's mapped from the pack
+    uint16_t refs;
+    uint8_t state;
+    bool loading;               // Someone is decoding the file right now
+    struct load_waiter *waiters;
+    uint32_t last_used;
+};
+
+struct load_request {
+    struct asset *asset;
+    int8_t app;
+    int32_t message;
+};
+
+static struct asset assets[CONFIG_HC_ASSET_CACHE_SLOTS];
+static SemaphoreHandle_t cache_mutex = NULL;
+static QueueHandle_t loader_queue = NULL;
+static uint32_t use_clock = 0;
+static struct asset_cache_stats stats;
+
+static size_t image_size(const struct image_desc *image)
+{
+    size_t rows = image->height * sizeof(struct image_row);
+    if (image->bpp)
+        return image->colors * sizeof(crgb) + (image->alpha != NULL ? image->colors : 0) +
+               image_stride(image) * image->height + rows;
+    size_t count = image->width * image->height;
+    return count * sizeof(crgb) + (image->alpha != NULL ? count : 0) + rows;
+}
+
+static void drop_asset(struct asset *a)
+{
+    if (a->size) {
+        free_image(&a->image);
+        stats.used -= a->size;
+        a->size = 0;
+    }
+    a->name[0] = '\0';
+    stats.count--;
+}
+
+// Least recently used image nobody holds, with_size skips images mapped from the pack
+static struct asset *find_unused(bool with_size)
+{
+    struct asset *lru = NULL;
+    for (uint16_t i = 0; i < CONFIG_HC_ASSET_CACHE_SLOTS; i++) {
+        struct asset *a = &assets[i];
+        if (a->name[0] == '\0' || a->refs || a->state == ASSET_LOADING || (with_size && !a->size))
+            continue;
+        if (lru == NULL || (int32_t)(a->last_used - lru->last_used) < 0)
+            lru = a;
+    }
+    return lru;
+}
+
+static void trim_cache(void)
+{
+    while (stats.used > stats.budget) {
+        struct asset *a = find_unused(true);
+        if (a == NULL)
+            break;
+        ESP_LOGD(TAG, "Evicting %s", a->name);
+        drop_asset(a);
+        stats.evictions++;
+    }
+}
+
+// Finds the image or takes a slot for it, the caller gets a reference
+static struct asset *lookup(const char *name)
+{
+    if (strlen(name) >= ASSET_NAME_MAX) {
+        ESP_LOGE(TAG, "Asset name %s is too long", name);
+        return NULL;
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    struct asset *a = NULL;
+    struct asset *free_slot = NULL;
+    for (uint16_t i = 0; i < CONFIG_HC_ASSET_CACHE_SLOTS; i++) {
+        if (assets[i].name[0] == '\0') {
+            if (free_slot == NULL)
+                free_slot = &assets[i];
+        } else if (strcmp(assets[i].name, name) == 0) {
+            a = &assets[i];
+            break;
+        }
+    }
+
+    if (a != NULL) {
+        stats.hits++;
+        // Failed image is kept only while someone holds it, a new request retries the load,
+        // so the requester gets its result (and async ones their event) like for a fresh slot
+        if (a->state == ASSET_FAILED)
+            a->state = ASSET_LOADING;
+    } else {
+        stats.misses++;
+        a = free_slot;
+        if (a == NULL) {
+            a = find_unused(false);
+            if (a == NULL) {
+                xSemaphoreGive(cache_mutex);
+                ESP_LOGE(TAG, "No free slots for %s", name);
+                return NULL;
+            }
+            drop_asset(a);
+            stats.evictions++;
+        }
+        strcpy(a->name, name);
+        a->refs = 0;
+        a->loading = false;
+        a->waiters = NULL;
+        stats.count++;
+        // Pack lookup doesn't touch any filesystem, no need for loader
+        a->state = assets_get_image(name, &a->image) == 0 ? ASSET_READY : ASSET_LOADING;
+    }
+    a->refs++;
+    a->last_used = ++use_clock;
+    xSemaphoreGive(cache_mutex);
+    return a;
+}
+
+// Decodes the file unless it's already done, waits if another task is decoding it
+static void load_asset(struct asset *a)
+{
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    while (a->state == ASSET_LOADING && a->loading) {
+        // Each waiter has its own semaphore, so a wakeup can't be lost or taken by someone else
+        struct load_waiter w = { .next = a->waiters };
+        w.done = xSemaphoreCreateBinaryStatic(&w.done_buf);
+        a->waiters = &w;
+        xSemaphoreGive(cache_mutex);
+        xSemaphoreTake(w.done, portMAX_DELAY);
+        xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    }
+    if (a->state != ASSET_LOADING) {
+        xSemaphoreGive(cache_mutex);
+        return;
+    }
+    a->loading = true;
+    xSemaphoreGive(cache_mutex);
+
+    // Slot can't be reused while loading, so name stays valid
+    struct image_desc image;
+    uint8_t ret = assets_load_image(a->name, &image);
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    a->loading = false;
+    for (struct load_waiter *w = a->waiters; w != NULL; w = w->next)
+        xSemaphoreGive(w->done);
+    a->waiters = NULL;
+    if (ret) {
+        a->state = ASSET_FAILED;
+        stats.failures++;
+        if (a->refs == 0)
+            drop_asset(a);
+    } else {
+        a->image = image;
+        a->size = image_size(&image);
+        a->state = ASSET_READY;
+        stats.used += a->size;
+        trim_cache();
+    }
+    xSemaphoreGive(cache_mutex);
+}
+
+static void loader_task(void *param)
+{
+    struct load_request req;
+    while (1) {
+        xQueueReceive(loader_queue, &req, portMAX_DELAY);
+        load_asset(req.asset);
+        if (req.app >= 0)
+            am_post_event(req.app, req.message);
+    }
+}
+
+void asset_cache_init(void)
+{
+    cache_mutex = xSemaphoreCreateMutex();
+    loader_queue = xQueueCreate(CONFIG_HC_ASSET_CACHE_SLOTS, sizeof(struct load_request));
+    stats.budget = CONFIG_HC_ASSET_CACHE_BUDGET * 1024;
+    xTaskCreate(loader_task, "asset_loader", LOADER_STACK_SIZE, NULL, 1, NULL);
+}
+
+// Returns a reference to the loaded image, NULL if it can't be loaded.
+// May block on decoding, UI tasks should prefer asset_acquire_async()
+struct asset *asset_acquire(const char *name)
+{
+    struct asset *a = lookup(name);
+    if (a == NULL)
+        return NULL;
+    load_asset(a);
+    if (asset_get_state(a) == ASSET_FAILED) {
+        asset_release(a);
+        return NULL;
+    }
+    return a;
+}
+
+// Returns a reference right away, the image is decoded by the loader task if needed.
+// If it's still loading on return, app (see am_get_app_id()) gets EVENT_APP with message
+// once it's ready or failed
+struct asset *asset_acquire_async(const char *name, int8_t app, int32_t message)
+{
+    struct asset *a = lookup(name);
+    if (a == NULL || asset_get_state(a) != ASSET_LOADING)
+        return a;
+    struct load_request req = { .asset = a, .app = app, .message = message };
+    xQueueSend(loader_queue, &req, portMAX_DELAY);
+    return a;
+}
+
+void asset_release(struct asset *asset)
+{
+    if (asset == NULL)
+        return;
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    asset->refs--;
+    if (asset->refs == 0) {
+        // Keep failed images out, so the next request retries
+        if (asset->state == ASSET_FAILED)
+            drop_asset(asset);
+        else
+            trim_cache();
+    }
+    xSemaphoreGive(cache_mutex);
+}
+
+enum asset_state asset_get_state(const struct asset *asset)
+{
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    enum asset_state state = asset->state;
+    xSemaphoreGive(cache_mutex);
+    return state;
+}
+
+// Image of the held asset, NULL until it's loaded
+const struct image_desc *asset_image(const struct asset *asset)
+{
+    if (asset == NULL || asset_get_state(asset) != ASSET_READY)
+        return NULL;
+    return &asset->image;
+}
+
+// Counters since start, all zero before asset_cache_init()
+void asset_cache_get_stats(struct asset_cache_stats *out)
+{
+    if (cache_mutex == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(cache_mutex);
+}
@@ -0,0 +1,195 @@
+/* Asset pack: images pre-decoded at build time by tools/mkassets.py into their own partition.
+ * The partition is mapped into the address space once, lookups are a hash table probe
+ * and images are used straight from flash without copying. Animated images are stored as is */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "anim_image.h"
+#include "assets.h"
+#include "sdkconfig.h"
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_partition.h"
+#endif
+
+#define TAG "assets"
+
+#define ASSETS_MAGIC        "HCAP"
+#define ASSETS_VERSION      2
+#define ASSETS_PARTITION    "assets"
+
+#define FLAG_BPP_MASK       0x0f
+#define FLAG_RAW            (1 << 4)
+
+struct pack_header {
+    char magic[4];
+    uint16_t version;
+    uint16_t count;
+    uint16_t slots;         // Hash table size, power of 2
+    uint16_t reserved;
+} __attribute__((packed));
+
+struct pack_entry {
+    uint32_t name;
+    uint32_t hash;
+    uint8_t width;
+    uint8_t height;
+    uint16_t flags;         // Bits 0-3: bits per index, 0 for direct color. Bit 4: raw file.
+                            // Bits 8-15: palette size - 1
+    uint32_t pixels;        // Colors or palette, contents of raw files
+    uint32_t alpha;         // 0 for opaque images, size of raw files
+    uint32_t rows;
+    uint32_t indices;       // 0 for direct color
+} __attribute__((packed));
+
+extern const char *base_path;
+
+static const uint8_t *pack_base = NULL;
+static size_t pack_size = 0;
+static const struct pack_header *header = NULL;
+static const uint16_t *slots = NULL;
+static const struct pack_entry *entries = NULL;
+
+static uint32_t fnv1a(const char *str)
+{
+    uint32_t hash = 0x811c9dc5;
+    while (*str) {
+        hash ^= (uint8_t)*str++;
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+#if CONFIG_IDF_TARGET_LINUX
+// Host build has no flash to map, the pack built along with the firmware is read into memory
+esp_err_t assets_init(void)
+{
+    FILE *f = fopen(HOST_ASSETS_BIN, "rb");
+    if (f == NULL) {
+        ESP_LOGW(TAG, "No %s, images will be loaded from files", HOST_ASSETS_BIN);
+        return ESP_ERR_NOT_FOUND;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    void *pack = size > 0 ? malloc(size) : NULL;
+    esp_err_t err = ESP_ERR_NO_MEM;
+    if (pack != NULL && fread(pack, 1, size, f) == size)
+        err = assets_open(pack, size);
+    fclose(f);
+    if (err != ESP_OK)
+        free(pack);
+    return err;
+}
+#else
+// Maps the asset partition, doesn't need any filesystem
+esp_err_t assets_init(void)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY, ASSETS_PARTITION);
+    if (part == NULL) {
+        ESP_LOGW(TAG, "No %s partition, images will be loaded from files", ASSETS_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    const void *ptr;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t err = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map %s partition (%s)", ASSETS_PARTITION, esp_err_to_name(err));
+        return err;
+    }
+    err = assets_open(ptr, part->size);
+    if (err != ESP_OK)
+        esp_partition_munmap(handle);
+    return err;
+}
+#endif /* CONFIG_IDF_TARGET_LINUX */
+
+// Checks the pack located at pack and starts using it
+esp_err_t assets_open(const void *pack, size_t size)
+{
+    const struct pack_header *h = pack;
+    if (size < sizeof(*h) || memcmp(h->magic, ASSETS_MAGIC, 4) != 0 || h->version != ASSETS_VERSION ||
+        h->slots == 0 || (h->slots & (h->slots - 1)) != 0 ||
+        sizeof(*h) + h->slots * sizeof(uint16_t) + h->count * sizeof(struct pack_entry) > size) {
+        ESP_LOGE(TAG, "Asset pack is missing or corrupted");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    pack_base = pack;
+    pack_size = size;
+    header = h;
+    slots = (const uint16_t *)(pack_base + sizeof(*h));
+    entries = (const struct pack_entry *)(slots + h->slots);
+    ESP_LOGI(TAG, "%d assets in pack", h->count);
+    return ESP_OK;
+}
+
+static const struct pack_entry *find_entry(const char *name)
+{
+    if (header == NULL)
+        return NULL;
+    uint32_t hash = fnv1a(name);
+    uint16_t mask = header->slots - 1;
+    for (uint16_t i = 0, slot = hash & mask; i < header->slots; i++, slot = (slot + 1) & mask) {
+        uint16_t idx = slots[slot];
+        if (idx == 0 || idx > header->count)
+            return NULL;
+        const struct pack_entry *e = &entries[idx - 1];
+        if (e->hash == hash && e->name < pack_size && strcmp((const char *)pack_base + e->name, name) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+// Fills description with the image from pack, nothing is copied or allocated.
+// name is the path inside fatfs_image, e.g. "weather/sunny.qoi"
+uint8_t assets_get_image(const char *name, struct image_desc *description)
+{
+    const struct pack_entry *e = find_entry(name);
+    if (e == NULL || (e->flags & FLAG_RAW))
+        return 1;
+    description->width = e->width;
+    description->height = e->height;
+    description->bpp = e->flags & FLAG_BPP_MASK;
+    description->colors = description->bpp ? (e->flags >> 8) + 1 : 0;
+    description->pixels = (const crgb *)(pack_base + e->pixels);
+    description->alpha = e->alpha ? pack_base + e->alpha : NULL;
+    description->indices = e->indices ? pack_base + e->indices : NULL;
+    description->rows = (const struct image_row *)(pack_base + e->rows);
+    return 0;
+}
+
+// Takes the image from pack, falls back to decoding the file from storage partition
+uint8_t assets_load_image(const char *name, struct image_desc *description)
+{
+    if (assets_get_image(name, description) == 0)
+        return 0;
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s", base_path, name);
+    return load_image_file(path, description);
+}
+
+// Gives contents of a file stored in pack as is
+uint8_t assets_get_data(const char *name, const void **data, size_t *size)
+{
+    const struct pack_entry *e = find_entry(name);
+    if (e == NULL || !(e->flags & FLAG_RAW) || e->pixels > pack_size || e->alpha > pack_size - e->pixels)
+        return 1;
+    *data = pack_base + e->pixels;
+    *size = e->alpha;
+    return 0;
+}
+
+// Opens animated image from pack with frames left in flash, falls back to reading the file
+uint8_t assets_load_anim(const char *name, struct anim_image *img)
+{
+    const void *data;
+    size_t size;
+    if (assets_get_data(name, &data, &size) == 0)
+        return anim_image_open(data, size, img);
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s", base_path, name);
+    return anim_image_load_file(path, img);
+}
@@ -2,12 +2,11 @@
 #include <string.h>
 #include <sys/param.h>
 #include "freertos/FreeRTOS.h"
-#include "esp_log.h"
 #include "canvas.h"
 #include "framebuffer.h"
+#include "metrics.h"
 
 static const crgb crgb_black = { 0, 0, 0 };
-static const char *TAG = "canvas";
 
 struct canvas *cv_init(uint8_t width, uint8_t height)
 {
@@ -15,6 +14,9 @@ struct canvas *cv_init(uint8_t width, uint8_t height)
     new_cv->width = width;
     new_cv->height = height;
     new_cv->buf = pvPortMalloc(sizeof(crgb) * width * height);
+    new_cv->front = NULL;
+    new_cv->front_mutex = NULL;
+    cv_clear_dirty(new_cv);
     cv_blank(new_cv);
     return new_cv;
 }
@@ -24,27 +26,152 @@ struct canvas *cv_copy(struct canvas *old_cv)
     struct canvas *new_cv = pvPortMalloc(sizeof(struct canvas));
     new_cv->width = old_cv->width;
     new_cv->height = old_cv->height;
+    new_cv->front = NULL;
+    new_cv->front_mutex = NULL;
+    cv_clear_dirty(new_cv);
     size_t buf_size = sizeof(crgb) * old_cv->width * old_cv->height;
     new_cv->buf = pvPortMalloc(buf_size);
     memcpy(new_cv->buf, old_cv->buf, buf_size);
+    cv_mark_dirty_all(new_cv);
     return new_cv;
 }
 
 void cv_free(struct canvas *cv)
 {
+    if (cv->front != NULL) {
+        free(cv->front);
+        vSemaphoreDelete(cv->front_mutex);
+    }
     free(cv->buf);
     free(cv);
 }
 
+// Adds a front buffer: the owner keeps drawing into buf, while the output stage reads
+// the last presented frame straight from front without copying it anywhere
+void cv_enable_double_buffer(struct canvas *cv)
+{
+    if (cv->front != NULL)
+        return;
+    size_t buf_size = sizeof(crgb) * cv->width * cv->height;
+    cv->front = pvPortMalloc(buf_size);
+    memcpy(cv->front, cv->buf, buf_size);
+    cv->front_mutex = xSemaphoreCreateMutex();
+    cv->front_dirty.x1 = 0;
+    cv->front_dirty.y1 = 0;
+    cv->front_dirty.x2 = cv->width - 1;
+    cv->front_dirty.y2 = cv->height - 1;
+}
+
+static void rect_union(struct cv_rect *a, const struct cv_rect *b)
+{
+    if (b->x1 > b->x2)
+        return;
+    if (a->x1 > a->x2) {
+        *a = *b;
+        return;
+    }
+    a->x1 = MIN(a->x1, b->x1);
+    a->y1 = MIN(a->y1, b->y1);
+    a->x2 = MAX(a->x2, b->x2);
+    a->y2 = MAX(a->y2, b->y2);
+}
+
+// Publishes the frame drawn in buf. Buffers are swapped, then only the area changed in this frame
+// is copied back, so the owner can continue drawing incrementally. Blocks only while the output
+// stage encodes the previous front, never for the LED transfer itself
+void cv_present(struct canvas *cv)
+{
+    if (cv->front == NULL || !cv_is_dirty(cv))
+        return;
+    struct cv_rect d = cv->dirty;
+
+    xSemaphoreTake(cv->front_mutex, portMAX_DELAY);
+    crgb *front = cv->buf;
+    cv->buf = cv->front;
+    cv->front = front;
+    rect_union(&cv->front_dirty, &d);
+    xSemaphoreGive(cv->front_mutex);
+
+    size_t len = (d.x2 - d.x1 + 1) * sizeof(crgb);
+    for (uint16_t y = d.y1; y <= d.y2; y++)
+        memcpy(&cv->buf[y * cv->width + d.x1], &front[y * cv->width + d.x1], len);
+    cv_clear_dirty(cv);
+}
+
+// Returns the latest presented pixels and the area changed since the previous call.
+// For single-buffered canvases it's buf and the dirty area. With changed NULL the area
+// is left for the output stage
+const crgb *cv_lock_front(struct canvas *cv, struct cv_rect *changed)
+{
+    if (cv->front == NULL) {
+        if (changed != NULL) {
+            *changed = cv->dirty;
+            cv_clear_dirty(cv);
+        }
+        return cv->buf;
+    }
+    xSemaphoreTake(cv->front_mutex, portMAX_DELAY);
+    if (changed != NULL) {
+        *changed = cv->front_dirty;
+        cv->front_dirty.x1 = 1;
+        cv->front_dirty.x2 = 0;
+    }
+    return cv->front;
+}
+
+void cv_unlock_front(struct canvas *cv)
+{
+    if (cv->front != NULL)
+        xSemaphoreGive(cv->front_mutex);
+}
+
 void cv_blank(struct canvas *cv)
 {
     memset(cv->buf, 0, cv->width * cv->height * sizeof(crgb));
+    cv_mark_dirty_all(cv);
 }
 
 void cv_fill(struct canvas *cv, crgb color)
 {
     for (size_t i = 0; i < cv->width * cv->height; i++)
         cv->buf[i] = color;
+    cv_mark_dirty_all(cv);
+}
+
+// Extends the dirty area of canvas, must be called by anyone who writes into cv->buf directly
+void cv_mark_dirty(struct canvas *cv, uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2)
+{
+    x2 = MIN(x2, cv->width - 1);
+    y2 = MIN(y2, cv->height - 1);
+    if (x1 > x2 || y1 > y2)
+        return;
+
+    struct cv_rect *d = &cv->dirty;
+    if (d->x1 > d->x2) {
+        d->x1 = x1; d->y1 = y1; d->x2 = x2; d->y2 = y2;
+        cv->draw_start_us = metrics_start();
+        return;
+    }
+    d->x1 = MIN(d->x1, x1);
+    d->y1 = MIN(d->y1, y1);
+    d->x2 = MAX(d->x2, x2);
+    d->y2 = MAX(d->y2, y2);
+}
+
+void cv_mark_dirty_all(struct canvas *cv)
+{
+    cv_mark_dirty(cv, 0, 0, cv->width - 1, cv->height - 1);
+}
+
+void cv_clear_dirty(struct canvas *cv)
+{
+    cv->dirty.x1 = 1;
+    cv->dirty.x2 = 0;
+}
+
+bool cv_is_dirty(struct canvas *cv)
+{
+    return cv->dirty.x1 <= cv->dirty.x2;
 }
 
 crgb cv_get_pixel(struct canvas *cv, uint8_t x, uint8_t y)
@@ -54,20 +181,27 @@ crgb cv_get_pixel(struct canvas *cv, uint8_t x, uint8_t y)
 
 void cv_set_pixel(struct canvas *cv, uint8_t x, uint8_t y, crgb color)
 {
-    cv->buf[y * cv->width + x] = color;
+    crgb *px = &cv->buf[y * cv->width + x];
+    // Redrawing the same color must not make the canvas dirty
+    if (px->r == color.r && px->g == color.g && px->b == color.b)
+        return;
+    *px = color;
+    cv_mark_dirty(cv, x, y, x, y);
 }
 
 void cv_draw_line_v(struct canvas *cv, uint8_t x, uint8_t y1, uint8_t y2, crgb color)
 {
-    for (uint8_t i = y1 * cv->width; i <= y2 * cv->width; i += cv->width)
+    for (size_t i = y1 * cv->width; i <= y2 * cv->width; i += cv->width)
         cv->buf[i + x] = color;
+    cv_mark_dirty(cv, x, y1, x, y2);
 }
 
 void cv_draw_line_h(struct canvas *cv, uint8_t x1, uint8_t x2, uint8_t y, crgb color)
 {
-    uint8_t pos = y * cv->width;
+    size_t pos = y * cv->width;
     for (uint8_t j = x1; j <= x2; j++)
         cv->buf[pos + j] = color;
+    cv_mark_dirty(cv, x1, y, x2, y);
 }
 
 void cv_draw_rect(struct canvas *cv, uint8_t x1, uint8_t x2, uint8_t y1, uint8_t y2, crgb color)
@@ -89,36 +223,76 @@ void cv_draw_symbol(struct canvas *cv, const struct bitmap_font *font, uint8_t s
     }
 }
 
-// Draws image (raw RGB888 or RGBA8888 pixels)
-void cv_draw_image(struct canvas *cv, struct image_desc *img, uint8_t x, uint8_t y)
+// Expands len palette indices of image row iy starting at ix.
+// Transparency is looked up in the palette together with the color
+static void draw_indexed_row(const struct image_desc *img, uint8_t iy, uint8_t ix, uint8_t len,
+                             bool opaque, crgb *dst)
 {
-    if (img->channels != 3 && img->channels != 4) {
-        ESP_LOGE(TAG, "Channel count must be 3 (RGB) or 4 (RGBA)");
+    const uint8_t *indices = &img->indices[iy * image_stride(img)];
+    const uint8_t bpp = img->bpp;
+    if (opaque || img->alpha == NULL) {
+        for (uint8_t i = 0; i < len; i++)
+            dst[i] = img->pixels[image_index(indices, bpp, ix + i)];
         return;
     }
-    // Convert raw bytes into crgb (ignore alpha for now), and fill canvas
-    for (uint8_t i = 0; i < (cv->height < img->height ? cv->height : img->height); i++) {
-        if (y + i >= cv->height)
-            break;
-        for (uint8_t j = 0; j < (cv->width < img->width ? cv->width : img->width); j++) {
-            if (x + j >= cv->width)
-                break;
-            size_t pos = (i * img->width + j) * img->channels;
-            uint8_t *pixels = img->pixels;
-            crgb final;
-            if (img->channels == 3) {
-                final.r = pixels[pos]; final.g = pixels[pos + 1]; final.b = pixels[pos + 2];
-            } else {
-                // Blend alpha (assume that alpha of canvas pixels is 1.0)
-                crgb cv_px = cv_get_pixel(cv, x + j, y + i);
-                float alpha = pixels[pos + 3] / 255.f;
-                final.r = pixels[pos] * alpha + cv_px.r * (1 - alpha);
-                final.g = pixels[pos + 1] * alpha + cv_px.g * (1 - alpha);
-                final.b = pixels[pos + 2] * alpha + cv_px.b * (1 - alpha);
+    for (uint8_t i = 0; i < len; i++) {
+        uint8_t idx = image_index(indices, bpp, ix + i);
+        uint8_t inv_alpha = img->alpha[idx];
+        if (inv_alpha == 255)
+            continue;
+        const crgb *src = &img->pixels[idx];
+        dst[i].r = src->r + mul_div255(dst[i].r, inv_alpha);
+        dst[i].g = src->g + mul_div255(dst[i].g, inv_alpha);
+        dst[i].b = src->b + mul_div255(dst[i].b, inv_alpha);
+    }
+}
+
+// Draws image with its top left corner at x, y, clipped by canvas edges.
+// Opaque rows are copied as is, the rest is blended with premultiplied alpha
+void cv_draw_image(struct canvas *cv, const struct image_desc *img, int16_t x, int16_t y)
+{
+    int16_t y1 = MAX(y, 0);
+    int16_t y2 = MIN(y + img->height, cv->height) - 1;
+    int16_t cx1 = MAX(x, 0);
+    int16_t cx2 = MIN(x + img->width, cv->width) - 1;
+    struct cv_rect d = { .x1 = 1, .x2 = 0 };
+
+    for (int16_t cy = y1; cy <= y2 && cx1 <= cx2; cy++) {
+        uint8_t iy = cy - y;
+        const struct image_row *row = &img->rows[iy];
+        int16_t x1 = MAX(cx1, x + row->x1);
+        int16_t x2 = MIN(cx2, x + row->x2);
+        if (x1 > x2)
+            continue;
+
+        crgb *dst = &cv->buf[cy * cv->width + x1];
+        uint8_t len = x2 - x1 + 1;
+        size_t offset = iy * img->width + (x1 - x);
+        if (img->bpp) {
+            draw_indexed_row(img, iy, x1 - x, len, row->opaque, dst);
+        } else if (row->opaque) {
+            memcpy(dst, &img->pixels[offset], len * sizeof(crgb));
+        } else {
+            const crgb *src = &img->pixels[offset];
+            const uint8_t *inv_alpha = &img->alpha[offset];
+            for (uint8_t i = 0; i < len; i++) {
+                if (inv_alpha[i] == 255)
+                    continue;
+                dst[i].r = src[i].r + mul_div255(dst[i].r, inv_alpha[i]);
+                dst[i].g = src[i].g + mul_div255(dst[i].g, inv_alpha[i]);
+                dst[i].b = src[i].b + mul_div255(dst[i].b, inv_alpha[i]);
             }
-            cv_set_pixel(cv, x + j, y + i, final);
         }
+
+        if (d.x1 > d.x2) {
+            d.x1 = x1; d.x2 = x2; d.y1 = cy;
+        }
+        d.x1 = MIN(d.x1, x1);
+        d.x2 = MAX(d.x2, x2);
+        d.y2 = cy;
     }
+    if (d.x1 <= d.x2)
+        cv_mark_dirty(cv, d.x1, d.y1, d.x2, d.y2);
 }
 
 // Copy contents of cv_child into cv
@@ -127,13 +301,53 @@ void cv_draw_cv(struct canvas *cv, struct canvas *cv_child, uint8_t x, uint8_t y
     for (uint8_t i = 0; i < MIN(cv_child->height, cv->height - y); i++)
         for (uint8_t j = 0; j < MIN(cv_child->width, cv->width - x); j++)
             cv->buf[(y + i) * cv->width + (x + j)] = cv_child->buf[i * cv_child->width + j];
+    cv_mark_dirty(cv, x, y, MIN(x + cv_child->width, cv->width) - 1, MIN(y + cv_child->height, cv->height) - 1);
 }
 
-void cv_draw_to_fb(struct canvas *cv, struct framebuffer *fb, uint8_t x, uint8_t y)
+// Copies the area of canvas changed since the last call into framebuffer
+void cv_copy_to_fb(struct canvas *cv, struct framebuffer *fb, uint8_t x, uint8_t y)
 {
-    for (uint8_t i = 0; i < MIN(cv->height, CONFIG_HC_MATRIX_HEIGHT - y); i++)
-        for (uint8_t j = 0; j < MIN(cv->width, CONFIG_HC_MATRIX_WIDTH - x); j++)
-            fb->buf[y + i][x + j] = cv->buf[i * cv->width + j];
+    struct cv_rect d;
+    const crgb *pixels = cv_lock_front(cv, &d);
+    if (fb_set_source(fb, NULL)) {
+        // Framebuffer was presenting another buffer, its own one is outdated
+        d.x1 = 0; d.y1 = 0;
+        d.x2 = cv->width - 1; d.y2 = cv->height - 1;
+    }
+    for (uint16_t i = d.y1; d.x1 <= d.x2 && i <= d.y2 && y + i < CONFIG_HC_MATRIX_HEIGHT; i++)
+        fb_update_row(fb, x + d.x1, y + i, &pixels[i * cv->width + d.x1], d.x2 - d.x1 + 1);
+    cv_unlock_front(cv);
+}
 
+// Copies the dirty area of canvas into framebuffer and refreshes it
+void cv_draw_to_fb(struct canvas *cv, struct framebuffer *fb, uint8_t x, uint8_t y)
+{
+    cv_copy_to_fb(cv, fb, x, y);
     fb_refresh(fb);
 }
+
+// Puts the presented frames of two canvases side by side into framebuffer,
+// the left one shifted by off pixels
+void cv_draw_slide_to_fb(struct framebuffer *fb, struct canvas *cv_l, struct canvas *cv_r, uint8_t off)
+{
+    uint8_t width = cv_l->width;
+    uint8_t height = cv_l->height;
+    struct cv_rect unused;
+
+    fb_set_source(fb, NULL);
+    // Draw the left canvas with start offset
+    const crgb *pixels = cv_lock_front(cv_l, &unused);
+    for (uint8_t y = 0; y < height; y++)
+        for (uint8_t x = off; x < width; x++)
+            fb->buf[y][x - off] = pixels[y * width + x];
+    cv_unlock_front(cv_l);
+
+    // Draw the right canvas on the rest of FB
+    pixels = cv_lock_front(cv_r, &unused);
+    for (uint8_t y = 0; y < height; y++)
+        for (uint8_t x = 0; x < off; x++)
+            fb->buf[y][width - off + x] = pixels[y * width + x];
+    cv_unlock_front(cv_r);
+
+    fb_mark_dirty_all(fb);
+}
@@ -0,0 +1,77 @@
+/* Event queues of apps. The consumer only moves tail and producers only move head,
+ * so taking events never waits for a producer. A knob event in the queue is a marker:
+ * its steps and count are accumulated in q->knob and taken when the marker is popped,
+ * so a fast turn takes one slot and no step is lost */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "event_queue.h"
+#include "metrics.h"
+#include "sdkconfig.h"
+
+#define QUEUE_MASK  (CONFIG_HC_AM_EVENT_QUEUE_LEN - 1)
+
+_Static_assert((CONFIG_HC_AM_EVENT_QUEUE_LEN & QUEUE_MASK) == 0, "Event queue length must be a power of two");
+
+void evq_init(struct event_queue *q)
+{
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->knob, 0);
+    q->dropped = 0;
+    q->lock = (portMUX_TYPE) portMUX_INITIALIZER_UNLOCKED;
+}
+
+static bool push_locked(struct event_queue *q, const struct app_event *event)
+{
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&q->tail, memory_order_acquire) > QUEUE_MASK)
+        return false;
+    q->events[head & QUEUE_MASK] = *event;
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
+
+// Returns false if the queue is full, the event is counted as dropped then
+bool evq_push(struct event_queue *q, const struct app_event *event)
+{
+    bool pushed = true;
+    portENTER_CRITICAL(&q->lock);
+    if (event->type == EVENT_KNOB) {
+        unsigned turn = ((unsigned) event->value << 16) + 1;
+        // Nothing pending means no marker in the queue, so this turn needs one
+        if (atomic_fetch_add(&q->knob, turn) != 0) {
+            metrics_add(METRICS_EVENTS_MERGED, 1);
+        } else if (!push_locked(q, event)) {
+            atomic_fetch_sub(&q->knob, turn);
+            pushed = false;
+        }
+    } else {
+        pushed = push_locked(q, event);
+    }
+    if (!pushed)
+        q->dropped++;
+    portEXIT_CRITICAL(&q->lock);
+    if (!pushed)
+        metrics_add(METRICS_EVENTS_DROPPED, 1);
+    return pushed;
+}
+
+// Called by the consumer only, returns false if the queue is empty
+bool evq_pop(struct event_queue *q, struct app_event *event)
+{
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (tail == atomic_load_explicit(&q->head, memory_order_acquire))
+        return false;
+    *event = q->events[tail & QUEUE_MASK];
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    if (event->type == EVENT_KNOB) {
+        // Turns after this point get a new marker
+        unsigned knob = atomic_exchange(&q->knob, 0);
+        event->value = (int16_t) (knob >> 16);
+        event->count = knob & 0xFFFF;
+    }
+    return true;
+}
@@ -0,0 +1,106 @@
+/* Frame sink for the host build: what would be sent to LEDs is written to numbered
+ * PPM or QOI files and/or a POSIX shared memory buffer, which a viewer can poll */
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "fb_sink.h"
+#include "sdkconfig.h"
+#if CONFIG_HC_HOST_FRAME_QOI
+#define QOI_MALLOC(sz) pvPortMalloc(sz)
+#define QOI_FREE(p)    vPortFree(p)
+#include "qoi.h"
+#endif
+
+static const char *TAG = "fb_sink";
+
+static struct fb_sink_shm *map_shm(const char *name, uint16_t width, uint16_t height)
+{
+    size_t size = sizeof(struct fb_sink_shm) + width * height * 3;
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        ESP_LOGE(TAG, "Failed to open shared memory %s", name);
+        return NULL;
+    }
+    void *ptr = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+        ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        ESP_LOGE(TAG, "Failed to map shared memory %s", name);
+        return NULL;
+    }
+    struct fb_sink_shm *shm = ptr;
+    memset(shm, 0, size);
+    shm->width = width;
+    shm->height = height;
+    shm->magic = FB_SINK_SHM_MAGIC;
+    ESP_LOGI(TAG, "Frames are mirrored to shared memory %s", name);
+    return shm;
+}
+
+esp_err_t fb_sink_new(uint16_t width, uint16_t height, struct fb_sink **ret_sink)
+{
+    struct fb_sink *sink = pvPortMalloc(sizeof(struct fb_sink));
+    if (sink == NULL)
+        return ESP_ERR_NO_MEM;
+    memset(sink, 0, sizeof(struct fb_sink));
+    sink->width = width;
+    sink->height = height;
+    sink->pixels = pvPortMalloc(width * height * 3);
+    if (sink->pixels == NULL) {
+        vPortFree(sink);
+        return ESP_ERR_NO_MEM;
+    }
+    memset(sink->pixels, 0, width * height * 3);
+    if (strcmp(CONFIG_HC_HOST_FRAME_SHM, "") != 0)
+        sink->shm = map_shm(CONFIG_HC_HOST_FRAME_SHM, width, height);
+    if (strcmp(CONFIG_HC_HOST_FRAME_DIR, "") != 0)
+        ESP_LOGI(TAG, "Frames are written to %s", CONFIG_HC_HOST_FRAME_DIR);
+    *ret_sink = sink;
+    return ESP_OK;
+}
+
+static void write_file(struct fb_sink *sink)
+{
+    char path[256];
+#if CONFIG_HC_HOST_FRAME_QOI
+    snprintf(path, sizeof(path), "%s/frame_%06" PRIu32 ".qoi", CONFIG_HC_HOST_FRAME_DIR, sink->frame);
+    qoi_desc desc = { .width = sink->width, .height = sink->height, .channels = 3, .colorspace = QOI_SRGB };
+    if (qoi_write(path, sink->pixels, &desc) == 0)
+        ESP_LOGE(TAG, "Failed to write %s", path);
+#else
+    snprintf(path, sizeof(path), "%s/frame_%06" PRIu32 ".ppm", CONFIG_HC_HOST_FRAME_DIR, sink->frame);
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to write %s", path);
+        return;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", sink->width, sink->height);
+    fwrite(sink->pixels, 1, sink->width * sink->height * 3, f);
+    fclose(f);
+#endif
+}
+
+// Publishes the frame set with fb_sink_set_pixel()
+esp_err_t fb_sink_present(struct fb_sink *sink)
+{
+    if (sink->shm != NULL) {
+        // Readers retry if the sequence is odd or changed while they copied the frame
+        uint32_t seq = sink->shm->seq;
+        __atomic_store_n(&sink->shm->seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(sink->shm + 1, sink->pixels, sink->width * sink->height * 3);
+        __atomic_store_n(&sink->shm->seq, seq + 2, __ATOMIC_RELEASE);
+    }
+    if (strcmp(CONFIG_HC_HOST_FRAME_DIR, "") != 0)
+        write_file(sink);
+    sink->frame++;
+    return ESP_OK;
+}
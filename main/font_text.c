@@ -0,0 +1,585 @@
+/* Generated by tools/gen_font.py, do not edit */
+
+#include "fonts.h"
+
+static const uint8_t text_font_data[] = {
+    0x00, 0x00,                              // SPACE
+    0x3a,                                    // EXCLAMATION MARK
+    0x30, 0x00, 0x30,                        // QUOTATION MARK
+    0x14, 0x3e, 0x14, 0x3e, 0x14,            // NUMBER SIGN
+    0x12, 0x3e, 0x24,                        // DOLLAR SIGN
+    0x26, 0x08, 0x32,                        // PERCENT SIGN
+    0x14, 0x2a, 0x14, 0x02,                  // AMPERSAND
+    0x30,                                    // APOSTROPHE
+    0x1c, 0x22,                              // LEFT PARENTHESIS
+    0x22, 0x1c,                              // RIGHT PARENTHESIS
+    0x14, 0x08, 0x14,                        // ASTERISK
+    0x08, 0x1c, 0x08,                        // PLUS SIGN
+    0x01, 0x02,                              // COMMA
+    0x08, 0x08,                              // HYPHEN-MINUS
+    0x02,                                    // FULL STOP
+    0x06, 0x08, 0x30,                        // SOLIDUS
+    0x3e, 0x22, 0x3e,                        // DIGIT ZERO
+    0x12, 0x3e, 0x02,                        // DIGIT ONE
+    0x26, 0x2a, 0x12,                        // DIGIT TWO
+    0x22, 0x2a, 0x14,                        // DIGIT THREE
+    0x38, 0x08, 0x3e,                        // DIGIT FOUR
+    0x3a, 0x2a, 0x24,                        // DIGIT FIVE
+    0x1e, 0x2a, 0x2e,                        // DIGIT SIX
+    0x20, 0x2e, 0x30,                        // DIGIT SEVEN
+    0x3e, 0x2a, 0x3e,                        // DIGIT EIGHT
+    0x3a, 0x2a, 0x3c,                        // DIGIT NINE
+    0x14,                                    // COLON
+    0x02, 0x14,                              // SEMICOLON
+    0x08, 0x14, 0x22,                        // LESS-THAN SIGN
+    0x14, 0x14, 0x14,                        // EQUALS SIGN
+    0x22, 0x14, 0x08,                        // GREATER-THAN SIGN
+    0x20, 0x2a, 0x10,                        // QUESTION MARK
+    0x1c, 0x22, 0x2a, 0x18,                  // COMMERCIAL AT
+    0x1e, 0x28, 0x1e,                        // LATIN CAPITAL LETTER A
+    0x3e, 0x2a, 0x14,                        // LATIN CAPITAL LETTER B
+    0x1c, 0x22, 0x22,                        // LATIN CAPITAL LETTER C
+    0x3e, 0x22, 0x1c,                        // LATIN CAPITAL LETTER D
+    0x3e, 0x2a, 0x22,                        // LATIN CAPITAL LETTER E
+    0x3e, 0x28, 0x20,                        // LATIN CAPITAL LETTER F
+    0x1c, 0x22, 0x2e,                        // LATIN CAPITAL LETTER G
+    0x3e, 0x08, 0x3e,                        // LATIN CAPITAL LETTER H
+    0x22, 0x3e, 0x22,                        // LATIN CAPITAL LETTER I
+    0x04, 0x02, 0x3c,                        // LATIN CAPITAL LETTER J
+    0x3e, 0x08, 0x36,                        // LATIN CAPITAL LETTER K
+    0x3e, 0x02, 0x02,                        // LATIN CAPITAL LETTER L
+    0x3e, 0x10, 0x08, 0x10, 0x3e,            // LATIN CAPITAL LETTER M
+    0x3e, 0x10, 0x08, 0x3e,                  // LATIN CAPITAL LETTER N
+    0x1c, 0x22, 0x1c,                        // LATIN CAPITAL LETTER O
+    0x3e, 0x28, 0x10,                        // LATIN CAPITAL LETTER P
+    0x1c, 0x26, 0x1a,                        // LATIN CAPITAL LETTER Q
+    0x3e, 0x28, 0x16,                        // LATIN CAPITAL LETTER R
+    0x12, 0x2a, 0x24,                        // LATIN CAPITAL LETTER S
+    0x20, 0x3e, 0x20,                        // LATIN CAPITAL LETTER T
+    0x3e, 0x02, 0x3e,                        // LATIN CAPITAL LETTER U
+    0x3c, 0x02, 0x3c,                        // LATIN CAPITAL LETTER V
+    0x3e, 0x04, 0x08, 0x04, 0x3e,            // LATIN CAPITAL LETTER W
+    0x36, 0x08, 0x36,                        // LATIN CAPITAL LETTER X
+    0x30, 0x0e, 0x30,                        // LATIN CAPITAL LETTER Y
+    0x26, 0x2a, 0x32,                        // LATIN CAPITAL LETTER Z
+    0x3e, 0x22,                              // LEFT SQUARE BRACKET
+    0x30, 0x08, 0x06,                        // REVERSE SOLIDUS
+    0x22, 0x3e,                              // RIGHT SQUARE BRACKET
+    0x10, 0x20, 0x10,                        // CIRCUMFLEX ACCENT
+    0x01, 0x01, 0x01,                        // LOW LINE
+    0x20, 0x10,                              // GRAVE ACCENT
+    0x04, 0x0a, 0x0e,                        // LATIN SMALL LETTER A
+    0x3e, 0x0a, 0x04,                        // LATIN SMALL LETTER B
+    0x04, 0x0a, 0x0a,                        // LATIN SMALL LETTER C
+    0x04, 0x0a, 0x3e,                        // LATIN SMALL LETTER D
+    0x0c, 0x16, 0x0a,                        // LATIN SMALL LETTER E
+    0x1e, 0x28,                              // LATIN SMALL LETTER F
+    0x05, 0x0b, 0x0e,                        // LATIN SMALL LETTER G
+    0x3e, 0x08, 0x06,                        // LATIN SMALL LETTER H
+    0x2e,                                    // LATIN SMALL LETTER I
+    0x01, 0x2e,                              // LATIN SMALL LETTER J
+    0x3e, 0x04, 0x0a,                        // LATIN SMALL LETTER K
+    0x3e,                                    // LATIN SMALL LETTER L
+    0x0e, 0x08, 0x0e, 0x08, 0x06,            // LATIN SMALL LETTER M
+    0x0e, 0x08, 0x06,                        // LATIN SMALL LETTER N
+    0x04, 0x0a, 0x04,                        // LATIN SMALL LETTER O
+    0x0f, 0x0a, 0x04,                        // LATIN SMALL LETTER P
+    0x04, 0x0a, 0x0f,                        // LATIN SMALL LETTER Q
+    0x06, 0x08, 0x08,                        // LATIN SMALL LETTER R
+    0x02, 0x0e, 0x08,                        // LATIN SMALL LETTER S
+    0x1c, 0x0a,                              // LATIN SMALL LETTER T
+    0x0c, 0x02, 0x0e,                        // LATIN SMALL LETTER U
+    0x0c, 0x02, 0x0c,                        // LATIN SMALL LETTER V
+    0x0c, 0x02, 0x04, 0x02, 0x0c,            // LATIN SMALL LETTER W
+    0x0a, 0x04, 0x0a,                        // LATIN SMALL LETTER X
+    0x0d, 0x03, 0x0e,                        // LATIN SMALL LETTER Y
+    0x08, 0x0e, 0x02,                        // LATIN SMALL LETTER Z
+    0x08, 0x36, 0x22,                        // LEFT CURLY BRACKET
+    0x3e,                                    // VERTICAL LINE
+    0x22, 0x36, 0x08,                        // RIGHT CURLY BRACKET
+    0x08, 0x10, 0x08, 0x10,                  // TILDE
+    0x00, 0x00,                              // NO-BREAK SPACE
+    0x2e,                                    // INVERTED EXCLAMATION MARK
+    0x1c, 0x36, 0x14,                        // CENT SIGN
+    0x0a, 0x3e, 0x2a, 0x02,                  // POUND SIGN
+    0x14, 0x08, 0x14,                        // CURRENCY SIGN
+    0x28, 0x1e, 0x28,                        // YEN SIGN
+    0x36,                                    // BROKEN BAR
+    0x0a, 0x36, 0x28,                        // SECTION SIGN
+    0x20, 0x00, 0x20,                        // DIAERESIS
+    0x1c, 0x2a, 0x36, 0x22, 0x1c,            // COPYRIGHT SIGN
+    0x12, 0x2a, 0x3a,                        // FEMININE ORDINAL INDICATOR
+    0x04, 0x0a, 0x04, 0x0a,                  // LEFT-POINTING DOUBLE ANGLE QUOTATION MARK
+    0x08, 0x08, 0x0c,                        // NOT SIGN
+    0x08, 0x08,                              // SOFT HYPHEN
+    0x1c, 0x3e, 0x32, 0x26, 0x1c,            // REGISTERED SIGN
+    0x20, 0x20, 0x20,                        // MACRON
+    0x10, 0x28, 0x10,                        // DEGREE SIGN
+    0x12, 0x3a, 0x12,                        // PLUS-MINUS SIGN
+    0x50, 0x70, 0x10,                        // SUPERSCRIPT TWO
+    0x50, 0x70, 0x20,                        // SUPERSCRIPT THREE
+    0x10, 0x20,                              // ACUTE ACCENT
+    0x0f, 0x02, 0x0e,                        // MICRO SIGN
+    0x10, 0x38, 0x20, 0x3e,                  // PILCROW SIGN
+    0x08,                                    // MIDDLE DOT
+    0x01, 0x01,                              // CEDILLA
+    0x20, 0x70, 0x00,                        // SUPERSCRIPT ONE
+    0x12, 0x2a, 0x12,                        // MASCULINE ORDINAL INDICATOR
+    0x0a, 0x04, 0x0a, 0x04,                  // RIGHT-POINTING DOUBLE ANGLE QUOTATION MARK
+    0x32, 0x04, 0x08, 0x16, 0x22,            // VULGAR FRACTION ONE QUARTER
+    0x32, 0x04, 0x08, 0x12, 0x26,            // VULGAR FRACTION ONE HALF
+    0x2a, 0x3c, 0x18, 0x06, 0x22,            // VULGAR FRACTION THREE QUARTERS
+    0x04, 0x2a, 0x02,                        // INVERTED QUESTION MARK
+    0x9e, 0x68, 0x1e,                        // LATIN CAPITAL LETTER A WITH GRAVE
+    0x1e, 0x68, 0x9e,                        // LATIN CAPITAL LETTER A WITH ACUTE
+    0x5e, 0xa8, 0x5e,                        // LATIN CAPITAL LETTER A WITH CIRCUMFLEX
+    0x5e, 0xe8, 0x9e,                        // LATIN CAPITAL LETTER A WITH TILDE
+    0x5e, 0x28, 0x5e,                        // LATIN CAPITAL LETTER A WITH DIAERESIS
+    0xde, 0xa8, 0xde,                        // LATIN CAPITAL LETTER A WITH RING ABOVE
+    0x1e, 0x28, 0x3e, 0x2a, 0x22,            // LATIN CAPITAL LETTER AE
+    0x1c, 0x23, 0x22,                        // LATIN CAPITAL LETTER C WITH CEDILLA
+    0xbe, 0x6a, 0x22,                        // LATIN CAPITAL LETTER E WITH GRAVE
+    0x3e, 0x6a, 0xa2,                        // LATIN CAPITAL LETTER E WITH ACUTE
+    0x7e, 0xaa, 0x62,                        // LATIN CAPITAL LETTER E WITH CIRCUMFLEX
+    0x7e, 0x2a, 0x62,                        // LATIN CAPITAL LETTER E WITH DIAERESIS
+    0xa2, 0x7e, 0x22,                        // LATIN CAPITAL LETTER I WITH GRAVE
+    0x22, 0x7e, 0xa2,                        // LATIN CAPITAL LETTER I WITH ACUTE
+    0x62, 0xbe, 0x62,                        // LATIN CAPITAL LETTER I WITH CIRCUMFLEX
+    0x62, 0x3e, 0x62,                        // LATIN CAPITAL LETTER I WITH DIAERESIS
+    0x08, 0x3e, 0x2a, 0x1c,                  // LATIN CAPITAL LETTER ETH
+    0x7e, 0xd0, 0x88, 0x3e,                  // LATIN CAPITAL LETTER N WITH TILDE
+    0x9c, 0x62, 0x1c,                        // LATIN CAPITAL LETTER O WITH GRAVE
+    0x1c, 0x62, 0x9c,                        // LATIN CAPITAL LETTER O WITH ACUTE
+    0x5c, 0xa2, 0x5c,                        // LATIN CAPITAL LETTER O WITH CIRCUMFLEX
+    0x5c, 0xe2, 0x9c,                        // LATIN CAPITAL LETTER O WITH TILDE
+    0x5c, 0x22, 0x5c,                        // LATIN CAPITAL LETTER O WITH DIAERESIS
+    0x14, 0x08, 0x14,                        // MULTIPLICATION SIGN
+    0x1e, 0x2a, 0x3c,                        // LATIN CAPITAL LETTER O WITH STROKE
+    0xbe, 0x42, 0x3e,                        // LATIN CAPITAL LETTER U WITH GRAVE
+    0x3e, 0x42, 0xbe,                        // LATIN CAPITAL LETTER U WITH ACUTE
+    0x7e, 0x82, 0x7e,                        // LATIN CAPITAL LETTER U WITH CIRCUMFLEX
+    0x7e, 0x02, 0x7e,                        // LATIN CAPITAL LETTER U WITH DIAERESIS
+    0x30, 0x4e, 0xb0,                        // LATIN CAPITAL LETTER Y WITH ACUTE
+    0x3e, 0x14, 0x08,                        // LATIN CAPITAL LETTER THORN
+    0x1e, 0x2a, 0x14,                        // LATIN SMALL LETTER SHARP S
+    0x24, 0x1a, 0x0e,                        // LATIN SMALL LETTER A WITH GRAVE
+    0x04, 0x1a, 0x2e,                        // LATIN SMALL LETTER A WITH ACUTE
+    0x14, 0x2a, 0x1e,                        // LATIN SMALL LETTER A WITH CIRCUMFLEX
+    0x14, 0x3a, 0x2e,                        // LATIN SMALL LETTER A WITH TILDE
+    0x14, 0x0a, 0x1e,                        // LATIN SMALL LETTER A WITH DIAERESIS
+    0x34, 0x2a, 0x3e,                        // LATIN SMALL LETTER A WITH RING ABOVE
+    0x04, 0x0a, 0x06, 0x0c, 0x06,            // LATIN SMALL LETTER AE
+    0x04, 0x0b, 0x0a,                        // LATIN SMALL LETTER C WITH CEDILLA
+    0x4c, 0x36, 0x0a,                        // LATIN SMALL LETTER E WITH GRAVE
+    0x0c, 0x36, 0x4a,                        // LATIN SMALL LETTER E WITH ACUTE
+    0x2c, 0x56, 0x2a,                        // LATIN SMALL LETTER E WITH CIRCUMFLEX
+    0x2c, 0x16, 0x2a,                        // LATIN SMALL LETTER E WITH DIAERESIS
+    0x1e,                                    // LATIN SMALL LETTER I WITH GRAVE
+    0x1e,                                    // LATIN SMALL LETTER I WITH ACUTE
+    0x2e,                                    // LATIN SMALL LETTER I WITH CIRCUMFLEX
+    0x0e,                                    // LATIN SMALL LETTER I WITH DIAERESIS
+    0x14, 0x3a, 0x1c,                        // LATIN SMALL LETTER ETH
+    0x1e, 0x38, 0x26,                        // LATIN SMALL LETTER N WITH TILDE
+    0x24, 0x1a, 0x04,                        // LATIN SMALL LETTER O WITH GRAVE
+    0x04, 0x1a, 0x24,                        // LATIN SMALL LETTER O WITH ACUTE
+    0x14, 0x2a, 0x14,                        // LATIN SMALL LETTER O WITH CIRCUMFLEX
+    0x14, 0x3a, 0x24,                        // LATIN SMALL LETTER O WITH TILDE
+    0x14, 0x0a, 0x14,                        // LATIN SMALL LETTER O WITH DIAERESIS
+    0x08, 0x1c, 0x08,                        // DIVISION SIGN
+    0x06, 0x0a, 0x0c,                        // LATIN SMALL LETTER O WITH STROKE
+    0x2c, 0x12, 0x0e,                        // LATIN SMALL LETTER U WITH GRAVE
+    0x0c, 0x12, 0x2e,                        // LATIN SMALL LETTER U WITH ACUTE
+    0x1c, 0x22, 0x1e,                        // LATIN SMALL LETTER U WITH CIRCUMFLEX
+    0x1c, 0x02, 0x1e,                        // LATIN SMALL LETTER U WITH DIAERESIS
+    0x0d, 0x13, 0x2e,                        // LATIN SMALL LETTER Y WITH ACUTE
+    0x3f, 0x0a, 0x04,                        // LATIN SMALL LETTER THORN
+    0x1d, 0x03, 0x1e,                        // LATIN SMALL LETTER Y WITH DIAERESIS
+    0x7e, 0x2a, 0x62,                        // CYRILLIC CAPITAL LETTER IO
+    0x3e, 0x60, 0xa0,                        // CYRILLIC CAPITAL LETTER GJE
+    0x1c, 0x2a, 0x22,                        // CYRILLIC CAPITAL LETTER UKRAINIAN IE
+    0x12, 0x2a, 0x24,                        // CYRILLIC CAPITAL LETTER DZE
+    0x22, 0x3e, 0x22,                        // CYRILLIC CAPITAL LETTER BYELORUSSIAN-UKRAINIAN I
+    0x62, 0x3e, 0x62,                        // CYRILLIC CAPITAL LETTER YI
+    0x04, 0x02, 0x3c,                        // CYRILLIC CAPITAL LETTER JE
+    0x3e, 0x48, 0xb6,                        // CYRILLIC CAPITAL LETTER KJE
+    0xbe, 0x44, 0x08, 0x3e,                  // CYRILLIC CAPITAL LETTER I WITH GRAVE
+    0xb2, 0x4a, 0xbc,                        // CYRILLIC CAPITAL LETTER SHORT U
+    0x3e, 0x03, 0x3e,                        // CYRILLIC CAPITAL LETTER DZHE
+    0x1e, 0x28, 0x1e,                        // CYRILLIC CAPITAL LETTER A
+    0x3e, 0x2a, 0x24,                        // CYRILLIC CAPITAL LETTER BE
+    0x3e, 0x2a, 0x14,                        // CYRILLIC CAPITAL LETTER VE
+    0x3e, 0x20, 0x20,                        // CYRILLIC CAPITAL LETTER GHE
+    0x06, 0x3c, 0x24, 0x3e,                  // CYRILLIC CAPITAL LETTER DE
+    0x3e, 0x2a, 0x22,                        // CYRILLIC CAPITAL LETTER IE
+    0x36, 0x08, 0x3e, 0x08, 0x36,            // CYRILLIC CAPITAL LETTER ZHE
+    0x22, 0x2a, 0x14,                        // CYRILLIC CAPITAL LETTER ZE
+    0x3e, 0x04, 0x08, 0x3e,                  // CYRILLIC CAPITAL LETTER I
+    0xbe, 0x44, 0x88, 0x3e,                  // CYRILLIC CAPITAL LETTER SHORT I
+    0x3e, 0x08, 0x36,                        // CYRILLIC CAPITAL LETTER KA
+    0x1e, 0x20, 0x3e,                        // CYRILLIC CAPITAL LETTER EL
+    0x3e, 0x10, 0x08, 0x10, 0x3e,            // CYRILLIC CAPITAL LETTER EM
+    0x3e, 0x08, 0x3e,                        // CYRILLIC CAPITAL LETTER EN
+    0x1c, 0x22, 0x1c,                        // CYRILLIC CAPITAL LETTER O
+    0x3e, 0x20, 0x3e,                        // CYRILLIC CAPITAL LETTER PE
+    0x3e, 0x28, 0x10,                        // CYRILLIC CAPITAL LETTER ER
+    0x1c, 0x22, 0x22,                        // CYRILLIC CAPITAL LETTER ES
+    0x20, 0x3e, 0x20,                        // CYRILLIC CAPITAL LETTER TE
+    0x32, 0x0a, 0x3c,                        // CYRILLIC CAPITAL LETTER U
+    0x18, 0x24, 0x3e, 0x24, 0x18,            // CYRILLIC CAPITAL LETTER EF
+    0x36, 0x08, 0x36,                        // CYRILLIC CAPITAL LETTER HA
+    0x3e, 0x02, 0x3e, 0x03,                  // CYRILLIC CAPITAL LETTER TSE
+    0x30, 0x08, 0x3e,                        // CYRILLIC CAPITAL LETTER CHE
+    0x3e, 0x02, 0x3e, 0x02, 0x3e,            // CYRILLIC CAPITAL LETTER SHA
+    0x3e, 0x02, 0x3e, 0x02, 0x3e, 0x03,      // CYRILLIC CAPITAL LETTER SHCHA
+    0x20, 0x3e, 0x0a, 0x04,                  // CYRILLIC CAPITAL LETTER HARD SIGN
+    0x3e, 0x0a, 0x04, 0x00, 0x3e,            // CYRILLIC CAPITAL LETTER YERU
+    0x3e, 0x0a, 0x04,                        // CYRILLIC CAPITAL LETTER SOFT SIGN
+    0x22, 0x2a, 0x1c,                        // CYRILLIC CAPITAL LETTER E
+    0x3e, 0x08, 0x1c, 0x22, 0x1c,            // CYRILLIC CAPITAL LETTER YU
+    0x16, 0x28, 0x3e,                        // CYRILLIC CAPITAL LETTER YA
+    0x04, 0x0a, 0x0e,                        // CYRILLIC SMALL LETTER A
+    0x1e, 0x2a, 0x2e,                        // CYRILLIC SMALL LETTER BE
+    0x0e, 0x0e, 0x04,                        // CYRILLIC SMALL LETTER VE
+    0x0e, 0x08, 0x08,                        // CYRILLIC SMALL LETTER GHE
+    0x03, 0x0e, 0x0f,                        // CYRILLIC SMALL LETTER DE
+    0x0c, 0x16, 0x0a,                        // CYRILLIC SMALL LETTER IE
+    0x0a, 0x04, 0x0e, 0x04, 0x0a,            // CYRILLIC SMALL LETTER ZHE
+    0x0a, 0x0e, 0x04,                        // CYRILLIC SMALL LETTER ZE
+    0x0e, 0x02, 0x04, 0x0e,                  // CYRILLIC SMALL LETTER I
+    0x2e, 0x12, 0x24, 0x0e,                  // CYRILLIC SMALL LETTER SHORT I
+    0x0e, 0x04, 0x0a,                        // CYRILLIC SMALL LETTER KA
+    0x06, 0x08, 0x0e,                        // CYRILLIC SMALL LETTER EL
+    0x0e, 0x04, 0x02, 0x04, 0x0e,            // CYRILLIC SMALL LETTER EM
+    0x0e, 0x04, 0x0e,                        // CYRILLIC SMALL LETTER EN
+    0x04, 0x0a, 0x04,                        // CYRILLIC SMALL LETTER O
+    0x0e, 0x08, 0x0e,                        // CYRILLIC SMALL LETTER PE
+    0x0f, 0x0a, 0x04,                        // CYRILLIC SMALL LETTER ER
+    0x04, 0x0a, 0x0a,                        // CYRILLIC SMALL LETTER ES
+    0x08, 0x0e, 0x08,                        // CYRILLIC SMALL LETTER TE
+    0x0d, 0x03, 0x0e,                        // CYRILLIC SMALL LETTER U
+    0x04, 0x0a, 0x1f, 0x0a, 0x04,            // CYRILLIC SMALL LETTER EF
+    0x0a, 0x04, 0x0a,                        // CYRILLIC SMALL LETTER HA
+    0x0e, 0x02, 0x0e, 0x03,                  // CYRILLIC SMALL LETTER TSE
+    0x08, 0x04, 0x0e,                        // CYRILLIC SMALL LETTER CHE
+    0x0e, 0x02, 0x0e, 0x02, 0x0e,            // CYRILLIC SMALL LETTER SHA
+    0x0e, 0x02, 0x0e, 0x02, 0x0e, 0x03,      // CYRILLIC SMALL LETTER SHCHA
+    0x08, 0x0e, 0x06, 0x00,                  // CYRILLIC SMALL LETTER HARD SIGN
+    0x0e, 0x06, 0x00, 0x0e,                  // CYRILLIC SMALL LETTER YERU
+    0x0e, 0x06, 0x00,                        // CYRILLIC SMALL LETTER SOFT SIGN
+    0x0a, 0x0a, 0x04,                        // CYRILLIC SMALL LETTER E
+    0x0e, 0x04, 0x0e, 0x0a, 0x0e,            // CYRILLIC SMALL LETTER YU
+    0x02, 0x0c, 0x0e,                        // CYRILLIC SMALL LETTER YA
+    0x4c, 0x36, 0x0a,                        // CYRILLIC SMALL LETTER IE WITH GRAVE
+    0x2c, 0x16, 0x2a,                        // CYRILLIC SMALL LETTER IO
+    0x0e, 0x18, 0x28,                        // CYRILLIC SMALL LETTER GJE
+    0x04, 0x0e, 0x0a,                        // CYRILLIC SMALL LETTER UKRAINIAN IE
+    0x02, 0x0e, 0x08,                        // CYRILLIC SMALL LETTER DZE
+    0x2e,                                    // CYRILLIC SMALL LETTER BYELORUSSIAN-UKRAINIAN I
+    0x2e,                                    // CYRILLIC SMALL LETTER YI
+    0x01, 0x2e,                              // CYRILLIC SMALL LETTER JE
+    0x0e, 0x14, 0x2a,                        // CYRILLIC SMALL LETTER KJE
+    0x2e, 0x12, 0x04, 0x0e,                  // CYRILLIC SMALL LETTER I WITH GRAVE
+    0x2d, 0x13, 0x2e,                        // CYRILLIC SMALL LETTER SHORT U
+    0x0e, 0x03, 0x0e,                        // CYRILLIC SMALL LETTER DZHE
+};
+
+static const struct text_glyph text_font_glyphs[] = {
+    { 0, 2 },
+    { 2, 1 },
+    { 3, 3 },
+    { 6, 5 },
+    { 11, 3 },
+    { 14, 3 },
+    { 17, 4 },
+    { 21, 1 },
+    { 22, 2 },
+    { 24, 2 },
+    { 26, 3 },
+    { 29, 3 },
+    { 32, 2 },
+    { 34, 2 },
+    { 36, 1 },
+    { 37, 3 },
+    { 40, 3 },
+    { 43, 3 },
+    { 46, 3 },
+    { 49, 3 },
+    { 52, 3 },
+    { 55, 3 },
+    { 58, 3 },
+    { 61, 3 },
+    { 64, 3 },
+    { 67, 3 },
+    { 70, 1 },
+    { 71, 2 },
+    { 73, 3 },
+    { 76, 3 },
+    { 79, 3 },
+    { 82, 3 },
+    { 85, 4 },
+    { 89, 3 },
+    { 92, 3 },
+    { 95, 3 },
+    { 98, 3 },
+    { 101, 3 },
+    { 104, 3 },
+    { 107, 3 },
+    { 110, 3 },
+    { 113, 3 },
+    { 116, 3 },
+    { 119, 3 },
+    { 122, 3 },
+    { 125, 5 },
+    { 130, 4 },
+    { 134, 3 },
+    { 137, 3 },
+    { 140, 3 },
+    { 143, 3 },
+    { 146, 3 },
+    { 149, 3 },
+    { 152, 3 },
+    { 155, 3 },
+    { 158, 5 },
+    { 163, 3 },
+    { 166, 3 },
+    { 169, 3 },
+    { 172, 2 },
+    { 174, 3 },
+    { 177, 2 },
+    { 179, 3 },
+    { 182, 3 },
+    { 185, 2 },
+    { 187, 3 },
+    { 190, 3 },
+    { 193, 3 },
+    { 196, 3 },
+    { 199, 3 },
+    { 202, 2 },
+    { 204, 3 },
+    { 207, 3 },
+    { 210, 1 },
+    { 211, 2 },
+    { 213, 3 },
+    { 216, 1 },
+    { 217, 5 },
+    { 222, 3 },
+    { 225, 3 },
+    { 228, 3 },
+    { 231, 3 },
+    { 234, 3 },
+    { 237, 3 },
+    { 240, 2 },
+    { 242, 3 },
+    { 245, 3 },
+    { 248, 5 },
+    { 253, 3 },
+    { 256, 3 },
+    { 259, 3 },
+    { 262, 3 },
+    { 265, 1 },
+    { 266, 3 },
+    { 269, 4 },
+    { 273, 2 },
+    { 275, 1 },
+    { 276, 3 },
+    { 279, 4 },
+    { 283, 3 },
+    { 286, 3 },
+    { 289, 1 },
+    { 290, 3 },
+    { 293, 3 },
+    { 296, 5 },
+    { 301, 3 },
+    { 304, 4 },
+    { 308, 3 },
+    { 311, 2 },
+    { 313, 5 },
+    { 318, 3 },
+    { 321, 3 },
+    { 324, 3 },
+    { 327, 3 },
+    { 330, 3 },
+    { 333, 2 },
+    { 335, 3 },
+    { 338, 4 },
+    { 342, 1 },
+    { 343, 2 },
+    { 345, 3 },
+    { 348, 3 },
+    { 351, 4 },
+    { 355, 5 },
+    { 360, 5 },
+    { 365, 5 },
+    { 370, 3 },
+    { 373, 3 },
+    { 376, 3 },
+    { 379, 3 },
+    { 382, 3 },
+    { 385, 3 },
+    { 388, 3 },
+    { 391, 5 },
+    { 396, 3 },
+    { 399, 3 },
+    { 402, 3 },
+    { 405, 3 },
+    { 408, 3 },
+    { 411, 3 },
+    { 414, 3 },
+    { 417, 3 },
+    { 420, 3 },
+    { 423, 4 },
+    { 427, 4 },
+    { 431, 3 },
+    { 434, 3 },
+    { 437, 3 },
+    { 440, 3 },
+    { 443, 3 },
+    { 446, 3 },
+    { 449, 3 },
+    { 452, 3 },
+    { 455, 3 },
+    { 458, 3 },
+    { 461, 3 },
+    { 464, 3 },
+    { 467, 3 },
+    { 470, 3 },
+    { 473, 3 },
+    { 476, 3 },
+    { 479, 3 },
+    { 482, 3 },
+    { 485, 3 },
+    { 488, 3 },
+    { 491, 5 },
+    { 496, 3 },
+    { 499, 3 },
+    { 502, 3 },
+    { 505, 3 },
+    { 508, 3 },
+    { 511, 1 },
+    { 512, 1 },
+    { 513, 1 },
+    { 514, 1 },
+    { 515, 3 },
+    { 518, 3 },
+    { 521, 3 },
+    { 524, 3 },
+    { 527, 3 },
+    { 530, 3 },
+    { 533, 3 },
+    { 536, 3 },
+    { 539, 3 },
+    { 542, 3 },
+    { 545, 3 },
+    { 548, 3 },
+    { 551, 3 },
+    { 554, 3 },
+    { 557, 3 },
+    { 560, 3 },
+    { 563, 3 },
+    { 566, 3 },
+    { 569, 3 },
+    { 572, 3 },
+    { 575, 3 },
+    { 578, 3 },
+    { 581, 3 },
+    { 584, 3 },
+    { 587, 4 },
+    { 591, 3 },
+    { 594, 3 },
+    { 597, 3 },
+    { 600, 3 },
+    { 603, 3 },
+    { 606, 3 },
+    { 609, 4 },
+    { 613, 3 },
+    { 616, 5 },
+    { 621, 3 },
+    { 624, 4 },
+    { 628, 4 },
+    { 632, 3 },
+    { 635, 3 },
+    { 638, 5 },
+    { 643, 3 },
+    { 646, 3 },
+    { 649, 3 },
+    { 652, 3 },
+    { 655, 3 },
+    { 658, 3 },
+    { 661, 3 },
+    { 664, 5 },
+    { 669, 3 },
+    { 672, 4 },
+    { 676, 3 },
+    { 679, 5 },
+    { 684, 6 },
+    { 690, 4 },
+    { 694, 5 },
+    { 699, 3 },
+    { 702, 3 },
+    { 705, 5 },
+    { 710, 3 },
+    { 713, 3 },
+    { 716, 3 },
+    { 719, 3 },
+    { 722, 3 },
+    { 725, 3 },
+    { 728, 3 },
+    { 731, 5 },
+    { 736, 3 },
+    { 739, 4 },
+    { 743, 4 },
+    { 747, 3 },
+    { 750, 3 },
+    { 753, 5 },
+    { 758, 3 },
+    { 761, 3 },
+    { 764, 3 },
+    { 767, 3 },
+    { 770, 3 },
+    { 773, 3 },
+    { 776, 3 },
+    { 779, 5 },
+    { 784, 3 },
+    { 787, 4 },
+    { 791, 3 },
+    { 794, 5 },
+    { 799, 6 },
+    { 805, 4 },
+    { 809, 4 },
+    { 813, 3 },
+    { 816, 3 },
+    { 819, 5 },
+    { 824, 3 },
+    { 827, 3 },
+    { 830, 3 },
+    { 833, 3 },
+    { 836, 3 },
+    { 839, 3 },
+    { 842, 1 },
+    { 843, 1 },
+    { 844, 2 },
+    { 846, 3 },
+    { 849, 4 },
+    { 853, 3 },
+    { 856, 3 },
+};
+
+static const struct text_font_range text_font_ranges[] = {
+    { 0x0020, 95, 0 },
+    { 0x00a0, 96, 95 },
+    { 0x0401, 1, 191 },
+    { 0x0403, 6, 192 },
+    { 0x040c, 70, 198 },
+    { 0x0453, 6, 268 },
+    { 0x045c, 4, 274 },
+};
+
+const struct text_font text_font = {
+    .height = 8,
+    .spacing = 1,
+    .fallback = 31,
+    .range_count = 7,
+    .ranges = text_font_ranges,
+    .glyphs = text_font_glyphs,
+    .data = text_font_data
+};
@@ -37,3 +37,20 @@ const struct bitmap_font digits_7x7_font = {
     .height = 7,
     .data = font7x7
 };
+
+// Binary search over ranges of the font, falls back to the replacement glyph
+const struct text_glyph *font_find_glyph(const struct text_font *font, uint32_t code)
+{
+    uint8_t lo = 0, hi = font->range_count;
+    while (lo < hi) {
+        uint8_t mid = (lo + hi) / 2;
+        const struct text_font_range *range = &font->ranges[mid];
+        if (code < range->first)
+            hi = mid;
+        else if (code >= range->first + range->count)
+            lo = mid + 1;
+        else
+            return &font->glyphs[range->glyph + code - range->first];
+    }
+    return &font->glyphs[font->fallback];
+}
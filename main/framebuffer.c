@@ -1,25 +1,129 @@
+#include <math.h>
 #include <stdint.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "framebuffer.h"
-#include "led_strip.h"
+#include "metrics.h"
 #include "sdkconfig.h"
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+#include "led_spi.h"
+#elif CONFIG_HC_FB_OUTPUT_HOST_SINK
+#include "fb_sink.h"
+#else
+#include "led_strip.h"
+#endif
+
+// Physical matrix size, swapped with the displayed one when rotated by 90 or 270 degrees
+#if CONFIG_HC_MATRIX_ROTATION == 90 || CONFIG_HC_MATRIX_ROTATION == 270
+#define PHYS_WIDTH      CONFIG_HC_MATRIX_HEIGHT
+#define PHYS_HEIGHT     CONFIG_HC_MATRIX_WIDTH
+#else
+#define PHYS_WIDTH      CONFIG_HC_MATRIX_WIDTH
+#define PHYS_HEIGHT     CONFIG_HC_MATRIX_HEIGHT
+#endif
+
+#define TILE_WIDTH      (PHYS_WIDTH / CONFIG_HC_MATRIX_TILES_X)
+#define TILE_HEIGHT     (PHYS_HEIGHT / CONFIG_HC_MATRIX_TILES_Y)
+
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+// Offsets of color components inside the encoded LED
+#if CONFIG_HC_STRIP_COLOR_ORDER_GRB
+#define SPI_OFFSET_R    (1 * LED_SPI_BYTES_PER_COLOR)
+#define SPI_OFFSET_G    (0 * LED_SPI_BYTES_PER_COLOR)
+#else
+#define SPI_OFFSET_R    (0 * LED_SPI_BYTES_PER_COLOR)
+#define SPI_OFFSET_G    (1 * LED_SPI_BYTES_PER_COLOR)
+#endif
+#define SPI_OFFSET_B    (2 * LED_SPI_BYTES_PER_COLOR)
+#endif /* CONFIG_HC_FB_OUTPUT_SPI_DIRECT */
+
+#if PHYS_WIDTH % CONFIG_HC_MATRIX_TILES_X || PHYS_HEIGHT % CONFIG_HC_MATRIX_TILES_Y
+#error "Matrix size must be divisible by the number of panels"
+#endif
 
-static uint16_t matrix_led_index(uint8_t x, uint8_t y)
+// Maps physical coordinates to the LED index in chain
+static uint16_t matrix_led_index(uint16_t x, uint16_t y)
 {
+    // Find panel and its position in chain
+    uint16_t tile_x = x / TILE_WIDTH;
+    uint16_t tile_y = y / TILE_HEIGHT;
+#ifdef CONFIG_HC_MATRIX_TILE_CHAIN_SERPENTINE
+    if (tile_y & 1)
+        tile_x = CONFIG_HC_MATRIX_TILES_X - tile_x - 1;
+#endif
+    uint16_t tile_idx = tile_y * CONFIG_HC_MATRIX_TILES_X + tile_x;
+    x %= TILE_WIDTH;
+    y %= TILE_HEIGHT;
+
 #ifdef CONFIG_HC_MATRIX_TYPE_SERPENTINE
 #ifdef CONFIG_HC_MATRIX_SERPENTINE_DIR_NORMAL
     // Serpentine, first LED is in the top-left corner
-    uint8_t row_x = (y & 1) ? (CONFIG_HC_MATRIX_WIDTH - x - 1) : x;
+    bool inversed = false;
 #else
     // Serpentine, first LED is in the top-right corner (inversed)
-    uint8_t row_x = (y & 1) ? x : (CONFIG_HC_MATRIX_WIDTH - x - 1);
+    bool inversed = true;
 #endif /* CONFIG_HC_MATRIX_SERPENTINE_DIR_NORMAL */
-    return y * CONFIG_HC_MATRIX_HEIGHT + row_x;
+    if (tile_idx < 32 && (CONFIG_HC_MATRIX_TILE_INVERSED_MASK >> tile_idx) & 1)
+        inversed = !inversed;
+    uint16_t row_x = ((y & 1) != inversed) ? (TILE_WIDTH - x - 1) : x;
 #else
     // Parallel, left-to-right layout
-    return y * CONFIG_HC_MATRIX_HEIGHT + x;
+    uint16_t row_x = x;
 #endif /* CONFIG_HC_MATRIX_TYPE_SERPENTINE */
+    return tile_idx * TILE_WIDTH * TILE_HEIGHT + y * TILE_WIDTH + row_x;
+}
+
+// Fills pixel -> LED lookup table, applying rotation and mirroring
+static void build_led_map(struct framebuffer *fb)
+{
+    for (uint16_t y = 0; y < CONFIG_HC_MATRIX_HEIGHT; y++)
+        for (uint16_t x = 0; x < CONFIG_HC_MATRIX_WIDTH; x++) {
+            uint16_t mx = x, my = y;
+#ifdef CONFIG_HC_MATRIX_MIRROR_X
+            mx = CONFIG_HC_MATRIX_WIDTH - x - 1;
+#endif
+#ifdef CONFIG_HC_MATRIX_MIRROR_Y
+            my = CONFIG_HC_MATRIX_HEIGHT - y - 1;
+#endif
+            uint16_t px, py;
+#if CONFIG_HC_MATRIX_ROTATION == 90
+            px = PHYS_WIDTH - my - 1;
+            py = mx;
+#elif CONFIG_HC_MATRIX_ROTATION == 180
+            px = PHYS_WIDTH - mx - 1;
+            py = PHYS_HEIGHT - my - 1;
+#elif CONFIG_HC_MATRIX_ROTATION == 270
+            px = my;
+            py = PHYS_HEIGHT - mx - 1;
+#else
+            px = mx;
+            py = my;
+#endif
+            fb->led_map[y * CONFIG_HC_MATRIX_WIDTH + x] = matrix_led_index(px, py);
+        }
+}
+
+static const uint8_t white_balance[3] = {
+    CONFIG_HC_FB_WHITE_BALANCE_R,
+    CONFIG_HC_FB_WHITE_BALANCE_G,
+    CONFIG_HC_FB_WHITE_BALANCE_B
+};
+
+// Builds output table, the only place where floats are used
+static void build_lut(struct framebuffer *fb)
+{
+    const float gamma = CONFIG_HC_FB_GAMMA / 10.f;
+    for (uint8_t c = 0; c < 3; c++) {
+        float scale = fb->brightness * white_balance[c] / 255.f;
+        for (uint16_t i = 0; i < 256; i++)
+            fb->lut[c][i] = (uint8_t) lroundf(powf(i / 255.f, gamma) * scale);
+    }
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+    for (uint8_t c = 0; c < 3; c++)
+        for (uint16_t i = 0; i < 256; i++)
+            led_spi_encode_byte(fb->lut[c][i], fb->spi_lut[c][i]);
+#endif
+    fb->lut_brightness = fb->brightness;
 }
 
 crgb crgb_mult(crgb a, float mult)
@@ -28,34 +132,174 @@ crgb crgb_mult(crgb a, float mult)
     return res;
 }
 
-struct framebuffer *fb_init(led_strip_handle_t led_strip, uint8_t brightness)
+struct framebuffer *fb_init(fb_output_t output, uint8_t brightness)
 {
     struct framebuffer *fb = pvPortMalloc(sizeof(struct framebuffer));
-    fb->led_strip = led_strip;
+    fb->output = output;
+    fb->src = &fb->buf[0][0];
     fb->brightness = brightness;
+    build_lut(fb);
+    build_led_map(fb);
+    // Blanking marks the whole matrix dirty, so the first refresh pushes everything
     fb_blank(fb);
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+    memcpy(fb->stale_rows, fb->dirty_rows, sizeof(fb->stale_rows));
+#endif
     return fb;
 }
 
+void fb_set_brightness(struct framebuffer *fb, uint8_t brightness)
+{
+    if (brightness == fb->lut_brightness)
+        return;
+    fb->brightness = brightness;
+    build_lut(fb);
+    fb_mark_dirty_all(fb);
+}
+
 void fb_blank(struct framebuffer *fb)
 {
+    fb->src = &fb->buf[0][0];
     memset(fb->buf, 0, CONFIG_HC_MATRIX_HEIGHT * CONFIG_HC_MATRIX_WIDTH * sizeof(crgb));
+    fb_mark_dirty_all(fb);
 }
 
 void fb_fill(struct framebuffer *fb, crgb color)
 {
+    fb->src = &fb->buf[0][0];
     for (uint8_t y = 0; y < CONFIG_HC_MATRIX_HEIGHT; y++)
         for (uint8_t x = 0; x < CONFIG_HC_MATRIX_WIDTH; x++)
             fb->buf[y][x] = color;
+    fb_mark_dirty_all(fb);
 }
 
-void fb_refresh(struct framebuffer *fb)
+// Sets pixels to be sent by fb_refresh(), NULL means framebuffer's own buffer.
+// Other buffer is read directly, without copying into framebuffer.
+// Returns true if the source was changed, in this case all rows are marked dirty
+bool fb_set_source(struct framebuffer *fb, const crgb *src)
 {
-    for (uint8_t y = 0; y < CONFIG_HC_MATRIX_HEIGHT; y++)
-        for (uint8_t x = 0; x < CONFIG_HC_MATRIX_WIDTH; x++) {
-            // Apply brightness
-            crgb pixel = crgb_mult(fb->buf[y][x], fb->brightness / 255.f);
-            led_strip_set_pixel(fb->led_strip, matrix_led_index(x, y), pixel.r, pixel.g, pixel.b);
+    if (src == NULL)
+        src = &fb->buf[0][0];
+    if (src == fb->src)
+        return false;
+    fb->src = src;
+    fb_mark_dirty_all(fb);
+    return true;
+}
+
+// Marks rows y1..y2 (inclusive) to be re-sent on the next refresh
+void fb_mark_dirty(struct framebuffer *fb, uint8_t y1, uint8_t y2)
+{
+    for (uint8_t y = y1; y <= y2 && y < CONFIG_HC_MATRIX_HEIGHT; y++)
+        fb->dirty_rows[y / 32] |= 1UL << (y % 32);
+}
+
+void fb_mark_dirty_all(struct framebuffer *fb)
+{
+    fb_mark_dirty(fb, 0, CONFIG_HC_MATRIX_HEIGHT - 1);
+}
+
+bool fb_is_dirty(struct framebuffer *fb)
+{
+    for (uint8_t i = 0; i < FB_DIRTY_WORDS; i++)
+        if (fb->dirty_rows[i])
+            return true;
+    return false;
+}
+
+// Copies len pixels into row y starting at x, marks the row dirty only if its contents changed.
+// Returns true if the row was changed
+bool fb_update_row(struct framebuffer *fb, uint8_t x, uint8_t y, const crgb *src, uint8_t len)
+{
+    if (y >= CONFIG_HC_MATRIX_HEIGHT || x >= CONFIG_HC_MATRIX_WIDTH)
+        return false;
+    if (len > CONFIG_HC_MATRIX_WIDTH - x)
+        len = CONFIG_HC_MATRIX_WIDTH - x;
+
+    crgb *dst = &fb->buf[y][x];
+    if (memcmp(dst, src, len * sizeof(crgb)) == 0)
+        return false;
+    memcpy(dst, src, len * sizeof(crgb));
+    fb_mark_dirty(fb, y, y);
+    return true;
+}
+
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+// Encodes rows straight into the back DMA buffer and queues it. Only waits for the previous frame,
+// which is already being sent while this one is encoded
+static void output_rows(struct framebuffer *fb, const uint32_t *rows)
+{
+    uint8_t *out = led_spi_back_buffer(fb->output);
+    for (uint16_t y = 0; y < CONFIG_HC_MATRIX_HEIGHT; y++) {
+        if (!(rows[y / 32] & (1UL << (y % 32))))
+            continue;
+        const crgb *row = &fb->src[y * CONFIG_HC_MATRIX_WIDTH];
+        const uint16_t *map = &fb->led_map[y * CONFIG_HC_MATRIX_WIDTH];
+        for (uint16_t x = 0; x < CONFIG_HC_MATRIX_WIDTH; x++) {
+            uint8_t *led = out + map[x] * LED_SPI_BYTES_PER_LED;
+            memcpy(led + SPI_OFFSET_R, fb->spi_lut[0][row[x].r], LED_SPI_BYTES_PER_COLOR);
+            memcpy(led + SPI_OFFSET_G, fb->spi_lut[1][row[x].g], LED_SPI_BYTES_PER_COLOR);
+            memcpy(led + SPI_OFFSET_B, fb->spi_lut[2][row[x].b], LED_SPI_BYTES_PER_COLOR);
+        }
+    }
+    led_spi_present(fb->output);
+}
+#elif CONFIG_HC_FB_OUTPUT_HOST_SINK
+// Sink keeps the previous frame like the strip driver, but in display order so frames are viewable
+static void output_rows(struct framebuffer *fb, const uint32_t *rows)
+{
+    for (uint16_t y = 0; y < CONFIG_HC_MATRIX_HEIGHT; y++) {
+        if (!(rows[y / 32] & (1UL << (y % 32))))
+            continue;
+        const crgb *row = &fb->src[y * CONFIG_HC_MATRIX_WIDTH];
+        for (uint16_t x = 0; x < CONFIG_HC_MATRIX_WIDTH; x++)
+            fb_sink_set_pixel(fb->output, x, y, fb->lut[0][row[x].r], fb->lut[1][row[x].g], fb->lut[2][row[x].b]);
+    }
+    fb_sink_present(fb->output);
+}
+#else
+// The strip driver keeps the previous frame, only dirty rows have to be re-encoded
+static void output_rows(struct framebuffer *fb, const uint32_t *rows)
+{
+    for (uint16_t y = 0; y < CONFIG_HC_MATRIX_HEIGHT; y++) {
+        if (!(rows[y / 32] & (1UL << (y % 32))))
+            continue;
+        const crgb *row = &fb->src[y * CONFIG_HC_MATRIX_WIDTH];
+        const uint16_t *map = &fb->led_map[y * CONFIG_HC_MATRIX_WIDTH];
+        for (uint16_t x = 0; x < CONFIG_HC_MATRIX_WIDTH; x++) {
+            // Apply brightness and gamma
+            crgb pixel = row[x];
+            led_strip_set_pixel(fb->output, map[x],
+                                fb->lut[0][pixel.r], fb->lut[1][pixel.g], fb->lut[2][pixel.b]);
         }
-    led_strip_refresh(fb->led_strip);
+    }
+    led_strip_refresh(fb->output);
+}
+#endif /* CONFIG_HC_FB_OUTPUT_SPI_DIRECT */
+
+// Sends dirty rows to the LEDs, does nothing if the frame is unchanged
+void fb_refresh(struct framebuffer *fb)
+{
+    // Brightness may also be changed by writing the field directly
+    if (fb->brightness != fb->lut_brightness) {
+        build_lut(fb);
+        fb_mark_dirty_all(fb);
+    }
+    if (!fb_is_dirty(fb))
+        return;
+
+    int64_t start = metrics_start();
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+    // Back buffer holds the frame before the previous one, so it misses previous changes too
+    uint32_t rows[FB_DIRTY_WORDS];
+    for (uint8_t i = 0; i < FB_DIRTY_WORDS; i++) {
+        rows[i] = fb->dirty_rows[i] | fb->stale_rows[i];
+        fb->stale_rows[i] = fb->dirty_rows[i];
+    }
+    output_rows(fb, rows);
+#else
+    output_rows(fb, fb->dirty_rows);
+#endif
+    memset(fb->dirty_rows, 0, sizeof(fb->dirty_rows));
+    metrics_stage_end(METRICS_STAGE_REFRESH, start);
 }
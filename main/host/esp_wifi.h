@@ -0,0 +1,9 @@
+// Host build stand-in for the parts of esp_wifi.h used by apps
+#ifndef __HOST_ESP_WIFI_H__
+#define __HOST_ESP_WIFI_H__
+
+#include "esp_err.h"
+
+esp_err_t esp_wifi_sta_get_rssi(int *rssi);
+
+#endif
@@ -8,6 +8,9 @@
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "jsmn.h"
+#include "metrics.h"
+#include "stats.h"
+#include "sdkconfig.h"
 
 static const char *TAG = "http_api";
 static const char status_ok_msg[] = "{\"status\":\"ok\"}";
@@ -103,9 +106,65 @@ static int list_apps_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+#if CONFIG_HC_METRICS || CONFIG_HC_STATS
+// Long responses are generated piece by piece and sent in chunks of up to sizeof(buf)
+struct chunked_resp {
+    httpd_req_t *req;
+    size_t len;
+    char buf[512];
+};
+
+static void chunked_write(void *ctx, const char *text, size_t len)
+{
+    struct chunked_resp *resp = ctx;
+    if (resp->len + len > sizeof(resp->buf)) {
+        httpd_resp_send_chunk(resp->req, resp->buf, resp->len);
+        resp->len = 0;
+    }
+    memcpy(&resp->buf[resp->len], text, MIN(len, sizeof(resp->buf)));
+    resp->len += MIN(len, sizeof(resp->buf));
+}
+
+static int send_chunked(httpd_req_t *req, const char *type, void (*generate)(void (*)(void *, const char *, size_t), void *))
+{
+    struct chunked_resp *resp = malloc(sizeof(*resp));
+    if (resp == NULL)
+        return ESP_FAIL;
+    resp->req = req;
+    resp->len = 0;
+    httpd_resp_set_type(req, type);
+    generate(chunked_write, resp);
+    if (resp->len > 0)
+        httpd_resp_send_chunk(req, resp->buf, resp->len);
+    httpd_resp_send_chunk(req, NULL, 0);
+    free(resp);
+    return ESP_OK;
+}
+#endif
+
+#if CONFIG_HC_METRICS
+static int metrics_handler(httpd_req_t *req)
+{
+    return send_chunked(req, "text/plain; version=0.0.4", metrics_write_prometheus);
+}
+#endif
+
+#if CONFIG_HC_STATS
+static int stats_handler(httpd_req_t *req)
+{
+    return send_chunked(req, json_content_type, stats_write_json);
+}
+#endif
+
 static const httpd_uri_t handlers[] = {
     { .uri = "/controls/switch_app", .method = HTTP_POST, .handler = switch_app_handler },
     { .uri = "/apps", .method = HTTP_GET, .handler = list_apps_handler },
+#if CONFIG_HC_METRICS
+    { .uri = "/metrics", .method = HTTP_GET, .handler = metrics_handler },
+#endif
+#if CONFIG_HC_STATS
+    { .uri = "/stats", .method = HTTP_GET, .handler = stats_handler },
+#endif
     { /* sentinel */ }
 };
 
@@ -113,6 +172,9 @@ int start_http_server()
 {
     httpd_handle_t server;
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+#if CONFIG_IDF_TARGET_LINUX
+    config.server_port = CONFIG_HC_HOST_HTTP_PORT;
+#endif
     int ret = httpd_start(&server, &config);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start HTTP server! %s", esp_err_to_name(ret));
@@ -1,3 +1,5 @@
+#include <stdio.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "esp_log.h"
 #include "image_utils.h"
@@ -10,8 +12,236 @@
 
 static const char *TAG = "image_utils";
 
+#define HCI_MAGIC       "HCI\x01"
+#define HCI_HEADER_SIZE 8
+
+// Collects up to 256 distinct colors and the index of every pixel, returns 0 if there are more.
+// Fully transparent pixels share one entry
+static uint16_t build_palette(const uint8_t *pixels, uint8_t channels, size_t count,
+                              uint8_t *palette, uint8_t *indices)
+{
+    uint16_t colors = 0;
+    uint16_t last = 0;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *px = &pixels[i * channels];
+        uint8_t color[4] = { px[0], px[1], px[2], channels == 4 ? px[3] : 255 };
+        if (color[3] == 0)
+            memset(color, 0, sizeof(color));
+        if (colors == 0 || memcmp(&palette[last * 4], color, 4) != 0) {
+            for (last = 0; last < colors && memcmp(&palette[last * 4], color, 4) != 0; last++);
+            if (last == colors) {
+                if (colors == 256)
+                    return 0;
+                memcpy(&palette[colors * 4], color, 4);
+                colors++;
+            }
+        }
+        indices[i] = last;
+    }
+    return colors;
+}
+
+// Stores image with few colors palette-indexed, returns 1 if it doesn't pay off
+static uint8_t image_from_rgba_indexed(const uint8_t *pixels, uint8_t channels, uint8_t width, uint8_t height,
+                                       struct image_desc *description)
+{
+    size_t count = width * height;
+    uint8_t *palette = pvPortMalloc(256 * 4);
+    uint8_t *indices = pvPortMalloc(count);
+    uint8_t *packed = NULL;
+    uint8_t ret = 1;
+    if (palette == NULL || indices == NULL)
+        goto out;
+
+    uint16_t colors = build_palette(pixels, channels, count, palette, indices);
+    if (colors == 0)
+        goto out;
+    uint8_t bpp = colors <= 2 ? 1 : colors <= 4 ? 2 : colors <= 16 ? 4 : 8;
+    size_t stride = (width * bpp + 7) / 8;
+    if (colors * (sizeof(crgb) + 1) + stride * height >= count * sizeof(crgb))
+        goto out;
+
+    packed = pvPortMalloc(stride * height);
+    if (packed == NULL)
+        goto out;
+    memset(packed, 0, stride * height);
+    for (uint8_t y = 0; y < height; y++)
+        for (uint16_t x = 0, bit = 0; x < width; x++, bit += bpp)
+            packed[y * stride + (bit >> 3)] |= indices[y * width + x] << (8 - bpp - (bit & 7));
+    ret = image_from_indexed(palette, colors, bpp, packed, width, height, description);
+
+out:
+    vPortFree(palette);
+    vPortFree(indices);
+    vPortFree(packed);
+    return ret;
+}
+
+// Converts raw RGB or RGBA pixels into blit-ready form: premultiplies colors,
+// stores inverted alpha and finds transparent edges and opaque rows
+uint8_t image_from_rgba(const uint8_t *pixels, uint8_t channels, uint8_t width, uint8_t height,
+                        struct image_desc *description)
+{
+    if (channels != 3 && channels != 4) {
+        ESP_LOGE(TAG, "[image_from_rgba] Channel count must be 3 (RGB) or 4 (RGBA)");
+        return 1;
+    }
+    // Icons use a handful of colors, a palette takes several times less RAM
+    if (image_from_rgba_indexed(pixels, channels, width, height, description) == 0)
+        return 0;
+
+    size_t count = width * height;
+    crgb *colors = pvPortMalloc(count * sizeof(crgb));
+    uint8_t *inv_alpha = pvPortMalloc(count);
+    struct image_row *rows = pvPortMalloc(height * sizeof(struct image_row));
+    description->width = width;
+    description->height = height;
+    description->bpp = 0;
+    description->colors = 0;
+    description->pixels = colors;
+    description->alpha = inv_alpha;
+    description->indices = NULL;
+    description->rows = rows;
+    if (colors == NULL || inv_alpha == NULL || rows == NULL) {
+        ESP_LOGE(TAG, "[image_from_rgba] Out of memory!");
+        free_image(description);
+        return 1;
+    }
+
+    bool opaque = true;
+    for (uint8_t y = 0; y < height; y++) {
+        struct image_row *row = &rows[y];
+        row->x1 = 1;
+        row->x2 = 0;
+        row->opaque = true;
+        for (uint8_t x = 0; x < width; x++) {
+            size_t i = y * width + x;
+            const uint8_t *px = &pixels[i * channels];
+            uint8_t a = channels == 4 ? px[3] : 255;
+            crgb color = { mul_div255(px[0], a), mul_div255(px[1], a), mul_div255(px[2], a) };
+            colors[i] = color;
+            inv_alpha[i] = 255 - a;
+            if (a == 0)
+                continue;
+            if (row->x1 > row->x2)
+                row->x1 = x;
+            row->x2 = x;
+        }
+        // Transparent pixels inside of the row still need blending
+        for (uint8_t x = row->x1; x <= row->x2 && row->x1 <= row->x2; x++)
+            if (inv_alpha[y * width + x] != 0)
+                row->opaque = false;
+        if (row->x1 != 0 || row->x2 != width - 1 || !row->opaque)
+            opaque = false;
+    }
+    if (opaque) {
+        vPortFree(inv_alpha);
+        description->alpha = NULL;
+    }
+    return 0;
+}
+
+// Makes image from RGBA palette (alpha not premultiplied) and packed rows of indices,
+// both are copied
+uint8_t image_from_indexed(const uint8_t *palette, uint16_t colors, uint8_t bpp, const uint8_t *indices,
+                           uint8_t width, uint8_t height, struct image_desc *description)
+{
+    if ((bpp != 1 && bpp != 2 && bpp != 4 && bpp != 8) || colors == 0 || colors > (1 << bpp)) {
+        ESP_LOGE(TAG, "[image_from_indexed] Invalid palette: %d colors, %d bits per pixel", colors, bpp);
+        return 1;
+    }
+    size_t stride = (width * bpp + 7) / 8;
+    crgb *pal_colors = pvPortMalloc(colors * sizeof(crgb));
+    uint8_t *inv_alpha = pvPortMalloc(colors);
+    uint8_t *idx_copy = pvPortMalloc(stride * height);
+    struct image_row *rows = pvPortMalloc(height * sizeof(struct image_row));
+    description->width = width;
+    description->height = height;
+    description->bpp = bpp;
+    description->colors = colors;
+    description->pixels = pal_colors;
+    description->alpha = inv_alpha;
+    description->indices = idx_copy;
+    description->rows = rows;
+    if (pal_colors == NULL || inv_alpha == NULL || idx_copy == NULL || rows == NULL) {
+        ESP_LOGE(TAG, "[image_from_indexed] Out of memory!");
+        free_image(description);
+        return 1;
+    }
+
+    for (uint16_t i = 0; i < colors; i++) {
+        const uint8_t *px = &palette[i * 4];
+        crgb color = { mul_div255(px[0], px[3]), mul_div255(px[1], px[3]), mul_div255(px[2], px[3]) };
+        pal_colors[i] = color;
+        inv_alpha[i] = 255 - px[3];
+    }
+    memcpy(idx_copy, indices, stride * height);
+
+    bool opaque = true;
+    for (uint8_t y = 0; y < height; y++) {
+        struct image_row *row = &rows[y];
+        const uint8_t *idx_row = &idx_copy[y * stride];
+        row->x1 = 1;
+        row->x2 = 0;
+        row->opaque = true;
+        for (uint8_t x = 0; x < width; x++) {
+            uint8_t idx = image_index(idx_row, bpp, x);
+            if (idx >= colors) {
+                ESP_LOGE(TAG, "[image_from_indexed] Index %d is out of palette", idx);
+                free_image(description);
+                return 1;
+            }
+            if (inv_alpha[idx] == 255)
+                continue;
+            if (row->x1 > row->x2)
+                row->x1 = x;
+            row->x2 = x;
+        }
+        for (uint8_t x = row->x1; x <= row->x2 && row->x1 <= row->x2; x++)
+            if (inv_alpha[image_index(idx_row, bpp, x)] != 0)
+                row->opaque = false;
+        if (row->x1 != 0 || row->x2 != width - 1 || !row->opaque)
+            opaque = false;
+    }
+    if (opaque) {
+        vPortFree(inv_alpha);
+        description->alpha = NULL;
+    }
+    return 0;
+}
+
+// Reads palette-indexed .hci image made by tools/mkindexed.py
+static uint8_t load_hci_file(const char *filename, struct image_desc *description)
+{
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "[load_image_file] Failed to load %s!", filename);
+        return 1;
+    }
+    uint8_t header[HCI_HEADER_SIZE];
+    uint8_t *data = NULL;
+    uint8_t ret = 1;
+    if (fread(header, 1, sizeof(header), f) != sizeof(header) || memcmp(header, HCI_MAGIC, 4) != 0)
+        goto out;
+
+    uint8_t width = header[4], height = header[5], bpp = header[6];
+    uint16_t colors = header[7] + 1;
+    size_t size = colors * 4 + (width * bpp + 7) / 8 * height;
+    data = pvPortMalloc(size);
+    if (data == NULL || fread(data, 1, size, f) != size)
+        goto out;
+    ret = image_from_indexed(data, colors, bpp, data + colors * 4, width, height, description);
+
+out:
+    if (ret)
+        ESP_LOGE(TAG, "[load_image_file] %s is not a valid .hci image!", filename);
+    vPortFree(data);
+    fclose(f);
+    return ret;
+}
+
 // Tries to read and decode image from file
-// Only .qoi format is supported for now
+// Supports .qoi and palette-indexed .hci
 uint8_t load_image_file(const char *filename, struct image_desc *description)
 {
     char f_ext[4];
@@ -23,13 +253,31 @@ uint8_t load_image_file(const char *filename, struct image_desc *description)
             ESP_LOGE(TAG, "[load_image_file] Failed to load %s!", filename);
             return 1;
         }
-        description->width = qoi_desc.width;
-        description->height = qoi_desc.height;
-        description->channels = qoi_desc.channels;
-        description->pixels = rgba_pixels;
-        return 0;
+        if (qoi_desc.width > UINT8_MAX || qoi_desc.height > UINT8_MAX) {
+            ESP_LOGE(TAG, "[load_image_file] %s is too large!", filename);
+            vPortFree(rgba_pixels);
+            return 1;
+        }
+        uint8_t ret = image_from_rgba(rgba_pixels, 4, qoi_desc.width, qoi_desc.height, description);
+        vPortFree(rgba_pixels);
+        return ret;
+    } else if (strcmp(f_ext, "hci") == 0) {
+        return load_hci_file(filename, description);
     } else {
         ESP_LOGE(TAG, "[load_image_file] Image format .%s is not supported!", f_ext);
     }
     return 1;
 }
+
+// Frees arrays allocated by image_from_rgba(), not for images from the asset pack
+void free_image(struct image_desc *description)
+{
+    vPortFree((void *)description->pixels);
+    vPortFree((void *)description->alpha);
+    vPortFree((void *)description->indices);
+    vPortFree((void *)description->rows);
+    description->pixels = NULL;
+    description->alpha = NULL;
+    description->indices = NULL;
+    description->rows = NULL;
+}
@@ -0,0 +1,43 @@
+#ifndef __ANIM_IMAGE_H__
+#define __ANIM_IMAGE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "framebuffer.h"
+
+// Animated image made by tools/mkanim.py. Frames are palette-indexed, the first one is a
+// keyframe and the rest are either keyframes or deltas with changed spans only
+struct anim_image {
+    uint8_t width;
+    uint8_t height;
+    uint8_t bpp;                // Bits per palette index
+    uint16_t colors;
+    uint16_t frame_count;
+    const crgb *palette;        // Premultiplied by alpha
+    const uint8_t *alpha;       // 255 - alpha for every palette entry, NULL if opaque
+    const uint8_t *frames;      // Encoded frames, may point into mapped flash
+    size_t frames_size;
+    void *data;                 // Owned file contents, NULL if frames aren't owned
+};
+
+// Decoding state: one frame of palette indices and position of the next frame
+struct anim_image_decoder {
+    const struct anim_image *img;
+    uint8_t *frame;
+    uint16_t index;
+    uint16_t delay_ms;
+    size_t pos;
+};
+
+uint8_t anim_image_open(const uint8_t *data, size_t size, struct anim_image *img);
+uint8_t anim_image_load_file(const char *filename, struct anim_image *img);
+void anim_image_free(struct anim_image *img);
+
+uint8_t anim_image_decoder_init(struct anim_image_decoder *dec, const struct anim_image *img);
+uint8_t anim_image_next_frame(struct anim_image_decoder *dec);
+void anim_image_decoder_free(struct anim_image_decoder *dec);
+void anim_image_draw(const struct anim_image_decoder *dec, crgb *out, uint8_t out_width, uint8_t out_height,
+                     int16_t x, int16_t y);
+
+#endif
@@ -1,10 +1,41 @@
 #ifndef __ANIMATIONS_H__
 #define __ANIMATIONS_H__
 
+#include <stdbool.h>
 #include <stdint.h>
+#include "anim_image.h"
 #include "canvas.h"
 
-void anim_fade_out(struct canvas *cv, uint32_t duration_ms, uint32_t delay_ms);
-void anim_fade_in(struct canvas *cv, struct canvas *cv_new, uint32_t duration_ms, uint32_t delay_ms);
+// Handle of a running animation, negative if it couldn't be started
+typedef int16_t anim_t;
+
+enum anim_ease {
+    ANIM_EASE_LINEAR = 0,
+    ANIM_EASE_IN,
+    ANIM_EASE_OUT,
+    ANIM_EASE_IN_OUT
+};
+
+// Plays back and forth until cancelled, images start over instead
+#define ANIM_LOOP   (1 << 0)
+
+void anim_init(void);
+
+anim_t anim_crossfade(struct canvas *cv, uint32_t duration_ms, enum anim_ease ease);
+anim_t anim_fade(struct canvas *cv, uint8_t from, uint8_t to, uint32_t duration_ms, enum anim_ease ease, uint8_t flags);
+anim_t anim_move(struct canvas *cv, int8_t dx_from, int8_t dy_from, int8_t dx_to, int8_t dy_to,
+                 uint32_t duration_ms, enum anim_ease ease);
+anim_t anim_color(struct canvas *cv, crgb from, crgb to, uint32_t duration_ms, enum anim_ease ease);
+anim_t anim_play(struct canvas *cv, const struct anim_image *img, int16_t x, int16_t y, uint8_t flags);
+
+bool anim_fade_to(anim_t anim, uint8_t to, uint32_t duration_ms);
+bool anim_move_to(anim_t anim, int8_t dx, int8_t dy, uint32_t duration_ms);
+bool anim_color_to(anim_t anim, crgb to, uint32_t duration_ms);
+void anim_cancel(anim_t anim);
+void anim_cancel_all(struct canvas *cv);
+
+bool anim_is_active(struct canvas *cv);
+bool anim_is_running(struct canvas *cv);
+void anim_apply(struct canvas *cv, const crgb *pixels, crgb *out);
 
 #endif
@@ -2,21 +2,50 @@
 #define __APP_MANAGER_H__
 
 #include "freertos/FreeRTOS.h"
+#include "canvas.h"
+#include "event_queue.h"
 
 // Message bits
 #define AM_MSG_REFRESH  0x1
 #define AM_MSG_PREVAPP  0x2
 #define AM_MSG_NEXTAPP  0x4
 
-// Input events
-#define EVENT_BTN_CLICK     0x1
-#define EVENT_KNOB_RIGHT    0x2
-#define EVENT_KNOB_LEFT     0x4
+// tick_ms of apps changing only on events or on their own schedule, see am_tick_at()
+#define AM_TICK_ON_CHANGE   0
 
+// Cooperative app, run by the single app loop of app manager instead of its own task.
+// Callbacks must not block, any of them may be NULL. on_event() and on_tick() return
+// true when the canvas has to be redrawn, on_draw() is called then and the frame is presented.
+// The loop sleeps until the nearest tick of all apps, so slow rates let the CPU sleep
+struct am_app_ops
+{
+    uint8_t (*init)(struct canvas *cv, void **state);   // Returns 0 on success
+    bool (*on_event)(void *state, struct canvas *cv, const struct app_event *event);
+    bool (*on_tick)(void *state, struct canvas *cv);
+    void (*on_draw)(void *state, struct canvas *cv);
+    void (*on_suspend)(void *state);                    // Window is hidden, ticks stop until it's shown again
+    // Frees state after keeping what's needed to start again (in static variables), the canvas is
+    // freed too. init() is called again when the window is shown. Apps without it never hibernate
+    void (*on_hibernate)(void *state);
+    uint32_t tick_ms;           // Period of on_tick() while shown (the frame rate), or AM_TICK_ON_CHANGE
+    // Period once there was no input and no animation for CONFIG_HC_AM_IDLE_TIME, 0 - same as tick_ms
+    uint32_t idle_tick_ms;
+};
+
+enum am_app_state {
+    AM_APP_STOPPED = 0,
+    AM_APP_HIBERNATED,
+    AM_APP_SUSPENDED,
+    AM_APP_RUNNING
+};
+
+// Either ui_task or ops is set
 struct am_app_info
 {
     const char *name;
     TaskFunction_t ui_task;
+    const struct am_app_ops *ops;
+    bool hibernate;     // Task-based app handles EVENT_HIBERNATE
 };
 
 struct am_params
@@ -29,6 +58,13 @@ struct am_params
 void launch_am_task(struct am_params *params);
 void am_send_msg(uint32_t message);
 void am_send_msg_from_isr(uint32_t message, BaseType_t *higher_task_wakeup);
-void am_send_input_event(uint32_t event);
+void am_send_input_event(enum app_event_type type, int32_t value, int64_t time_us);
+bool am_post_event(int8_t app, int32_t message);
+bool am_event_wait(struct app_event *event, TickType_t timeout);
+int8_t am_get_app_id(void);
+void am_tick_at(int64_t time_us);
+void am_get_app_activity(uint8_t idx, uint32_t *wakeups, uint64_t *busy_us);
+void am_app_hibernated(void);
+enum am_app_state am_get_app_state(uint8_t idx);
 struct am_app_info *get_apps_list();
 #endif
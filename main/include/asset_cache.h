@@ -0,0 +1,38 @@
+#ifndef __ASSET_CACHE_H__
+#define __ASSET_CACHE_H__
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "image_utils.h"
+
+enum asset_state {
+    ASSET_LOADING = 0,
+    ASSET_READY,
+    ASSET_FAILED
+};
+
+struct asset;
+
+struct asset_cache_stats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t failures;
+    uint16_t count;         // Images in cache, referenced or not
+    size_t used;            // Bytes of RAM taken by images loaded from files
+    size_t budget;
+};
+
+void asset_cache_init(void);
+
+struct asset *asset_acquire(const char *name);
+struct asset *asset_acquire_async(const char *name, int8_t app, int32_t message);
+void asset_release(struct asset *asset);
+
+enum asset_state asset_get_state(const struct asset *asset);
+const struct image_desc *asset_image(const struct asset *asset);
+
+void asset_cache_get_stats(struct asset_cache_stats *stats);
+
+#endif
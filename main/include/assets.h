@@ -0,0 +1,17 @@
+#ifndef __ASSETS_H__
+#define __ASSETS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "anim_image.h"
+#include "image_utils.h"
+
+esp_err_t assets_init(void);
+esp_err_t assets_open(const void *pack, size_t size);
+uint8_t assets_get_image(const char *name, struct image_desc *description);
+uint8_t assets_load_image(const char *name, struct image_desc *description);
+uint8_t assets_get_data(const char *name, const void **data, size_t *size);
+uint8_t assets_load_anim(const char *name, struct anim_image *img);
+
+#endif
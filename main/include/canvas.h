@@ -2,29 +2,56 @@
 #define __CANVAS_H__
 
 #include "framebuffer.h"
+#include <stdbool.h>
 #include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "fonts.h"
 #include "image_utils.h"
 
+// Inclusive rectangle, empty when x1 > x2
+struct cv_rect {
+    uint8_t x1;
+    uint8_t y1;
+    uint8_t x2;
+    uint8_t y2;
+};
+
 struct canvas {
     uint8_t width;
     uint8_t height;
     crgb *buf;
+    struct cv_rect dirty;  // Area changed since the last cv_clear_dirty()
+    // Double-buffered canvases only: the last presented frame, read by the output stage directly
+    crgb *front;
+    struct cv_rect front_dirty;  // Area of front changed since the output stage read it
+    SemaphoreHandle_t front_mutex;
+    int64_t draw_start_us;  // When the dirty area became non-empty, for metrics
 };
 
 struct canvas *cv_init(uint8_t width, uint8_t height);
 struct canvas *cv_copy(struct canvas *old_cv);
 void cv_free(struct canvas *cv);
+void cv_enable_double_buffer(struct canvas *cv);
+void cv_present(struct canvas *cv);
+const crgb *cv_lock_front(struct canvas *cv, struct cv_rect *changed);
+void cv_unlock_front(struct canvas *cv);
 void cv_blank(struct canvas *cv);
 void cv_fill(struct canvas *cv, crgb color);
+void cv_mark_dirty(struct canvas *cv, uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2);
+void cv_mark_dirty_all(struct canvas *cv);
+void cv_clear_dirty(struct canvas *cv);
+bool cv_is_dirty(struct canvas *cv);
 crgb cv_get_pixel(struct canvas *cv, uint8_t x, uint8_t y);
 void cv_set_pixel(struct canvas *cv, uint8_t x, uint8_t y, crgb color);
 void cv_draw_line_v(struct canvas *cv, uint8_t x, uint8_t y1, uint8_t y2, crgb color);
 void cv_draw_line_h(struct canvas *cv, uint8_t x1, uint8_t x2, uint8_t y, crgb color);
 void cv_draw_rect(struct canvas *cv, uint8_t x1, uint8_t x2, uint8_t y1, uint8_t y2, crgb color);
 void cv_draw_symbol(struct canvas *cv, const struct bitmap_font *font, uint8_t sym_idx, uint8_t x, uint8_t y, crgb color);
-void cv_draw_image(struct canvas *cv, struct image_desc *img, uint8_t x, uint8_t y);
+void cv_draw_image(struct canvas *cv, const struct image_desc *img, int16_t x, int16_t y);
 void cv_draw_cv(struct canvas *cv, struct canvas *cv_child, uint8_t x, uint8_t y);
+void cv_copy_to_fb(struct canvas *cv, struct framebuffer *fb, uint8_t x, uint8_t y);
 void cv_draw_to_fb(struct canvas *cv, struct framebuffer *fb, uint8_t x, uint8_t y);
+void cv_draw_slide_to_fb(struct framebuffer *fb, struct canvas *cv_l, struct canvas *cv_r, uint8_t off);
 
 #endif
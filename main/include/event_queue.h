@@ -0,0 +1,40 @@
+#ifndef __EVENT_QUEUE_H__
+#define __EVENT_QUEUE_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+enum app_event_type {
+    EVENT_CLICK = 0,
+    EVENT_LONG_PRESS,
+    EVENT_KNOB,         // value: steps turned since the previous knob event, positive clockwise
+    EVENT_APP,          // value: message defined by the app, see am_post_event()
+    EVENT_HIBERNATE     // Task-based apps of APP_INFO_HIBERNATE: release resources, call am_app_hibernated()
+};
+
+struct app_event {
+    uint8_t type;
+    uint16_t count;     // Input events merged into this one, 1 if none
+    int32_t value;
+    int64_t time_us;    // esp_timer time of the first merged event
+};
+
+// Ring of events for one consumer, which takes them without locking. Producers are
+// serialized by a spinlock. Knob turns are merged while their event waits in the queue
+struct event_queue {
+    struct app_event events[CONFIG_HC_AM_EVENT_QUEUE_LEN];
+    atomic_uint head;       // Next slot to write, changed by producers only
+    atomic_uint tail;       // Next slot to read, changed by the consumer only
+    atomic_uint knob;       // Turns not taken yet: steps in high 16 bits, count in low ones
+    uint32_t dropped;       // Events not pushed because the queue was full
+    portMUX_TYPE lock;
+};
+
+void evq_init(struct event_queue *q);
+bool evq_push(struct event_queue *q, const struct app_event *event);
+bool evq_pop(struct event_queue *q, struct app_event *event);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __FB_SINK_H__
+#define __FB_SINK_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define FB_SINK_SHM_MAGIC   0x42464348  // "HCFB"
+
+// Header of the shared memory frame buffer, RGB pixels follow it
+struct fb_sink_shm {
+    uint32_t magic;
+    uint16_t width;
+    uint16_t height;
+    uint32_t seq;           // Odd while the frame is being written
+    uint32_t reserved;
+};
+
+// Host build output: takes the frame instead of LEDs and writes it to files and/or shared memory
+struct fb_sink {
+    uint16_t width;
+    uint16_t height;
+    uint8_t *pixels;        // RGB, row by row
+    uint32_t frame;         // Number of presented frames
+    struct fb_sink_shm *shm;
+};
+
+esp_err_t fb_sink_new(uint16_t width, uint16_t height, struct fb_sink **ret_sink);
+static inline void fb_sink_set_pixel(struct fb_sink *sink, uint16_t x, uint16_t y, uint8_t r, uint8_t g, uint8_t b)
+{
+    uint8_t *px = &sink->pixels[(y * sink->width + x) * 3];
+    px[0] = r;
+    px[1] = g;
+    px[2] = b;
+}
+esp_err_t fb_sink_present(struct fb_sink *sink);
+
+#endif
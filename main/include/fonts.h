@@ -12,4 +12,35 @@ struct bitmap_font
 
 extern const struct bitmap_font digits_3x5_font;
 extern const struct bitmap_font digits_7x7_font;
+
+// Proportional font, every glyph is stored column by column, one byte per column, MSB is the top row
+struct text_glyph
+{
+    uint16_t offset;    // First column in data
+    uint8_t width;
+};
+
+// Consecutive code points starting from first are mapped to consecutive glyphs
+struct text_font_range
+{
+    uint16_t first;
+    uint16_t count;
+    uint16_t glyph;
+};
+
+struct text_font
+{
+    uint8_t height;
+    uint8_t spacing;    // Empty columns between glyphs
+    uint16_t fallback;  // Glyph for code points missing in the font
+    uint8_t range_count;
+    const struct text_font_range *ranges;
+    const struct text_glyph *glyphs;
+    const uint8_t *data;
+};
+
+// ASCII, Latin-1 and Cyrillic, 8 rows including accents and descenders
+extern const struct text_font text_font;
+
+const struct text_glyph *font_find_glyph(const struct text_font *font, uint32_t code);
 #endif
@@ -1,9 +1,22 @@
 #ifndef __FRAMEBUFFER_H__
 #define __FRAMEBUFFER_H__
 
+#include <stdbool.h>
 #include <stdint.h>
-#include "led_strip_types.h"
 #include "sdkconfig.h"
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+#include "led_spi.h"
+typedef struct led_spi *fb_output_t;
+#elif CONFIG_HC_FB_OUTPUT_HOST_SINK
+#include "fb_sink.h"
+typedef struct fb_sink *fb_output_t;
+#else
+#include "led_strip_types.h"
+typedef led_strip_handle_t fb_output_t;
+#endif
+
+// One bit per matrix row
+#define FB_DIRTY_WORDS  ((CONFIG_HC_MATRIX_HEIGHT + 31) / 32)
 
 typedef struct crgb
 {
@@ -15,15 +28,36 @@ typedef struct crgb
 struct framebuffer
 {
     crgb buf[CONFIG_HC_MATRIX_HEIGHT][CONFIG_HC_MATRIX_WIDTH];
-    led_strip_handle_t led_strip;
+    const crgb *src;  // Pixels sent by fb_refresh(): buf or an external WIDTH x HEIGHT buffer
+    uint32_t dirty_rows[FB_DIRTY_WORDS];
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+    // Rows the back DMA buffer lacks, i.e. rows changed in the frame sent from the other buffer
+    uint32_t stale_rows[FB_DIRTY_WORDS];
+#endif
+    // LED index for every pixel, built once from the matrix geometry
+    uint16_t led_map[CONFIG_HC_MATRIX_HEIGHT * CONFIG_HC_MATRIX_WIDTH];
+    fb_output_t output;
     uint8_t brightness;
+    // Output table: brightness, gamma and white balance for every channel value
+    uint8_t lut[3][256];
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+    // Same table, already encoded into SPI bit patterns
+    uint8_t spi_lut[3][256][LED_SPI_BYTES_PER_COLOR];
+#endif
+    uint8_t lut_brightness;  // Brightness the LUT was built for
 };
 
-struct framebuffer *fb_init(led_strip_handle_t led_strip, uint8_t brightness);
+struct framebuffer *fb_init(fb_output_t output, uint8_t brightness);
+void fb_set_brightness(struct framebuffer *fb, uint8_t brightness);
 void fb_blank(struct framebuffer *fb);
 void fb_fill(struct framebuffer *fb, crgb color);
+bool fb_set_source(struct framebuffer *fb, const crgb *src);
+void fb_mark_dirty(struct framebuffer *fb, uint8_t y1, uint8_t y2);
+void fb_mark_dirty_all(struct framebuffer *fb);
+bool fb_is_dirty(struct framebuffer *fb);
+bool fb_update_row(struct framebuffer *fb, uint8_t x, uint8_t y, const crgb *src, uint8_t len);
 void fb_refresh(struct framebuffer *fb);
 
 crgb crgb_mult(crgb a, float mult);
 
-#endif
\ No newline at end of file
+#endif
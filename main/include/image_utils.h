@@ -1,15 +1,54 @@
 #ifndef __IMG_UTILS_H__
 #define __IMG_UTILS_H__
 
+#include <stdbool.h>
 #include <stdint.h>
+#include "framebuffer.h"
 
+// Pixels of the row outside of x1..x2 are fully transparent
+struct image_row {
+    uint8_t x1;
+    uint8_t x2;     // x1 > x2 for fully transparent rows
+    bool opaque;    // No translucent pixels between x1 and x2
+};
+
+// Blit-ready image, colors are premultiplied by alpha. Arrays may point into mapped flash.
+// Palette-indexed images keep their palette in pixels and alpha
 struct image_desc {
     uint8_t width;
     uint8_t height;
-    uint8_t channels;
-    uint8_t *pixels;
+    uint8_t bpp;                // Bits per palette index (1, 2, 4 or 8), 0 for direct color
+    uint16_t colors;            // Palette size
+    const crgb *pixels;
+    const uint8_t *alpha;       // 255 - alpha for every pixel (or palette entry), NULL if the image is opaque
+    const uint8_t *indices;     // Rows of palette indices, byte-aligned, first pixel in high bits
+    const struct image_row *rows;
 };
 
+uint8_t image_from_rgba(const uint8_t *pixels, uint8_t channels, uint8_t width, uint8_t height,
+                        struct image_desc *description);
+uint8_t image_from_indexed(const uint8_t *palette, uint16_t colors, uint8_t bpp, const uint8_t *indices,
+                           uint8_t width, uint8_t height, struct image_desc *description);
 uint8_t load_image_file(const char *filename, struct image_desc *description);
+void free_image(struct image_desc *description);
+
+static inline size_t image_stride(const struct image_desc *img)
+{
+    return (img->width * img->bpp + 7) / 8;
+}
+
+// Palette index of pixel x in a row of indexed image
+static inline uint8_t image_index(const uint8_t *row, uint8_t bpp, uint8_t x)
+{
+    uint16_t bit = x * bpp;
+    return (row[bit >> 3] >> (8 - bpp - (bit & 7))) & ((1 << bpp) - 1);
+}
+
+// x * y / 255, rounded
+static inline uint8_t mul_div255(uint8_t x, uint8_t y)
+{
+    uint16_t v = x * y + 128;
+    return (v + (v >> 8)) >> 8;
+}
 
 #endif
@@ -0,0 +1,33 @@
+#ifndef __LED_SPI_H__
+#define __LED_SPI_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/spi_master.h"
+
+// Every data bit is sent as 3 SPI bits (100 / 110), so one color byte takes 3 bytes
+#define LED_SPI_BYTES_PER_COLOR     3
+#define LED_SPI_BYTES_PER_LED       (LED_SPI_BYTES_PER_COLOR * 3)
+
+// Direct SPI output for WS2812-like LEDs with two DMA buffers:
+// the next frame is encoded into the back buffer while the front one is clocked out
+struct led_spi {
+    spi_host_device_t host;
+    spi_device_handle_t device;
+    uint8_t *bufs[2];
+    spi_transaction_t trans[2];
+    size_t data_size;   // Encoded pixels
+    size_t buf_size;    // Encoded pixels + reset pulse
+    uint8_t back;       // Index of buffer which can be written
+    bool in_flight;     // Front buffer is being transferred
+};
+
+esp_err_t led_spi_new(int gpio_num, uint16_t led_count, spi_host_device_t host, struct led_spi **ret_spi);
+uint8_t *led_spi_back_buffer(struct led_spi *spi);
+esp_err_t led_spi_present(struct led_spi *spi);
+void led_spi_wait_done(struct led_spi *spi);
+void led_spi_encode_byte(uint8_t value, uint8_t *dst);
+
+#endif
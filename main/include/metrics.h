@@ -0,0 +1,81 @@
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+// Timed stages of the render task
+enum metrics_stage {
+    METRICS_STAGE_FRAME,            // Whole frame: composition and output
+    METRICS_STAGE_ANIM,             // Animations of the current window
+    METRICS_STAGE_COMPOSE,          // Overlays or slide frame composition
+    METRICS_STAGE_REFRESH,          // fb_refresh() of dirty rows
+    METRICS_STAGE_SLIDE_INTERVAL,   // Time between two presented slide frames
+    METRICS_STAGE_SWITCH,           // Switch request to the first frame showing the new app drawn
+    METRICS_STAGE_COUNT
+};
+
+// Stages of input latency, from the button interrupt to the frame showing the result
+enum metrics_input_stage {
+    METRICS_INPUT_QUEUE,        // Interrupt to the input task
+    METRICS_INPUT_RECOGNIZE,    // Interrupt of the last edge of a gesture to its event
+    METRICS_INPUT_APP,          // Event to the first frame request of its receiver
+    METRICS_INPUT_RENDER,       // Frame request to the presented frame
+    METRICS_INPUT_TOTAL,        // Interrupt to the presented frame
+    METRICS_INPUT_STAGE_COUNT
+};
+
+enum metrics_counter {
+    METRICS_RENDER_REQUESTS,
+    METRICS_RENDER_COALESCED,       // Requests merged into a frame of another request
+    METRICS_RENDER_DELAYED,         // Frames held back by the frame rate limit
+    METRICS_RENDER_SCHEDULED,       // Frames of render_request_at() without requests
+    METRICS_RENDER_FRAMES,
+    METRICS_SLIDE_FRAMES,
+    METRICS_SLIDE_OVERRUNS,         // Slide frames late by more than a tick
+    METRICS_SWITCH_TIMEOUTS,        // Slides started before the new app presented a frame
+    METRICS_INPUT_EVENTS,
+    METRICS_INPUT_TRACED,           // Events traced up to the frame
+    METRICS_INPUT_LOST,             // Events without a frame request in time or replaced by a newer one
+    METRICS_EVENTS_MERGED,          // Knob turns merged into an event waiting in app queue
+    METRICS_EVENTS_DROPPED,         // Events not delivered because app queue was full
+    METRICS_COUNTER_COUNT
+};
+
+// Receives pieces of the Prometheus text, see metrics_write_prometheus()
+typedef void (*metrics_write_t)(void *ctx, const char *text, size_t len);
+
+#if CONFIG_HC_METRICS
+static inline int64_t metrics_start(void)
+{
+    return esp_timer_get_time();
+}
+
+void metrics_stage_end(enum metrics_stage stage, int64_t start_us);
+void metrics_stage_add(enum metrics_stage stage, int64_t us);
+void metrics_app_draw(uint8_t app, int64_t start_us);
+void metrics_add(enum metrics_counter counter, uint32_t n);
+void metrics_input_stage_add(enum metrics_input_stage stage, int64_t us);
+void metrics_input_event(int64_t irq_us);
+void metrics_input_dispatch(TaskHandle_t receiver);
+void metrics_input_request(void);
+void metrics_input_presented(int64_t frame_start_us, uint32_t frame);
+void metrics_write_prometheus(metrics_write_t write, void *ctx);
+#else
+// Compiled out, calls cost nothing
+static inline int64_t metrics_start(void) { return 0; }
+static inline void metrics_stage_end(enum metrics_stage stage, int64_t start_us) {}
+static inline void metrics_stage_add(enum metrics_stage stage, int64_t us) {}
+static inline void metrics_app_draw(uint8_t app, int64_t start_us) {}
+static inline void metrics_add(enum metrics_counter counter, uint32_t n) {}
+static inline void metrics_input_stage_add(enum metrics_input_stage stage, int64_t us) {}
+static inline void metrics_input_event(int64_t irq_us) {}
+static inline void metrics_input_dispatch(TaskHandle_t receiver) {}
+static inline void metrics_input_request(void) {}
+static inline void metrics_input_presented(int64_t frame_start_us, uint32_t frame) {}
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef __OVERLAY_H__
+#define __OVERLAY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "canvas.h"
+#include "framebuffer.h"
+
+// Layer drawn on top of the current window, e.g. a notification or a volume bar.
+// Overlays are composited in creation order during the frame composition
+struct overlay
+{
+    struct canvas *canvas;
+    uint8_t x;
+    uint8_t y;
+    uint8_t opacity;        // 0 - transparent, 255 - opaque
+    bool visible;
+    bool use_key;           // Pixels of key color are not drawn
+    crgb key;
+    // Internal state
+    bool used;
+    bool destroyed;
+    bool changed;
+    struct cv_rect shown;   // Area covered at the last composition
+};
+
+void overlay_init(void);
+struct overlay *overlay_create(uint8_t width, uint8_t height, uint8_t x, uint8_t y);
+void overlay_destroy(struct overlay *ov);
+void overlay_lock(void);
+void overlay_unlock(void);
+void overlay_set_visible(struct overlay *ov, bool visible);
+void overlay_set_position(struct overlay *ov, uint8_t x, uint8_t y);
+void overlay_set_opacity(struct overlay *ov, uint8_t opacity);
+void overlay_set_key(struct overlay *ov, bool use_key, crgb key);
+
+bool overlay_compose(struct framebuffer *fb, struct canvas *base, bool full);
+void overlay_blend_fb(struct framebuffer *fb);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef __QOI_STREAM_H__
+#define __QOI_STREAM_H__
+
+#include <stdint.h>
+#include "canvas.h"
+
+uint8_t qoi_stream_draw(struct canvas *cv, const char *filename, int16_t x, int16_t y);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef __RENDER_H__
+#define __RENDER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "framebuffer.h"
+
+struct render_frame_info
+{
+    uint32_t frame;         // Number of the last presented frame
+    int64_t timestamp_us;   // esp_timer time when it was presented
+};
+
+// Called from the render task to compose a frame and send it with fb_refresh()
+typedef void (*render_present_t)(struct framebuffer *fb);
+
+void render_start(struct framebuffer *fb, render_present_t present);
+void render_request(void);
+void render_request_at(int64_t time_us);
+void render_request_from_isr(BaseType_t *higher_task_wakeup);
+bool render_wait_vsync(TickType_t timeout);
+void render_get_frame_info(struct render_frame_info *info);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stddef.h>
+#include "sdkconfig.h"
+
+// Receives pieces of the JSON text, see stats_write_json()
+typedef void (*stats_write_t)(void *ctx, const char *text, size_t len);
+
+#if CONFIG_HC_STATS
+void stats_start(void);
+void stats_write_json(stats_write_t write, void *ctx);
+#else
+static inline void stats_start(void) {}
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef __TEXT_H__
+#define __TEXT_H__
+
+#include <stdint.h>
+#include "canvas.h"
+#include "fonts.h"
+
+// Text scrolled right to left within an area of canvas. Every step shifts the area
+// by one column and draws only the column that enters at the right edge
+struct marquee
+{
+    struct canvas *cv;
+    const struct text_font *font;
+    uint8_t x;
+    uint8_t y;
+    uint8_t width;
+    crgb color;
+    crgb bg;
+    const struct text_glyph **glyphs;   // The string is decoded and glyphs are looked up only once
+    uint16_t glyph_count;
+    uint16_t text_width;
+    uint8_t gap;                        // Empty columns before the text starts over
+    uint16_t glyph_idx;                 // Glyph entering at the right edge
+    uint8_t col;                        // Its column, columns past the glyph width are spacing
+};
+
+uint32_t utf8_next(const char **str);
+uint16_t text_measure(const struct text_font *font, const char *str);
+uint16_t cv_draw_text(struct canvas *cv, const struct text_font *font, const char *str,
+                      int16_t x, int16_t y, crgb color);
+
+uint8_t marquee_init(struct marquee *m, struct canvas *cv, const struct text_font *font, const char *str,
+                     uint8_t x, uint8_t y, uint8_t width, crgb color, crgb bg);
+bool marquee_scrolls(struct marquee *m);
+void marquee_step(struct marquee *m);
+void marquee_free(struct marquee *m);
+
+#endif
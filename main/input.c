@@ -1,7 +1,9 @@
 #include <stdint.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "app_manager.h"
+#include "metrics.h"
 #include "sdkconfig.h"
 
 static const char *TAG = "input";
@@ -9,9 +11,9 @@ static const char *TAG = "input";
 #if CONFIG_HC_INP_TYPE_TOUCH_ARRAY
 #include "freertos/FreeRTOS.h"
 #include "driver/gpio.h"
-#include "esp_timer.h"
 
 #define MIN_SWIPE_DELAY CONFIG_HC_INP_MIN_SWIPE_DELAY * 1000
+#define LONG_PRESS_TIME (CONFIG_HC_INP_LONG_PRESS_TIME_MS * 1000)
 
 #define GPIO_COUNT  3
 static const int8_t button_gpios[] = {
@@ -33,6 +35,7 @@ enum input_states {
 struct gpio_event {
     uint8_t gpio_num;
     uint8_t level;
+    int64_t time_us;    // Sent with input events, and traced by input latency metrics
 };
 
 static QueueHandle_t gpio_events = NULL;
@@ -40,10 +43,18 @@ static QueueHandle_t gpio_events = NULL;
 static void IRAM_ATTR gpio_isr_handler(void* arg)
 {
     uint8_t gpio_num = (uint32_t) arg;
-    struct gpio_event evt = { .gpio_num = gpio_num, .level = gpio_get_level(gpio_num) };
+    struct gpio_event evt = { .gpio_num = gpio_num, .level = gpio_get_level(gpio_num), .time_us = esp_timer_get_time() };
     xQueueSendFromISR(gpio_events, &evt, NULL);
 }
 
+static BaseType_t receive_event(struct gpio_event *evt, TickType_t timeout)
+{
+    if (xQueueReceive(gpio_events, evt, timeout) == pdFALSE)
+        return pdFALSE;
+    metrics_input_stage_add(METRICS_INPUT_QUEUE, metrics_start() - evt->time_us);
+    return pdTRUE;
+}
+
 static void gpio_events_handler_task(void* arg)
 {
     struct gpio_event evt, prev_evt;
@@ -53,7 +64,7 @@ static void gpio_events_handler_task(void* arg)
             case STATE_RELEASED:
                 // Nothing is touched, wait for touch event and go to STATE_PRESSED
                 ESP_LOGD(TAG, "STATE_RELEASED");
-                if (xQueueReceive(gpio_events, &evt, portMAX_DELAY) == pdFALSE)
+                if (receive_event(&evt, portMAX_DELAY) == pdFALSE)
                     continue;
                 if (evt.level == 1)
                     state = STATE_PRESSED;
@@ -64,7 +75,7 @@ static void gpio_events_handler_task(void* arg)
                 ESP_LOGD(TAG, "STATE_PRESSED");
                 prev_evt = evt;
                 uint64_t start_time = esp_timer_get_time();
-                if (xQueueReceive(gpio_events, &evt, portMAX_DELAY) == pdFALSE) {
+                if (receive_event(&evt, portMAX_DELAY) == pdFALSE) {
                     state = STATE_RELEASED;
                     continue;
                 }
@@ -75,7 +86,7 @@ static void gpio_events_handler_task(void* arg)
                         end_time - start_time > MIN_SWIPE_DELAY) {
                         // Same (L or R) button was released, check for a swipe
                         struct gpio_event temp_evt;
-                        if (xQueueReceive(gpio_events, &temp_evt, pdMS_TO_TICKS(CONFIG_HC_INP_GESTURE_TIMEOUT))) {
+                        if (receive_event(&temp_evt, pdMS_TO_TICKS(CONFIG_HC_INP_GESTURE_TIMEOUT))) {
                             if (temp_evt.gpio_num == CONFIG_HC_INP_CENTER_BUTTON_GPIO && temp_evt.level == 1) {
                                 // It's a swipe
                                 state = (evt.gpio_num == CONFIG_HC_INP_RIGHT_BUTTON_GPIO) ? STATE_SWIPE_L : STATE_SWIPE_R;
@@ -83,8 +94,12 @@ static void gpio_events_handler_task(void* arg)
                             }
                         }
                     }
-                    // Emit click event
-                    am_send_input_event(EVENT_BTN_CLICK);
+                    // Emit click event, it's recognized on release or after the gesture timeout.
+                    // Center button held long enough is a long press
+                    bool long_press = evt.gpio_num == CONFIG_HC_INP_CENTER_BUTTON_GPIO &&
+                                      evt.time_us - prev_evt.time_us >= LONG_PRESS_TIME;
+                    metrics_input_event(evt.time_us);
+                    am_send_input_event(long_press ? EVENT_LONG_PRESS : EVENT_CLICK, 0, evt.time_us);
                     state = STATE_RELEASED;
                 } else if (evt.gpio_num != prev_evt.gpio_num && evt.gpio_num == CONFIG_HC_INP_CENTER_BUTTON_GPIO &&
                            evt.level == 1 && end_time - start_time > MIN_SWIPE_DELAY) {
@@ -97,7 +112,7 @@ static void gpio_events_handler_task(void* arg)
             case STATE_SWIPE_R:
                 ESP_LOGD(TAG, "STATE_SWIPE");
                 // Two buttons were already pressed, wait for third press during timeout
-                if (xQueueReceive(gpio_events, &evt, pdMS_TO_TICKS(CONFIG_HC_INP_GESTURE_TIMEOUT)) == pdFALSE) {
+                if (receive_event(&evt, pdMS_TO_TICKS(CONFIG_HC_INP_GESTURE_TIMEOUT)) == pdFALSE) {
                     // Discard event
                     ESP_LOGD(TAG, "Discaring event!");
                     state = STATE_RELEASED;
@@ -107,12 +122,15 @@ static void gpio_events_handler_task(void* arg)
                 if (evt.level == 0)
                     continue;
                 
-                if (state == STATE_SWIPE_L && evt.gpio_num == CONFIG_HC_INP_LEFT_BUTTON_GPIO)
+                if (state == STATE_SWIPE_L && evt.gpio_num == CONFIG_HC_INP_LEFT_BUTTON_GPIO) {
                     // Emit left swipe event
+                    metrics_input_event(evt.time_us);
                     am_send_msg(AM_MSG_NEXTAPP);
-                else if (state == STATE_SWIPE_R && evt.gpio_num == CONFIG_HC_INP_RIGHT_BUTTON_GPIO)
+                } else if (state == STATE_SWIPE_R && evt.gpio_num == CONFIG_HC_INP_RIGHT_BUTTON_GPIO) {
                     // Emit right swipe event
+                    metrics_input_event(evt.time_us);
                     am_send_msg(AM_MSG_PREVAPP);
+                }
 
                 state = STATE_RELEASED;
                 break;
@@ -148,34 +166,198 @@ void init_gpio_buttons(void)
 static void left_button_callback(void *handle, void *data)
 {
     ESP_LOGD(TAG, "Left button clicked");
+    metrics_input_event(metrics_start());
     am_send_msg(AM_MSG_PREVAPP);
 }
 
 static void right_button_callback(void *handle, void *data)
 {
     ESP_LOGD(TAG, "Right button clicked");
+    metrics_input_event(metrics_start());
     am_send_msg(AM_MSG_NEXTAPP);
 }
 
 static void center_button_callback(void *handle, void *data)
 {
     ESP_LOGD(TAG, "Center button clicked");
-    am_send_input_event(EVENT_BTN_CLICK);
+    int64_t now = esp_timer_get_time();
+    metrics_input_event(now);
+    am_send_input_event(EVENT_CLICK, 0, now);
 }
 
-static void init_button(button_config_t btn_cfg, uint8_t gpio_num, button_cb_t callback)
+static void center_long_press_callback(void *handle, void *data)
 {
-    const button_gpio_config_t gpio_cfg = { .gpio_num = gpio_num, .active_level = 0 };
+    ESP_LOGD(TAG, "Center button long pressed");
+    int64_t now = esp_timer_get_time();
+    metrics_input_event(now);
+    am_send_input_event(EVENT_LONG_PRESS, 0, now);
+}
+
+static button_handle_t init_button(button_config_t btn_cfg, uint8_t gpio_num, button_cb_t callback)
+{
+    const button_gpio_config_t gpio_cfg = {
+        .gpio_num = gpio_num,
+        .active_level = 0,
+#if CONFIG_HC_PM_LIGHT_SLEEP
+        // Pressed button wakes the chip from light sleep, the button timer runs only then
+        .enable_power_save = true,
+#endif
+    };
     button_handle_t handle;
     iot_button_new_gpio_device(&btn_cfg, &gpio_cfg, &handle);
     iot_button_register_cb(handle, BUTTON_SINGLE_CLICK, NULL, callback, NULL);
+    return handle;
 }
 
 void init_gpio_buttons(void)
 {
-    const button_config_t btn_cfg = { .short_press_time = CONFIG_HC_INP_CLICK_TIME_MS, .long_press_time = 0 };
+    const button_config_t btn_cfg = {
+        .short_press_time = CONFIG_HC_INP_CLICK_TIME_MS,
+        .long_press_time = CONFIG_HC_INP_LONG_PRESS_TIME_MS
+    };
     init_button(btn_cfg, CONFIG_HC_INP_LEFT_BUTTON_GPIO, left_button_callback);
-    init_button(btn_cfg, CONFIG_HC_INP_CENTER_BUTTON_GPIO, center_button_callback);
+    button_handle_t center = init_button(btn_cfg, CONFIG_HC_INP_CENTER_BUTTON_GPIO, center_button_callback);
+    iot_button_register_cb(center, BUTTON_LONG_PRESS_START, NULL, center_long_press_callback, NULL);
     init_button(btn_cfg, CONFIG_HC_INP_RIGHT_BUTTON_GPIO, right_button_callback);
 }
+
+#elif CONFIG_HC_INP_TYPE_HOST
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "freertos/FreeRTOS.h"
+
+#define INPUT_TASK_STACK_SIZE   (4 * 1024)
+#define INPUT_TASK_PRIORITY     10
+
+// Sockets are polled, blocking calls would stall the simulated scheduler
+#define POLL_DELAY_MS   10
+#define MAX_LINE        64
+
+// Runs one command: left, right, click and long act like the buttons, knob <steps> turns a knob,
+// sleep <ms> pauses a script. Injected events are traced for latency metrics from the moment they are read
+static void run_command(char *line)
+{
+    line[strcspn(line, "\r\n")] = 0;
+    if (line[0] == 0 || line[0] == '#')
+        return;
+    int64_t now = esp_timer_get_time();
+    if (strcmp(line, "left") == 0) {
+        metrics_input_event(now);
+        am_send_msg(AM_MSG_PREVAPP);
+    } else if (strcmp(line, "right") == 0) {
+        metrics_input_event(now);
+        am_send_msg(AM_MSG_NEXTAPP);
+    } else if (strcmp(line, "click") == 0) {
+        metrics_input_event(now);
+        am_send_input_event(EVENT_CLICK, 0, now);
+    } else if (strcmp(line, "long") == 0) {
+        metrics_input_event(now);
+        am_send_input_event(EVENT_LONG_PRESS, 0, now);
+    } else if (strncmp(line, "knob ", 5) == 0) {
+        metrics_input_event(now);
+        am_send_input_event(EVENT_KNOB, atoi(line + 5), now);
+    } else if (strncmp(line, "sleep ", 6) == 0) {
+        vTaskDelay(pdMS_TO_TICKS(atoi(line + 6)));
+    } else {
+        ESP_LOGW(TAG, "Unknown command \"%s\"", line);
+    }
+}
+
+static void run_script(const char *filename)
+{
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to open input script %s", filename);
+        return;
+    }
+    ESP_LOGI(TAG, "Running input script %s", filename);
+    char line[MAX_LINE];
+    while (fgets(line, sizeof(line), f) != NULL)
+        run_command(line);
+    fclose(f);
+}
+
+static int listen_loopback(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+// Reads commands from a connection until it's closed, a command may span several reads
+static void serve_client(int fd)
+{
+    char line[MAX_LINE];
+    size_t len = 0;
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    while (1) {
+        ssize_t n = recv(fd, &line[len], sizeof(line) - 1 - len, 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+            break;
+        if (n < 0) {
+            vTaskDelay(pdMS_TO_TICKS(POLL_DELAY_MS));
+            continue;
+        }
+        len += n;
+        line[len] = 0;
+        char *end;
+        while ((end = strchr(line, '\n')) != NULL) {
+            *end = 0;
+            run_command(line);
+            len -= end + 1 - line;
+            memmove(line, end + 1, len + 1);
+        }
+        // Too long to be a command
+        if (len == sizeof(line) - 1)
+            len = 0;
+    }
+    close(fd);
+}
+
+static void host_input_task(void *arg)
+{
+    if (strcmp(CONFIG_HC_HOST_INPUT_SCRIPT, "") != 0)
+        run_script(CONFIG_HC_HOST_INPUT_SCRIPT);
+    if (CONFIG_HC_HOST_INPUT_PORT == 0)
+        vTaskDelete(NULL);
+
+    int server = listen_loopback(CONFIG_HC_HOST_INPUT_PORT);
+    if (server < 0) {
+        ESP_LOGE(TAG, "Failed to listen on port %d", CONFIG_HC_HOST_INPUT_PORT);
+        vTaskDelete(NULL);
+    }
+    ESP_LOGI(TAG, "Accepting input commands on 127.0.0.1:%d", CONFIG_HC_HOST_INPUT_PORT);
+    while (1) {
+        int client = accept(server, NULL, NULL);
+        if (client >= 0)
+            serve_client(client);
+        else
+            vTaskDelay(pdMS_TO_TICKS(POLL_DELAY_MS));
+    }
+}
+
+// Host build has no buttons, the same events are injected from a script and a loopback socket
+void init_gpio_buttons(void)
+{
+    xTaskCreate(host_input_task, "host_input", INPUT_TASK_STACK_SIZE, NULL, INPUT_TASK_PRIORITY, NULL);
+}
 #endif
@@ -0,0 +1,111 @@
+#include <stdint.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "driver/spi_master.h"
+#include "led_spi.h"
+
+#define LED_SPI_CLOCK_HZ    (2500 * 1000)  // 400 ns per SPI bit, 1.2 us per LED bit
+#define LED_SPI_RESET_US    300            // Low level after the frame latches data (WS2812B needs >280 us)
+#define LED_SPI_RESET_BYTES ((LED_SPI_CLOCK_HZ / 1000) * LED_SPI_RESET_US / 8000 + 1)
+
+static const char *TAG = "led_spi";
+
+// Encodes color byte into 3 SPI bytes, MSB first: 0 -> 100, 1 -> 110
+void led_spi_encode_byte(uint8_t value, uint8_t *dst)
+{
+    uint32_t code = 0;
+    for (int8_t bit = 7; bit >= 0; bit--)
+        code = (code << 3) | ((value >> bit) & 1 ? 0b110 : 0b100);
+    dst[0] = code >> 16;
+    dst[1] = code >> 8;
+    dst[2] = code;
+}
+
+esp_err_t led_spi_new(int gpio_num, uint16_t led_count, spi_host_device_t host, struct led_spi **ret_spi)
+{
+    struct led_spi *spi = pvPortMalloc(sizeof(struct led_spi));
+    if (spi == NULL)
+        return ESP_ERR_NO_MEM;
+    memset(spi, 0, sizeof(struct led_spi));
+    spi->host = host;
+    spi->data_size = led_count * LED_SPI_BYTES_PER_LED;
+    spi->buf_size = spi->data_size + LED_SPI_RESET_BYTES;
+
+    for (uint8_t i = 0; i < 2; i++) {
+        // Reset tail is never written, so it stays zero
+        spi->bufs[i] = heap_caps_calloc(1, spi->buf_size, MALLOC_CAP_DMA);
+        if (spi->bufs[i] == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate DMA buffer");
+            goto err;
+        }
+        // Black pixels are not all-zero on the wire
+        for (size_t j = 0; j < spi->data_size; j += LED_SPI_BYTES_PER_COLOR)
+            led_spi_encode_byte(0, &spi->bufs[i][j]);
+        spi->trans[i].length = spi->buf_size * 8;
+        spi->trans[i].tx_buffer = spi->bufs[i];
+    }
+
+    spi_bus_config_t bus_config = {
+        .mosi_io_num = gpio_num,
+        .miso_io_num = -1,
+        .sclk_io_num = -1,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = spi->buf_size,
+    };
+    esp_err_t ret = spi_bus_initialize(host, &bus_config, SPI_DMA_CH_AUTO);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to init SPI bus: %s", esp_err_to_name(ret));
+        goto err;
+    }
+    spi_device_interface_config_t dev_config = {
+        .clock_speed_hz = LED_SPI_CLOCK_HZ,
+        .mode = 0,
+        .spics_io_num = -1,
+        .queue_size = 2,
+    };
+    ret = spi_bus_add_device(host, &dev_config, &spi->device);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add SPI device: %s", esp_err_to_name(ret));
+        spi_bus_free(host);
+        goto err;
+    }
+    *ret_spi = spi;
+    return ESP_OK;
+
+err:
+    free(spi->bufs[0]);
+    free(spi->bufs[1]);
+    free(spi);
+    return ESP_FAIL;
+}
+
+// Returns buffer for the next frame, it is never the one being transferred
+uint8_t *led_spi_back_buffer(struct led_spi *spi)
+{
+    return spi->bufs[spi->back];
+}
+
+// Blocks until the front buffer is sent
+void led_spi_wait_done(struct led_spi *spi)
+{
+    if (!spi->in_flight)
+        return;
+    spi_transaction_t *done;
+    spi_device_get_trans_result(spi->device, &done, portMAX_DELAY);
+    spi->in_flight = false;
+}
+
+// Queues the back buffer for transfer and swaps buffers. Waits only for the previous frame
+esp_err_t led_spi_present(struct led_spi *spi)
+{
+    led_spi_wait_done(spi);
+    esp_err_t ret = spi_device_queue_trans(spi->device, &spi->trans[spi->back], portMAX_DELAY);
+    if (ret != ESP_OK)
+        return ret;
+    spi->in_flight = true;
+    spi->back ^= 1;
+    return ESP_OK;
+}
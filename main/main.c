@@ -2,19 +2,33 @@
 #include <time.h>
 #include "freertos/FreeRTOS.h"
 #include "esp_log.h"
+#include "nvs_flash.h"
+#include "sdkconfig.h"
+#if !CONFIG_IDF_TARGET_LINUX
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_netif_sntp.h"
 #include "esp_vfs_fat.h"
-#include "nvs_flash.h"
+#endif
+#if CONFIG_HC_PM_LIGHT_SLEEP
+#include "esp_pm.h"
+#endif
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+#include "led_spi.h"
+#elif CONFIG_HC_FB_OUTPUT_HOST_SINK
+#include "fb_sink.h"
+#else
 #include "led_strip.h"
-#include "sdkconfig.h"
+#endif
 
 #include "input.h"
 #include "framebuffer.h"
 #include "app_manager.h"
 #include "apps.h"
+#include "assets.h"
+#include "asset_cache.h"
 #include "http_api.h"
+#include "stats.h"
 
 // LED strip definitions
 #if CONFIG_HC_STRIP_LED_TYPE_WS2812
@@ -55,13 +69,32 @@
 
 static const char *TAG = "main";
 
+#if CONFIG_IDF_TARGET_LINUX
+// Host build reads files straight from the source tree
+const char *base_path = HOST_STORAGE_DIR;
+#else
 const char *base_path = "/spiflash";
 static wl_handle_t wl_handle = WL_INVALID_HANDLE;
-static led_strip_handle_t led_strip;
+#endif
+static fb_output_t led_output;
 
 static int wifi_retry_num = 0;
 bool wifi_is_connected = false;
 
+#if CONFIG_HC_FB_OUTPUT_SPI_DIRECT
+static void configure_led(void)
+{
+    ESP_LOGI(TAG, "Configuring LED SPI output");
+    ESP_ERROR_CHECK(led_spi_new(CONFIG_HC_STRIP_GPIO, CONFIG_HC_MATRIX_HEIGHT * CONFIG_HC_MATRIX_WIDTH,
+                                SPI2_HOST, &led_output));
+}
+#elif CONFIG_HC_FB_OUTPUT_HOST_SINK
+static void configure_led(void)
+{
+    ESP_LOGI(TAG, "Configuring frame sink");
+    ESP_ERROR_CHECK(fb_sink_new(CONFIG_HC_MATRIX_WIDTH, CONFIG_HC_MATRIX_HEIGHT, &led_output));
+}
+#else
 static void configure_led(void)
 {
     ESP_LOGI(TAG, "Configuring LED strip");
@@ -81,11 +114,19 @@ static void configure_led(void)
             .with_dma = true,
         }
     };
-    ESP_ERROR_CHECK(led_strip_new_spi_device(&strip_config, &spi_config, &led_strip));
+    ESP_ERROR_CHECK(led_strip_new_spi_device(&strip_config, &spi_config, &led_output));
     // Set all LED off to clear all pixels
-    led_strip_clear(led_strip);
+    led_strip_clear(led_output);
+}
+#endif /* CONFIG_HC_FB_OUTPUT_SPI_DIRECT */
+
+static void set_time_zone(void)
+{
+    setenv("TZ", CONFIG_HC_TIME_ZONE, 1);
+    tzset();
 }
 
+#if !CONFIG_IDF_TARGET_LINUX
 static void configure_storage(void)
 {
     const esp_vfs_fat_mount_config_t mount_config = {
@@ -164,17 +205,35 @@ void init_wifi_sta(void)
 
 static void init_sntp(void)
 {
-    // Set time zone
-    setenv("TZ", CONFIG_HC_TIME_ZONE, 1);
-    tzset();
+    set_time_zone();
     esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_HC_NTP_SERVER);
     esp_netif_sntp_init(&config);
 }
+#endif /* !CONFIG_IDF_TARGET_LINUX */
+
+#if CONFIG_HC_PM_LIGHT_SLEEP
+// Drivers hold PM locks while they work, so the chip sleeps only when every task waits
+static void configure_pm(void)
+{
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_HC_PM_MIN_FREQ_MHZ,
+        .light_sleep_enable = true
+    };
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK)
+        ESP_LOGE(TAG, "Failed to configure power management (%s)", esp_err_to_name(err));
+}
+#endif
 
 void app_main(void)
 {
-    // Storage
-    configure_storage();
+#if CONFIG_HC_PM_LIGHT_SLEEP
+    configure_pm();
+#endif
+    // Icons are mapped from the asset partition, FATFS isn't needed to start apps
+    assets_init();
+    asset_cache_init();
 
     // Init NVS and Wi-Fi
     esp_err_t ret = nvs_flash_init();
@@ -184,15 +243,26 @@ void app_main(void)
     }
     ESP_ERROR_CHECK(ret);
 
+#if CONFIG_IDF_TARGET_LINUX
+    // Host network is always up and its clock is already synchronized
+    set_time_zone();
+    wifi_is_connected = true;
+#else
     if (strcmp(CONFIG_HC_WIFI_SSID, "") != 0) {
         init_sntp();
         init_wifi_sta();
     } else
         ESP_LOGW(TAG, "SSID is empty, skipping Wi-Fi init");
+#endif
+
+#if !CONFIG_IDF_TARGET_LINUX
+    // Storage for everything not in the asset pack, mounted before apps can ask for files
+    configure_storage();
+#endif
 
     // Init LEDs and framebuffer
     configure_led();
-    struct framebuffer *fb = fb_init(led_strip, CONFIG_HC_FB_BRIGHTNESS);
+    struct framebuffer *fb = fb_init(led_output, CONFIG_HC_FB_BRIGHTNESS);
 
     // Draw some lines
     ESP_LOGI(TAG, "Drawing square");
@@ -222,4 +292,5 @@ void app_main(void)
     init_gpio_buttons();
 
     start_http_server();
+    stats_start();
 }
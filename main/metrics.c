@@ -0,0 +1,337 @@
+/* Frame timing metrics: histograms of render stages and app drawing, counters of render requests.
+ * Input events are traced from the button interrupt to the first frame requested by their
+ * receiver. Served by http_api as /metrics in Prometheus text format. Recording is a timer read
+ * and a short critical section, everything is compiled out without CONFIG_HC_METRICS */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "app_manager.h"
+#include "asset_cache.h"
+#include "metrics.h"
+#include "sdkconfig.h"
+
+#if CONFIG_HC_METRICS
+
+#define TAG "metrics"
+
+// Upper bounds of buckets are 1, 2, 4 ... 1048576 us, the last one is +Inf
+#define METRICS_BUCKETS     22
+
+// Traces without a frame request within this time are dropped, the receiver ignored the event
+#define INPUT_TRACE_TIMEOUT_US  1000000
+
+struct metrics_hist {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[METRICS_BUCKETS];  // Not cumulative
+};
+
+struct metrics_snapshot {
+    struct metrics_hist stages[METRICS_STAGE_COUNT];
+    struct metrics_hist apps[CONFIG_HC_AM_MAX_APPS];
+    struct metrics_hist input[METRICS_INPUT_STAGE_COUNT];
+    uint32_t counters[METRICS_COUNTER_COUNT];
+    uint32_t input_frame;   // The last frame showing a traced input
+};
+
+enum trace_state {
+    TRACE_IDLE,
+    TRACE_DISPATCH,     // Event is recognized, waiting for its receiver
+    TRACE_REQUEST,      // Waiting for a frame request of the receiver
+    TRACE_FRAME         // Waiting for a frame started after the request
+};
+
+// Only the latest input event is traced, a newer one replaces it
+static struct {
+    enum trace_state state;
+    TaskHandle_t receiver;
+    int64_t irq_us;
+    int64_t event_us;
+    int64_t request_us;
+} trace;
+
+static portMUX_TYPE metrics_lock = portMUX_INITIALIZER_UNLOCKED;
+static struct metrics_snapshot metrics;
+
+static const char *stage_names[METRICS_STAGE_COUNT] = {
+    "frame", "anim", "compose", "refresh", "slide_interval", "switch"
+};
+
+static const char *input_stage_names[METRICS_INPUT_STAGE_COUNT] = {
+    "queue", "recognize", "app", "render", "total"
+};
+
+static const struct {
+    const char *name;
+    const char *help;
+} counter_info[METRICS_COUNTER_COUNT] = {
+    { "hc_render_requests_total", "Frame requests received by the render task" },
+    { "hc_render_coalesced_total", "Frame requests merged into a frame of another request" },
+    { "hc_render_delayed_total", "Frames held back by the frame rate limit" },
+    { "hc_render_scheduled_total", "Frames presented on schedule without requests" },
+    { "hc_render_frames_total", "Presented frames" },
+    { "hc_slide_frames_total", "Frames of slide animations" },
+    { "hc_slide_overruns_total", "Slide frames late by more than a tick" },
+    { "hc_switch_timeouts_total", "Slides started before the new app presented a frame" },
+    { "hc_input_events_total", "Input events sent to apps or the app manager" },
+    { "hc_input_traced_total", "Input events traced up to the frame showing them" },
+    { "hc_input_lost_total", "Input events not followed by a frame request in time" },
+    { "hc_events_merged_total", "Knob turns merged into an event waiting in app queue" },
+    { "hc_events_dropped_total", "App events not delivered because the queue was full" },
+};
+
+static void hist_add(struct metrics_hist *h, int64_t us)
+{
+    uint32_t value = us <= 0 ? 0 : (us >= UINT32_MAX ? UINT32_MAX : us);
+    // Smallest i with value <= 2^i
+    uint8_t bucket = value <= 1 ? 0 : 32 - __builtin_clz(value - 1);
+    if (bucket >= METRICS_BUCKETS)
+        bucket = METRICS_BUCKETS - 1;
+
+    portENTER_CRITICAL(&metrics_lock);
+    if (h->count == 0 || value < h->min_us)
+        h->min_us = value;
+    if (value > h->max_us)
+        h->max_us = value;
+    h->count++;
+    h->sum_us += value;
+    h->buckets[bucket]++;
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+void metrics_stage_end(enum metrics_stage stage, int64_t start_us)
+{
+    hist_add(&metrics.stages[stage], esp_timer_get_time() - start_us);
+}
+
+void metrics_stage_add(enum metrics_stage stage, int64_t us)
+{
+    hist_add(&metrics.stages[stage], us);
+}
+
+// Time an app spent on a frame, from its first change of canvas to the refresh request
+void metrics_app_draw(uint8_t app, int64_t start_us)
+{
+    if (app < CONFIG_HC_AM_MAX_APPS)
+        hist_add(&metrics.apps[app], esp_timer_get_time() - start_us);
+}
+
+void metrics_add(enum metrics_counter counter, uint32_t n)
+{
+    portENTER_CRITICAL(&metrics_lock);
+    metrics.counters[counter] += n;
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+void metrics_input_stage_add(enum metrics_input_stage stage, int64_t us)
+{
+    hist_add(&metrics.input[stage], us);
+}
+
+// Starts a trace of an input event, irq_us is the time of the last edge it was recognized from.
+// Must be followed by metrics_input_dispatch() when the event is sent
+void metrics_input_event(int64_t irq_us)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&metrics_lock);
+    if (trace.state != TRACE_IDLE)
+        metrics.counters[METRICS_INPUT_LOST]++;
+    metrics.counters[METRICS_INPUT_EVENTS]++;
+    trace.state = TRACE_DISPATCH;
+    trace.irq_us = irq_us;
+    trace.event_us = now;
+    portEXIT_CRITICAL(&metrics_lock);
+    hist_add(&metrics.input[METRICS_INPUT_RECOGNIZE], now - irq_us);
+}
+
+// The traced event was sent to receiver, its next frame request is the reaction
+void metrics_input_dispatch(TaskHandle_t receiver)
+{
+    portENTER_CRITICAL(&metrics_lock);
+    if (trace.state == TRACE_DISPATCH) {
+        trace.state = TRACE_REQUEST;
+        trace.receiver = receiver;
+    }
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+// Called on every frame request, cheap unless the caller is the receiver of a traced event
+void metrics_input_request(void)
+{
+    if (trace.state != TRACE_REQUEST || trace.receiver != xTaskGetCurrentTaskHandle())
+        return;
+    int64_t now = esp_timer_get_time();
+    bool traced = false;
+    portENTER_CRITICAL(&metrics_lock);
+    if (trace.state == TRACE_REQUEST) {
+        if (now - trace.event_us > INPUT_TRACE_TIMEOUT_US) {
+            metrics.counters[METRICS_INPUT_LOST]++;
+            trace.state = TRACE_IDLE;
+        } else {
+            trace.state = TRACE_FRAME;
+            trace.request_us = now;
+            traced = true;
+        }
+    }
+    int64_t event_us = trace.event_us;
+    portEXIT_CRITICAL(&metrics_lock);
+    if (traced)
+        hist_add(&metrics.input[METRICS_INPUT_APP], now - event_us);
+}
+
+// Called by the render task after a frame is presented, the first frame started
+// after the request of the receiver shows the input
+void metrics_input_presented(int64_t frame_start_us, uint32_t frame)
+{
+    if (trace.state != TRACE_FRAME)
+        return;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&metrics_lock);
+    bool done = trace.state == TRACE_FRAME && frame_start_us >= trace.request_us;
+    if (done) {
+        trace.state = TRACE_IDLE;
+        metrics.counters[METRICS_INPUT_TRACED]++;
+        metrics.input_frame = frame;
+    }
+    int64_t irq_us = trace.irq_us, request_us = trace.request_us;
+    portEXIT_CRITICAL(&metrics_lock);
+    if (done) {
+        hist_add(&metrics.input[METRICS_INPUT_RENDER], now - request_us);
+        hist_add(&metrics.input[METRICS_INPUT_TOTAL], now - irq_us);
+        ESP_LOGD(TAG, "Input shown in frame %lu after %lld us", (unsigned long) frame, (long long) (now - irq_us));
+    }
+}
+
+// Upper bound of the bucket holding the 99th percentile, clamped to the observed range
+static uint32_t hist_p99(const struct metrics_hist *h)
+{
+    uint32_t rank = h->count - h->count / 100;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < METRICS_BUCKETS - 1; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank)
+            return MAX(MIN(1UL << i, h->max_us), h->min_us);
+    }
+    return h->max_us;
+}
+
+struct prom_out {
+    metrics_write_t write;
+    void *ctx;
+};
+
+// Writes one line at most, longer ones are cut
+static void prom_printf(struct prom_out *out, const char *fmt, ...)
+{
+    char line[160];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len > 0)
+        out->write(out->ctx, line, MIN(len, sizeof(line) - 1));
+}
+
+// Histogram family and min/avg/p99/max gauges, one series per label value.
+// Series without a name (apps beyond the list) are skipped
+static void write_hists(struct prom_out *out, const char *name, const char *help, const char *label,
+                        const char *const *values, const struct metrics_hist *hists, uint8_t count)
+{
+    prom_printf(out, "# HELP %s %s\n", name, help);
+    prom_printf(out, "# TYPE %s histogram\n", name);
+    for (uint8_t i = 0; i < count; i++) {
+        const struct metrics_hist *h = &hists[i];
+        if (values[i] == NULL)
+            continue;
+        uint32_t cumulative = 0;
+        for (uint8_t b = 0; b < METRICS_BUCKETS - 1; b++) {
+            cumulative += h->buckets[b];
+            prom_printf(out, "%s_bucket{%s=\"%s\",le=\"%lu\"} %lu\n", name, label, values[i],
+                        1UL << b, (unsigned long) cumulative);
+        }
+        prom_printf(out, "%s_bucket{%s=\"%s\",le=\"+Inf\"} %lu\n", name, label, values[i],
+                    (unsigned long) h->count);
+        prom_printf(out, "%s_sum{%s=\"%s\"} %llu\n", name, label, values[i], (unsigned long long) h->sum_us);
+        prom_printf(out, "%s_count{%s=\"%s\"} %lu\n", name, label, values[i], (unsigned long) h->count);
+    }
+
+    static const char *stats[] = { "min", "avg", "p99", "max" };
+    for (uint8_t s = 0; s < 4; s++) {
+        prom_printf(out, "# TYPE %s_%s gauge\n", name, stats[s]);
+        for (uint8_t i = 0; i < count; i++) {
+            const struct metrics_hist *h = &hists[i];
+            if (values[i] == NULL || h->count == 0)
+                continue;
+            uint32_t value = s == 0 ? h->min_us : s == 1 ? h->sum_us / h->count :
+                             s == 2 ? hist_p99(h) : h->max_us;
+            prom_printf(out, "%s_%s{%s=\"%s\"} %lu\n", name, stats[s], label, values[i], (unsigned long) value);
+        }
+    }
+}
+
+// Writes all metrics in Prometheus text format (version 0.0.4) piece by piece
+void metrics_write_prometheus(metrics_write_t write, void *ctx)
+{
+    struct metrics_snapshot *snap = pvPortMalloc(sizeof(*snap));
+    if (snap == NULL)
+        return;
+    portENTER_CRITICAL(&metrics_lock);
+    memcpy(snap, &metrics, sizeof(*snap));
+    portEXIT_CRITICAL(&metrics_lock);
+
+    struct prom_out out = { write, ctx };
+    for (uint8_t i = 0; i < METRICS_COUNTER_COUNT; i++) {
+        prom_printf(&out, "# HELP %s %s\n", counter_info[i].name, counter_info[i].help);
+        prom_printf(&out, "# TYPE %s counter\n", counter_info[i].name);
+        prom_printf(&out, "%s %lu\n", counter_info[i].name, (unsigned long) snap->counters[i]);
+    }
+
+    // Asset cache keeps its own counters
+    struct asset_cache_stats cache;
+    asset_cache_get_stats(&cache);
+    const struct {
+        const char *name;
+        const char *type;
+        const char *help;
+        unsigned long value;
+    } cache_info[] = {
+        { "hc_asset_cache_hits_total", "counter", "Images found in the asset cache", cache.hits },
+        { "hc_asset_cache_misses_total", "counter", "Images loaded into the asset cache", cache.misses },
+        { "hc_asset_cache_evictions_total", "counter", "Images evicted from the asset cache", cache.evictions },
+        { "hc_asset_cache_failures_total", "counter", "Images failed to load", cache.failures },
+        { "hc_asset_cache_images", "gauge", "Images in the asset cache", cache.count },
+        { "hc_asset_cache_used_bytes", "gauge", "RAM taken by images loaded from files", cache.used },
+        { "hc_asset_cache_budget_bytes", "gauge", "RAM budget of the asset cache", cache.budget },
+    };
+    for (uint8_t i = 0; i < sizeof(cache_info) / sizeof(cache_info[0]); i++) {
+        prom_printf(&out, "# HELP %s %s\n", cache_info[i].name, cache_info[i].help);
+        prom_printf(&out, "# TYPE %s %s\n", cache_info[i].name, cache_info[i].type);
+        prom_printf(&out, "%s %lu\n", cache_info[i].name, cache_info[i].value);
+    }
+
+    write_hists(&out, "hc_frame_stage_us", "Time of render task stages in microseconds", "stage",
+                stage_names, snap->stages, METRICS_STAGE_COUNT);
+    write_hists(&out, "hc_input_latency_us", "Input latency by stage in microseconds", "stage",
+                input_stage_names, snap->input, METRICS_INPUT_STAGE_COUNT);
+    prom_printf(&out, "# HELP hc_input_frame Number of the last frame showing a traced input\n");
+    prom_printf(&out, "# TYPE hc_input_frame gauge\n");
+    prom_printf(&out, "hc_input_frame %lu\n", (unsigned long) snap->input_frame);
+
+    const char *app_names[CONFIG_HC_AM_MAX_APPS] = { 0 };
+    struct am_app_info *apps = get_apps_list();
+    for (uint8_t i = 0; apps != NULL && i < CONFIG_HC_AM_MAX_APPS && apps[i].name != NULL; i++)
+        app_names[i] = apps[i].name;
+    write_hists(&out, "hc_app_draw_us", "Time from the first change of an app frame to its refresh request",
+                "app", app_names, snap->apps, CONFIG_HC_AM_MAX_APPS);
+    vPortFree(snap);
+}
+
+#endif
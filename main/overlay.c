@@ -0,0 +1,236 @@
+/* Overlay layers, composited by the render task on top of the current window.
+ * Overlays can be changed from any task: draw into ov->canvas or change parameters
+ * between overlay_lock() and overlay_unlock(), the frame is requested on unlock */
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "overlay.h"
+#include "render.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "overlay";
+
+static struct overlay overlays[CONFIG_HC_AM_MAX_OVERLAYS];
+static SemaphoreHandle_t overlays_mutex = NULL;
+
+void overlay_init(void)
+{
+    if (overlays_mutex == NULL)
+        overlays_mutex = xSemaphoreCreateMutex();
+}
+
+void overlay_lock(void)
+{
+    xSemaphoreTake(overlays_mutex, portMAX_DELAY);
+}
+
+void overlay_unlock(void)
+{
+    xSemaphoreGive(overlays_mutex);
+    render_request();
+}
+
+struct overlay *overlay_create(uint8_t width, uint8_t height, uint8_t x, uint8_t y)
+{
+    struct overlay *ov = NULL;
+    overlay_lock();
+    for (uint8_t i = 0; i < CONFIG_HC_AM_MAX_OVERLAYS; i++) {
+        if (!overlays[i].used) {
+            ov = &overlays[i];
+            break;
+        }
+    }
+    if (ov == NULL) {
+        ESP_LOGE(TAG, "Reached maximum number of overlays");
+        overlay_unlock();
+        return NULL;
+    }
+    memset(ov, 0, sizeof(struct overlay));
+    ov->canvas = cv_init(width, height);
+    ov->x = x;
+    ov->y = y;
+    ov->opacity = 255;
+    ov->shown.x1 = 1;  // Empty
+    ov->used = true;
+    overlay_unlock();
+    return ov;
+}
+
+void overlay_destroy(struct overlay *ov)
+{
+    overlay_lock();
+    // Keep the slot until the area under overlay is restored
+    ov->visible = false;
+    ov->destroyed = true;
+    ov->changed = true;
+    overlay_unlock();
+}
+
+void overlay_set_visible(struct overlay *ov, bool visible)
+{
+    overlay_lock();
+    ov->visible = visible;
+    ov->changed = true;
+    overlay_unlock();
+}
+
+void overlay_set_position(struct overlay *ov, uint8_t x, uint8_t y)
+{
+    overlay_lock();
+    ov->x = x;
+    ov->y = y;
+    ov->changed = true;
+    overlay_unlock();
+}
+
+void overlay_set_opacity(struct overlay *ov, uint8_t opacity)
+{
+    overlay_lock();
+    ov->opacity = opacity;
+    ov->changed = true;
+    overlay_unlock();
+}
+
+void overlay_set_key(struct overlay *ov, bool use_key, crgb key)
+{
+    overlay_lock();
+    ov->use_key = use_key;
+    ov->key = key;
+    ov->changed = true;
+    overlay_unlock();
+}
+
+static inline uint8_t blend_channel(uint8_t src, uint8_t dst, uint8_t alpha)
+{
+    return (src * alpha + dst * (255 - alpha) + 127) / 255;
+}
+
+// Blends visible overlays into one matrix row
+static void blend_row(crgb *line, uint8_t y)
+{
+    for (uint8_t i = 0; i < CONFIG_HC_AM_MAX_OVERLAYS; i++) {
+        struct overlay *ov = &overlays[i];
+        if (!ov->used || !ov->visible || ov->opacity == 0 || y < ov->y || y >= ov->y + ov->canvas->height)
+            continue;
+        const crgb *src = &ov->canvas->buf[(y - ov->y) * ov->canvas->width];
+        uint8_t len = MIN(ov->canvas->width, MAX(CONFIG_HC_MATRIX_WIDTH - ov->x, 0));
+        crgb *dst = &line[ov->x];
+        for (uint8_t j = 0; j < len; j++) {
+            crgb px = src[j];
+            if (ov->use_key && px.r == ov->key.r && px.g == ov->key.g && px.b == ov->key.b)
+                continue;
+            if (ov->opacity == 255) {
+                dst[j] = px;
+            } else {
+                dst[j].r = blend_channel(px.r, dst[j].r, ov->opacity);
+                dst[j].g = blend_channel(px.g, dst[j].g, ov->opacity);
+                dst[j].b = blend_channel(px.b, dst[j].b, ov->opacity);
+            }
+        }
+    }
+}
+
+static void mark_rows(uint32_t *rows, uint8_t y1, uint8_t y2)
+{
+    for (uint16_t y = y1; y <= y2 && y < CONFIG_HC_MATRIX_HEIGHT; y++)
+        rows[y / 32] |= 1UL << (y % 32);
+}
+
+// Collects rows affected by overlay changes, returns true if any overlay is visible or changed
+static bool collect_overlay_rows(uint32_t *rows)
+{
+    bool active = false;
+    for (uint8_t i = 0; i < CONFIG_HC_AM_MAX_OVERLAYS; i++) {
+        struct overlay *ov = &overlays[i];
+        if (!ov->used)
+            continue;
+        if (ov->visible)
+            active = true;
+        if (!ov->changed && !cv_is_dirty(ov->canvas))
+            continue;
+        active = true;
+
+        // Restore the old area and draw the new one
+        if (ov->shown.x1 <= ov->shown.x2)
+            mark_rows(rows, ov->shown.y1, ov->shown.y2);
+        if (ov->visible) {
+            ov->shown.x1 = ov->x;
+            ov->shown.y1 = ov->y;
+            ov->shown.x2 = MIN(ov->x + ov->canvas->width, CONFIG_HC_MATRIX_WIDTH) - 1;
+            ov->shown.y2 = MIN(ov->y + ov->canvas->height, CONFIG_HC_MATRIX_HEIGHT) - 1;
+            mark_rows(rows, ov->shown.y1, ov->shown.y2);
+        } else {
+            ov->shown.x1 = 1;
+            ov->shown.x2 = 0;
+        }
+        ov->changed = false;
+        cv_clear_dirty(ov->canvas);
+    }
+    return active;
+}
+
+// Frees overlays which were destroyed and are already removed from the screen
+static void collect_garbage(void)
+{
+    for (uint8_t i = 0; i < CONFIG_HC_AM_MAX_OVERLAYS; i++) {
+        struct overlay *ov = &overlays[i];
+        if (ov->used && ov->destroyed && !ov->changed) {
+            cv_free(ov->canvas);
+            ov->canvas = NULL;
+            ov->used = false;
+        }
+    }
+}
+
+// Puts base canvas with overlays on top into framebuffer. Only rows changed in base canvas
+// or touched by changed overlays are recomposed, row by row. With full set, all rows are recomposed.
+// Returns false without touching framebuffer if there are no overlays to draw
+bool overlay_compose(struct framebuffer *fb, struct canvas *base, bool full)
+{
+    xSemaphoreTake(overlays_mutex, portMAX_DELAY);
+    uint32_t rows[FB_DIRTY_WORDS] = { 0 };
+    if (!collect_overlay_rows(rows)) {
+        collect_garbage();
+        xSemaphoreGive(overlays_mutex);
+        return false;
+    }
+
+    struct cv_rect d;
+    const crgb *pixels = cv_lock_front(base, &d);
+    // Own buffer of framebuffer is outdated if it was presenting a canvas directly
+    if (fb_set_source(fb, NULL) || full)
+        mark_rows(rows, 0, CONFIG_HC_MATRIX_HEIGHT - 1);
+    else if (d.x1 <= d.x2)
+        mark_rows(rows, d.y1, d.y2);
+
+    crgb line[CONFIG_HC_MATRIX_WIDTH];
+    for (uint16_t y = 0; y < MIN(base->height, CONFIG_HC_MATRIX_HEIGHT); y++) {
+        if (!(rows[y / 32] & (1UL << (y % 32))))
+            continue;
+        memcpy(line, &pixels[y * base->width], sizeof(line));
+        blend_row(line, y);
+        fb_update_row(fb, 0, y, line, CONFIG_HC_MATRIX_WIDTH);
+    }
+    cv_unlock_front(base);
+    collect_garbage();
+    xSemaphoreGive(overlays_mutex);
+    return true;
+}
+
+// Blends overlays in place on top of the whole framebuffer (e.g. during the slide animation)
+void overlay_blend_fb(struct framebuffer *fb)
+{
+    xSemaphoreTake(overlays_mutex, portMAX_DELAY);
+    uint32_t rows[FB_DIRTY_WORDS] = { 0 };
+    collect_overlay_rows(rows);
+    fb_set_source(fb, NULL);
+    for (uint16_t y = 0; y < CONFIG_HC_MATRIX_HEIGHT; y++)
+        blend_row(fb->buf[y], y);
+    fb_mark_dirty_all(fb);
+    collect_garbage();
+    xSemaphoreGive(overlays_mutex);
+}
@@ -0,0 +1,156 @@
+/* Streaming QOI decoder. The file is read in small chunks and every decoded pixel is
+ * blended straight into the canvas, so memory use doesn't depend on image size: the
+ * chunk and QOI color index are all it needs. Meant for large or one-off images,
+ * icons drawn over and over are cheaper to keep converted in the asset cache */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "qoi_stream.h"
+
+#define TAG "qoi_stream"
+
+#define QOI_STREAM_CHUNK    256
+
+#define QOI_OP_INDEX    0x00
+#define QOI_OP_DIFF     0x40
+#define QOI_OP_LUMA     0x80
+#define QOI_OP_RUN      0xc0
+#define QOI_OP_RGB      0xfe
+#define QOI_OP_RGBA     0xff
+#define QOI_MASK_2      0xc0
+
+struct qoi_rgba {
+    uint8_t r, g, b, a;
+};
+
+struct qoi_stream {
+    FILE *file;
+    uint16_t pos;
+    uint16_t len;
+    bool eof;
+    uint8_t buf[QOI_STREAM_CHUNK];
+};
+
+static inline uint8_t stream_byte(struct qoi_stream *s)
+{
+    if (s->pos == s->len) {
+        s->len = fread(s->buf, 1, sizeof(s->buf), s->file);
+        s->pos = 0;
+        if (s->len == 0) {
+            s->eof = true;
+            return 0;
+        }
+    }
+    return s->buf[s->pos++];
+}
+
+static uint32_t stream_u32(struct qoi_stream *s)
+{
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < 4; i++)
+        v = v << 8 | stream_byte(s);
+    return v;
+}
+
+// Same as cv_draw_image() with the pixel premultiplied on the fly
+static inline void blend_pixel(crgb *dst, struct qoi_rgba px)
+{
+    if (px.a == 255) {
+        dst->r = px.r;
+        dst->g = px.g;
+        dst->b = px.b;
+    } else if (px.a != 0) {
+        uint8_t inv_a = 255 - px.a;
+        dst->r = mul_div255(px.r, px.a) + mul_div255(dst->r, inv_a);
+        dst->g = mul_div255(px.g, px.a) + mul_div255(dst->g, inv_a);
+        dst->b = mul_div255(px.b, px.a) + mul_div255(dst->b, inv_a);
+    }
+}
+
+// Decodes .qoi file into canvas with its top left corner at x, y, clipped by canvas edges.
+// Decoding stops after the last visible row
+uint8_t qoi_stream_draw(struct canvas *cv, const char *filename, int16_t x, int16_t y)
+{
+    struct qoi_stream s = { .pos = 0, .len = 0, .eof = false };
+    s.file = fopen(filename, "rb");
+    if (s.file == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s!", filename);
+        return 1;
+    }
+    // Chunks are the only buffering
+    setvbuf(s.file, NULL, _IONBF, 0);
+
+    char magic[4];
+    for (uint8_t i = 0; i < 4; i++)
+        magic[i] = stream_byte(&s);
+    uint32_t width = stream_u32(&s);
+    uint32_t height = stream_u32(&s);
+    stream_byte(&s);    // Channels and colorspace don't change decoding
+    stream_byte(&s);
+    if (s.eof || memcmp(magic, "qoif", 4) != 0 || width == 0 || height == 0 ||
+        width > INT16_MAX || height > INT16_MAX) {
+        ESP_LOGE(TAG, "%s is not a valid QOI image!", filename);
+        fclose(s.file);
+        return 1;
+    }
+
+    int32_t cx1 = MAX(x, 0);
+    int32_t cx2 = MIN(x + (int32_t)width, cv->width) - 1;
+    int32_t cy1 = MAX(y, 0);
+    int32_t cy2 = MIN(y + (int32_t)height, cv->height) - 1;
+
+    struct qoi_rgba index[64];
+    memset(index, 0, sizeof(index));
+    struct qoi_rgba px = { 0, 0, 0, 255 };
+    uint8_t run = 0;
+
+    for (int32_t py = y; py <= cy2 && !s.eof; py++) {
+        crgb *row = py >= cy1 && cx1 <= cx2 ? &cv->buf[py * cv->width] : NULL;
+        for (int32_t px_x = x; px_x < x + (int32_t)width; px_x++) {
+            if (run > 0) {
+                run--;
+            } else {
+                uint8_t b1 = stream_byte(&s);
+                if (b1 == QOI_OP_RGB) {
+                    px.r = stream_byte(&s);
+                    px.g = stream_byte(&s);
+                    px.b = stream_byte(&s);
+                } else if (b1 == QOI_OP_RGBA) {
+                    px.r = stream_byte(&s);
+                    px.g = stream_byte(&s);
+                    px.b = stream_byte(&s);
+                    px.a = stream_byte(&s);
+                } else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+                    px = index[b1];
+                } else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+                    px.r += ((b1 >> 4) & 0x03) - 2;
+                    px.g += ((b1 >> 2) & 0x03) - 2;
+                    px.b += (b1 & 0x03) - 2;
+                } else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+                    uint8_t b2 = stream_byte(&s);
+                    int8_t vg = (b1 & 0x3f) - 32;
+                    px.r += vg - 8 + ((b2 >> 4) & 0x0f);
+                    px.g += vg;
+                    px.b += vg - 8 + (b2 & 0x0f);
+                } else {
+                    run = b1 & 0x3f;
+                }
+                index[(px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64] = px;
+            }
+            if (row != NULL && px_x >= cx1 && px_x <= cx2)
+                blend_pixel(&row[px_x], px);
+        }
+    }
+    fclose(s.file);
+
+    if (cx1 <= cx2 && cy1 <= cy2)
+        cv_mark_dirty(cv, cx1, cy1, cx2, cy2);
+    if (s.eof) {
+        ESP_LOGE(TAG, "%s is truncated!", filename);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+/* Render task: composes and presents frames at most CONFIG_HC_RENDER_MAX_FPS times per second.
+ * Any number of refresh requests between two ticks result in a single frame */
+
+#include <stdint.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "metrics.h"
+#include "render.h"
+#include "sdkconfig.h"
+
+#define TAG "render"
+
+#define RENDER_STACK_SIZE       (3 * 1024)
+#define RENDER_TASK_PRIORITY    (tskIDLE_PRIORITY + 4)
+
+#define RENDER_VSYNC_BIT        (1 << 0)
+
+#define FRAME_PERIOD    (pdMS_TO_TICKS(1000 / CONFIG_HC_RENDER_MAX_FPS) > 0 ? \
+                         pdMS_TO_TICKS(1000 / CONFIG_HC_RENDER_MAX_FPS) : 1)
+
+static TaskHandle_t render_handle = NULL;
+static EventGroupHandle_t vsync_group = NULL;
+static struct framebuffer *framebuffer = NULL;
+static render_present_t present_cb = NULL;
+
+static portMUX_TYPE info_lock = portMUX_INITIALIZER_UNLOCKED;
+static struct render_frame_info frame_info;
+// esp_timer time of the earliest scheduled frame, INT64_MAX if none
+static int64_t deadline_us = INT64_MAX;
+// Notifications given only to recompute the timeout, they don't ask for a frame
+static uint32_t reschedules = 0;
+
+// Ticks to wait for a request until the scheduled frame is due
+static TickType_t time_to_deadline(void)
+{
+    portENTER_CRITICAL(&info_lock);
+    int64_t deadline = deadline_us;
+    portEXIT_CRITICAL(&info_lock);
+    if (deadline == INT64_MAX)
+        return portMAX_DELAY;
+    // Rounded up, waking a tick early would present the frame before it's due
+    const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+    int64_t left_us = deadline - esp_timer_get_time();
+    return left_us > 0 ? (left_us + tick_us - 1) / tick_us : 0;
+}
+
+static void render_task(void *param)
+{
+    TickType_t last_frame = xTaskGetTickCount() - FRAME_PERIOD;
+    while (1) {
+        // Wait for the first request or the scheduled frame
+        uint32_t count = ulTaskNotifyTake(pdTRUE, time_to_deadline());
+        portENTER_CRITICAL(&info_lock);
+        uint32_t rescheduled = MIN(count, reschedules);
+        reschedules -= rescheduled;
+        portEXIT_CRITICAL(&info_lock);
+        if (count == rescheduled && time_to_deadline() != 0)
+            continue;
+
+        // Keep frame pacing, requests arriving meanwhile are merged into this frame
+        TickType_t since_last = xTaskGetTickCount() - last_frame;
+        if (since_last < FRAME_PERIOD) {
+            vTaskDelay(FRAME_PERIOD - since_last);
+            metrics_add(METRICS_RENDER_DELAYED, 1);
+        }
+        uint32_t requests = count - rescheduled + ulTaskNotifyTake(pdTRUE, 0);
+        last_frame = xTaskGetTickCount();
+        // The frame being composed covers the schedule, present_cb may set a new one
+        portENTER_CRITICAL(&info_lock);
+        deadline_us = INT64_MAX;
+        portEXIT_CRITICAL(&info_lock);
+
+        // Frames started before a request don't show its changes, see metrics_input_presented()
+        int64_t start = metrics_start();
+        present_cb(framebuffer);
+        metrics_stage_end(METRICS_STAGE_FRAME, start);
+        metrics_add(METRICS_RENDER_FRAMES, 1);
+        metrics_add(METRICS_RENDER_REQUESTS, requests);
+        if (requests > 1)
+            metrics_add(METRICS_RENDER_COALESCED, requests - 1);
+        else if (requests == 0)
+            metrics_add(METRICS_RENDER_SCHEDULED, 1);
+
+        portENTER_CRITICAL(&info_lock);
+        uint32_t frame = ++frame_info.frame;
+        frame_info.timestamp_us = esp_timer_get_time();
+        portEXIT_CRITICAL(&info_lock);
+        metrics_input_presented(start, frame);
+
+        // Wake up everyone waiting for this frame
+        xEventGroupSetBits(vsync_group, RENDER_VSYNC_BIT);
+        xEventGroupClearBits(vsync_group, RENDER_VSYNC_BIT);
+    }
+}
+
+void render_start(struct framebuffer *fb, render_present_t present)
+{
+    if (render_handle != NULL) {
+        ESP_LOGE(TAG, "Render task is already running!");
+        return;
+    }
+    framebuffer = fb;
+    present_cb = present;
+    vsync_group = xEventGroupCreate();
+
+    int ret = xTaskCreatePinnedToCore(
+        render_task,
+        "render",
+        RENDER_STACK_SIZE,
+        NULL,
+        RENDER_TASK_PRIORITY,
+        &render_handle,
+        CONFIG_HC_RENDER_CORE < 0 ? tskNO_AFFINITY : CONFIG_HC_RENDER_CORE
+    );
+    if (ret != pdPASS)
+        ESP_LOGE(TAG, "Failed to start render task");
+}
+
+// Asks for a new frame, never blocks
+void render_request(void)
+{
+    metrics_input_request();
+    if (render_handle != NULL)
+        xTaskNotifyGive(render_handle);
+}
+
+// Asks for a frame at esp_timer time time_us, for content changing on its own schedule.
+// Earlier requests win, the frame is still limited by the maximum frame rate
+void render_request_at(int64_t time_us)
+{
+    if (render_handle == NULL)
+        return;
+    // Render task has to recompute its timeout unless it's the caller
+    bool wake = false;
+    portENTER_CRITICAL(&info_lock);
+    if (time_us < deadline_us) {
+        deadline_us = time_us;
+        wake = xTaskGetCurrentTaskHandle() != render_handle;
+        if (wake)
+            reschedules++;
+    }
+    portEXIT_CRITICAL(&info_lock);
+    if (wake)
+        xTaskNotifyGive(render_handle);
+}
+
+void render_request_from_isr(BaseType_t *higher_task_wakeup)
+{
+    if (render_handle != NULL)
+        vTaskNotifyGiveFromISR(render_handle, higher_task_wakeup);
+}
+
+// Blocks until the next frame is presented, returns false on timeout
+bool render_wait_vsync(TickType_t timeout)
+{
+    if (vsync_group == NULL)
+        return false;
+    EventBits_t bits = xEventGroupWaitBits(vsync_group, RENDER_VSYNC_BIT, pdFALSE, pdTRUE, timeout);
+    return (bits & RENDER_VSYNC_BIT) != 0;
+}
+
+void render_get_frame_info(struct render_frame_info *info)
+{
+    portENTER_CRITICAL(&info_lock);
+    *info = frame_info;
+    portEXIT_CRITICAL(&info_lock);
+}
@@ -0,0 +1,313 @@
+/* System statistics: CPU share and stack high-water mark of every task, heap usage, wakeups of apps.
+ * A low-priority collector samples them every CONFIG_HC_STATS_PERIOD seconds into a ring
+ * buffer of CONFIG_HC_STATS_SAMPLES entries, served by http_api as /stats */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "app_manager.h"
+#include "stats.h"
+#include "sdkconfig.h"
+
+#if CONFIG_HC_STATS
+
+#define TAG "stats"
+
+#define STATS_STACK_SIZE        (3 * 1024)
+#define STATS_TASK_PRIORITY     (tskIDLE_PRIORITY + 1)
+
+// Task as seen in one sample
+struct stats_task {
+    uint16_t cpu_permille;  // Share of CPU time of all cores since the previous sample
+    uint16_t stack_free;    // Stack high-water mark in bytes
+    uint8_t slot;           // Index in known_tasks
+    uint8_t state;          // eTaskState
+};
+
+// App as seen in one sample, cooperative ones share the app_loop task
+struct stats_app {
+    uint16_t cpu_permille;  // Share of CPU time of all cores the app was busy since the previous sample
+    uint16_t wakeups;
+};
+
+struct stats_sample {
+    uint32_t time_s;        // Uptime
+    uint32_t heap_free;
+    uint32_t heap_min_free;
+    uint32_t heap_largest;
+    uint8_t task_count;
+    struct stats_task tasks[CONFIG_HC_STATS_MAX_TASKS];
+    struct stats_app apps[CONFIG_HC_AM_MAX_APPS];
+};
+
+// Tasks are identified by their number. A task recreated with the same name, like an app
+// started again, takes the slot of the old one
+struct known_task {
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t number;
+    configRUN_TIME_COUNTER_TYPE run_time;
+};
+
+static SemaphoreHandle_t stats_mutex = NULL;
+static struct stats_sample *samples = NULL;
+static uint16_t sample_count = 0;
+static uint16_t sample_next = 0;
+static struct known_task known_tasks[CONFIG_HC_STATS_MAX_TASKS];
+static uint8_t known_count = 0;
+static configRUN_TIME_COUNTER_TYPE last_total = 0;
+// Activity of apps at the previous sample
+static struct {
+    uint32_t wakeups;
+    uint64_t busy_us;
+} last_apps[CONFIG_HC_AM_MAX_APPS];
+static int64_t last_apps_us = 0;
+
+static const char *state_names[] = { "running", "ready", "blocked", "suspended", "deleted" };
+
+static const char *state_name(uint8_t state)
+{
+    return state < sizeof(state_names) / sizeof(state_names[0]) ? state_names[state] : "invalid";
+}
+
+static const struct stats_task *find_task(const struct stats_sample *sample, uint8_t slot)
+{
+    for (uint8_t i = 0; i < sample->task_count; i++)
+        if (sample->tasks[i].slot == slot)
+            return &sample->tasks[i];
+    return NULL;
+}
+
+// Returns slot of the task, -1 if the table is full
+static int find_slot(const TaskStatus_t *task, const struct stats_sample *sample)
+{
+    for (uint8_t i = 0; i < known_count; i++)
+        if (known_tasks[i].number == task->xTaskNumber)
+            return i;
+    for (uint8_t i = 0; i < known_count; i++) {
+        if (strncmp(known_tasks[i].name, task->pcTaskName, sizeof(known_tasks[i].name)) == 0 &&
+            find_task(sample, i) == NULL) {
+            known_tasks[i].number = task->xTaskNumber;
+            known_tasks[i].run_time = 0;
+            return i;
+        }
+    }
+    if (known_count == CONFIG_HC_STATS_MAX_TASKS) {
+        ESP_LOGW(TAG, "No slot for task %s, raise CONFIG_HC_STATS_MAX_TASKS", task->pcTaskName);
+        return -1;
+    }
+    struct known_task *known = &known_tasks[known_count];
+    snprintf(known->name, sizeof(known->name), "%s", task->pcTaskName);
+    known->number = task->xTaskNumber;
+    known->run_time = 0;
+    return known_count++;
+}
+
+static void collect_apps(struct stats_sample *sample)
+{
+    int64_t now = esp_timer_get_time();
+    uint64_t total_us = (uint64_t) (now - last_apps_us) * portNUM_PROCESSORS;
+    last_apps_us = now;
+    struct am_app_info *apps = get_apps_list();
+    for (uint8_t i = 0; apps != NULL && i < CONFIG_HC_AM_MAX_APPS && apps[i].name != NULL; i++) {
+        uint32_t wakeups;
+        uint64_t busy_us;
+        am_get_app_activity(i, &wakeups, &busy_us);
+        sample->apps[i].wakeups = MIN(wakeups - last_apps[i].wakeups, UINT16_MAX);
+        if (total_us > 0)
+            sample->apps[i].cpu_permille = MIN((busy_us - last_apps[i].busy_us) * 1000 / total_us, 1000);
+        last_apps[i].wakeups = wakeups;
+        last_apps[i].busy_us = busy_us;
+    }
+}
+
+static void collect(struct stats_sample *sample)
+{
+    memset(sample, 0, sizeof(*sample));
+    sample->time_s = esp_timer_get_time() / 1000000;
+#if !CONFIG_IDF_TARGET_LINUX
+    sample->heap_free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    sample->heap_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    sample->heap_largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+#endif
+    collect_apps(sample);
+
+    // Tasks may be created meanwhile, so leave some room
+    UBaseType_t count = uxTaskGetNumberOfTasks() + 2;
+    TaskStatus_t *status = pvPortMalloc(count * sizeof(TaskStatus_t));
+    if (status == NULL) {
+        ESP_LOGE(TAG, "Out of memory!");
+        return;
+    }
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    count = uxTaskGetSystemState(status, count, &total);
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    uint64_t total_delta = (uint64_t) (total - last_total) * portNUM_PROCESSORS;
+    last_total = total;
+#endif
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        int slot = find_slot(&status[i], sample);
+        if (slot < 0)
+            continue;
+        struct stats_task *task = &sample->tasks[sample->task_count++];
+        task->slot = slot;
+        task->state = status[i].eCurrentState;
+        task->stack_free = MIN(status[i].usStackHighWaterMark * sizeof(StackType_t), UINT16_MAX);
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        configRUN_TIME_COUNTER_TYPE run_time = status[i].ulRunTimeCounter;
+        if (total_delta > 0)
+            task->cpu_permille = MIN((uint64_t) (run_time - known_tasks[slot].run_time) * 1000 / total_delta, 1000);
+        known_tasks[slot].run_time = run_time;
+#endif
+    }
+    vPortFree(status);
+}
+
+static void stats_task(void *param)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        xSemaphoreTake(stats_mutex, portMAX_DELAY);
+        collect(&samples[sample_next]);
+        sample_next = (sample_next + 1) % CONFIG_HC_STATS_SAMPLES;
+        sample_count = MIN(sample_count + 1, CONFIG_HC_STATS_SAMPLES);
+        xSemaphoreGive(stats_mutex);
+        xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONFIG_HC_STATS_PERIOD * 1000));
+    }
+}
+
+void stats_start(void)
+{
+    if (samples != NULL) {
+        ESP_LOGE(TAG, "Stats task is already running!");
+        return;
+    }
+    samples = pvPortMalloc(CONFIG_HC_STATS_SAMPLES * sizeof(struct stats_sample));
+    stats_mutex = xSemaphoreCreateMutex();
+    if (samples == NULL || stats_mutex == NULL) {
+        ESP_LOGE(TAG, "Out of memory!");
+        return;
+    }
+    if (xTaskCreate(stats_task, "stats", STATS_STACK_SIZE, NULL, STATS_TASK_PRIORITY, NULL) != pdPASS)
+        ESP_LOGE(TAG, "Failed to start stats task");
+}
+
+struct json_out {
+    stats_write_t write;
+    void *ctx;
+};
+
+static void json_printf(struct json_out *out, const char *fmt, ...)
+{
+    char text[128];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    if (len > 0)
+        out->write(out->ctx, text, MIN(len, sizeof(text) - 1));
+}
+
+static const struct stats_sample *sample_at(uint16_t i)
+{
+    return &samples[(sample_next + CONFIG_HC_STATS_SAMPLES - sample_count + i) % CONFIG_HC_STATS_SAMPLES];
+}
+
+// History is stored by columns, oldest samples first. Tasks missing in a sample have nulls
+static void write_history(struct json_out *out)
+{
+    static const char *heap_keys[] = { "heap_free", "heap_min_free", "heap_largest_block" };
+    json_printf(out, "\"history\":{\"time\":[");
+    for (uint16_t i = 0; i < sample_count; i++)
+        json_printf(out, "%s%lu", i ? "," : "", (unsigned long) sample_at(i)->time_s);
+    for (uint8_t k = 0; k < 3; k++) {
+        json_printf(out, "],\"%s\":[", heap_keys[k]);
+        for (uint16_t i = 0; i < sample_count; i++) {
+            const struct stats_sample *s = sample_at(i);
+            uint32_t value = k == 0 ? s->heap_free : k == 1 ? s->heap_min_free : s->heap_largest;
+            json_printf(out, "%s%lu", i ? "," : "", (unsigned long) value);
+        }
+    }
+    json_printf(out, "],\"tasks\":{");
+    for (uint8_t slot = 0; slot < known_count; slot++) {
+        json_printf(out, "%s\"%s\":{\"cpu\":[", slot ? "," : "", known_tasks[slot].name);
+        for (uint16_t i = 0; i < sample_count; i++) {
+            const struct stats_task *task = find_task(sample_at(i), slot);
+            if (task != NULL)
+                json_printf(out, "%s%u.%u", i ? "," : "", task->cpu_permille / 10, task->cpu_permille % 10);
+            else
+                json_printf(out, "%snull", i ? "," : "");
+        }
+        json_printf(out, "],\"stack_free\":[");
+        for (uint16_t i = 0; i < sample_count; i++) {
+            const struct stats_task *task = find_task(sample_at(i), slot);
+            if (task != NULL)
+                json_printf(out, "%s%u", i ? "," : "", task->stack_free);
+            else
+                json_printf(out, "%snull", i ? "," : "");
+        }
+        json_printf(out, "]}");
+    }
+    json_printf(out, "}}");
+}
+
+// Writes the latest sample, states of apps and the whole history as JSON object
+void stats_write_json(stats_write_t write, void *ctx)
+{
+    struct json_out out = { write, ctx };
+    if (samples == NULL || stats_mutex == NULL) {
+        json_printf(&out, "{\"status\":\"err\",\"msg\":\"not_running\"}");
+        return;
+    }
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    json_printf(&out, "{\"status\":\"ok\",\"period\":%d,\"cores\":%d", CONFIG_HC_STATS_PERIOD, portNUM_PROCESSORS);
+    if (sample_count > 0) {
+        const struct stats_sample *last = sample_at(sample_count - 1);
+        json_printf(&out, ",\"time\":%lu,\"heap\":{\"free\":%lu,\"min_free\":%lu,\"largest_block\":%lu},\"tasks\":[",
+                    (unsigned long) last->time_s, (unsigned long) last->heap_free,
+                    (unsigned long) last->heap_min_free, (unsigned long) last->heap_largest);
+        for (uint8_t i = 0; i < last->task_count; i++) {
+            const struct stats_task *task = &last->tasks[i];
+            json_printf(&out, "%s{\"name\":\"%s\",\"state\":\"%s\",\"cpu\":%u.%u,\"stack_free\":%u}",
+                        i ? "," : "", known_tasks[task->slot].name, state_name(task->state),
+                        task->cpu_permille / 10, task->cpu_permille % 10, task->stack_free);
+        }
+        json_printf(&out, "]");
+    }
+
+    // Apps are started on first switch, suspended when their window is hidden and may hibernate later.
+    // Cooperative ones have no task of their own, they all run in app_loop. CPU share and wakeups
+    // are averaged over the history
+    static const char *app_states[] = { "stopped", "hibernated", "suspended", "running" };
+    json_printf(&out, ",\"apps\":[");
+    struct am_app_info *apps = get_apps_list();
+    for (uint8_t i = 0; apps != NULL && i < CONFIG_HC_AM_MAX_APPS && apps[i].name != NULL; i++) {
+        uint32_t cpu = 0, wakeups = 0;
+        for (uint16_t j = 0; j < sample_count; j++) {
+            cpu += sample_at(j)->apps[i].cpu_permille;
+            wakeups += sample_at(j)->apps[i].wakeups;
+        }
+        if (sample_count > 0) {
+            cpu /= sample_count;
+            wakeups = (uint64_t) wakeups * 60 / (sample_count * CONFIG_HC_STATS_PERIOD);
+        }
+        json_printf(&out, "%s{\"name\":\"%s\",\"state\":\"%s\",\"cooperative\":%s,", i ? "," : "",
+                    apps[i].name, app_states[am_get_app_state(i)], apps[i].ops != NULL ? "true" : "false");
+        json_printf(&out, "\"cpu\":%lu.%lu,\"wakeups_per_min\":%lu}",
+                    (unsigned long) cpu / 10, (unsigned long) cpu % 10, (unsigned long) wakeups);
+    }
+    json_printf(&out, "],");
+    write_history(&out);
+    json_printf(&out, "}");
+    xSemaphoreGive(stats_mutex);
+}
+
+#endif
@@ -0,0 +1,188 @@
+#include <stdint.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "text.h"
+
+#define REPLACEMENT_CHAR    0xfffd
+
+static const char *TAG = "text";
+
+// Decodes one UTF-8 code point and moves str past it, returns 0 at the end of string.
+// Malformed sequences are decoded as U+FFFD
+uint32_t utf8_next(const char **str)
+{
+    const uint8_t *s = (const uint8_t *)*str;
+    if (*s == 0)
+        return 0;
+
+    uint32_t code;
+    uint8_t extra;
+    if (*s < 0x80) {
+        code = *s;
+        extra = 0;
+    } else if ((*s & 0xe0) == 0xc0) {
+        code = *s & 0x1f;
+        extra = 1;
+    } else if ((*s & 0xf0) == 0xe0) {
+        code = *s & 0x0f;
+        extra = 2;
+    } else if ((*s & 0xf8) == 0xf0) {
+        code = *s & 0x07;
+        extra = 3;
+    } else {
+        *str += 1;
+        return REPLACEMENT_CHAR;
+    }
+
+    s++;
+    for (uint8_t i = 0; i < extra; i++, s++) {
+        if ((*s & 0xc0) != 0x80) {
+            *str = (const char *)s;
+            return REPLACEMENT_CHAR;
+        }
+        code = (code << 6) | (*s & 0x3f);
+    }
+    *str = (const char *)s;
+    return code;
+}
+
+// Width of string in pixels, without spacing after the last glyph
+uint16_t text_measure(const struct text_font *font, const char *str)
+{
+    uint16_t width = 0;
+    uint32_t code;
+    while ((code = utf8_next(&str)) != 0)
+        width += font_find_glyph(font, code)->width + font->spacing;
+    return width > 0 ? width - font->spacing : 0;
+}
+
+// Draws UTF-8 string with the top left corner of the first glyph at x, y, clipped by canvas edges.
+// Only glyph pixels are drawn, the background is kept. Returns width of the string
+uint16_t cv_draw_text(struct canvas *cv, const struct text_font *font, const char *str,
+                      int16_t x, int16_t y, crgb color)
+{
+    const uint8_t high_bit = 1 << (font->height - 1);
+    uint8_t row_first = MIN(MAX(-y, 0), font->height);
+    uint8_t row_last = MAX(MIN(cv->height - y, font->height), 0);
+    int16_t start_x = x;
+    int16_t x1 = cv->width;
+    int16_t x2 = -1;
+
+    uint32_t code;
+    while ((code = utf8_next(&str)) != 0) {
+        const struct text_glyph *glyph = font_find_glyph(font, code);
+        for (uint8_t i = 0; i < glyph->width; i++, x++) {
+            if (x < 0 || x >= cv->width)
+                continue;
+            uint8_t col = font->data[glyph->offset + i];
+            for (uint8_t j = row_first; j < row_last; j++)
+                if (col & (high_bit >> j))
+                    cv->buf[(y + j) * cv->width + x] = color;
+            x1 = MIN(x1, x);
+            x2 = x;
+        }
+        x += font->spacing;
+    }
+
+    if (x1 <= x2 && row_first < row_last)
+        cv_mark_dirty(cv, x1, y + row_first, x2, y + row_last - 1);
+    return x > start_x ? x - start_x - font->spacing : 0;
+}
+
+// Returns bits of the next text column and advances the marquee position
+static uint8_t next_column(struct marquee *m)
+{
+    uint8_t bits = 0;
+    if (m->glyph_idx < m->glyph_count) {
+        const struct text_glyph *glyph = m->glyphs[m->glyph_idx];
+        if (m->col < glyph->width)
+            bits = m->font->data[glyph->offset + m->col];
+        if (++m->col >= glyph->width + m->font->spacing) {
+            m->col = 0;
+            m->glyph_idx++;
+        }
+    } else if (++m->col >= m->gap) {
+        m->col = 0;
+        m->glyph_idx = 0;
+    }
+    return bits;
+}
+
+static void draw_column(struct marquee *m, uint8_t x, uint8_t bits)
+{
+    const uint8_t high_bit = 1 << (m->font->height - 1);
+    uint8_t rows = MIN(m->font->height, m->cv->height - m->y);
+    for (uint8_t j = 0; j < rows; j++)
+        m->cv->buf[(m->y + j) * m->cv->width + x] = (bits & (high_bit >> j)) ? m->color : m->bg;
+}
+
+// Starts marquee with str in the area of cv starting at x, y, width wide and as high as the font.
+// The area is clipped by canvas edges, it has to start inside the canvas.
+// Text fitting into the area is drawn once and doesn't scroll
+uint8_t marquee_init(struct marquee *m, struct canvas *cv, const struct text_font *font, const char *str,
+                     uint8_t x, uint8_t y, uint8_t width, crgb color, crgb bg)
+{
+    m->glyphs = NULL;
+    if (x >= cv->width || y >= cv->height || width == 0) {
+        ESP_LOGE(TAG, "[marquee_init] Area is out of canvas!");
+        return 1;
+    }
+    m->cv = cv;
+    m->font = font;
+    m->x = x;
+    m->y = y;
+    m->width = MIN(width, cv->width - x);
+    m->color = color;
+    m->bg = bg;
+    m->gap = MAX(m->width / 2, font->spacing);
+    m->glyph_idx = 0;
+    m->col = 0;
+
+    m->glyph_count = 0;
+    for (const char *s = str; utf8_next(&s) != 0;)
+        m->glyph_count++;
+    m->glyphs = pvPortMalloc(MAX(m->glyph_count, 1) * sizeof(struct text_glyph *));
+    if (m->glyphs == NULL) {
+        ESP_LOGE(TAG, "[marquee_init] Out of memory!");
+        return 1;
+    }
+    for (uint16_t i = 0; i < m->glyph_count; i++)
+        m->glyphs[i] = font_find_glyph(font, utf8_next(&str));
+    m->text_width = 0;
+    for (uint16_t i = 0; i < m->glyph_count; i++)
+        m->text_width += m->glyphs[i]->width + (i > 0 ? font->spacing : 0);
+
+    // Fill the whole area, as if the text was already scrolled into it
+    for (uint8_t i = 0; i < m->width; i++)
+        draw_column(m, x + i, next_column(m));
+    cv_mark_dirty(cv, x, y, x + m->width - 1, MIN(y + font->height, cv->height) - 1);
+    return 0;
+}
+
+bool marquee_scrolls(struct marquee *m)
+{
+    return m->text_width > m->width;
+}
+
+// Scrolls text by one column
+void marquee_step(struct marquee *m)
+{
+    if (!marquee_scrolls(m))
+        return;
+    struct canvas *cv = m->cv;
+    uint8_t rows = MIN(m->font->height, cv->height - m->y);
+    for (uint8_t j = 0; j < rows; j++) {
+        crgb *row = &cv->buf[(m->y + j) * cv->width + m->x];
+        memmove(row, row + 1, (m->width - 1) * sizeof(crgb));
+    }
+    draw_column(m, m->x + m->width - 1, next_column(m));
+    cv_mark_dirty(cv, m->x, m->y, m->x + m->width - 1, m->y + rows - 1);
+}
+
+void marquee_free(struct marquee *m)
+{
+    vPortFree(m->glyphs);
+    m->glyphs = NULL;
+}
@@ -0,0 +1,351 @@
+#!/usr/bin/env python3
+"""Generates main/font_text.c, the proportional text font.
+
+Glyphs are drawn below as rows of '#' and '.', separated by spaces, together with the row
+they start at. The cell is 8 rows high: rows 0-1 hold accents of capitals, capitals and
+ascenders take rows 2-6, x-height is rows 4-6 and row 7 is for descenders.
+Accented letters are composed from the base glyph and an accent.
+
+    python3 tools/gen_font.py > main/font_text.c
+"""
+
+import unicodedata
+
+HEIGHT = 8
+CAP = 2
+X = 4
+
+GLYPHS = {
+    ' ': (CAP, '.. .. .. .. ..'),
+    '!': (CAP, '# # # . #'),
+    '"': (CAP, '#.# #.#'),
+    '#': (CAP, '.#.#. ##### .#.#. ##### .#.#.'),
+    '$': (CAP, '.## ##. .#. .## ##.'),
+    '%': (CAP, '#.# ..# .#. #.. #.#'),
+    '&': (CAP, '.#.. #.#. .#.. #.#. .#.#'),
+    "'": (CAP, '# #'),
+    '(': (CAP, '.# #. #. #. .#'),
+    ')': (CAP, '#. .# .# .# #.'),
+    '*': (CAP + 1, '#.# .#. #.#'),
+    '+': (CAP + 1, '.#. ### .#.'),
+    ',': (CAP + 4, '.# #.'),
+    '-': (CAP + 2, '##'),
+    '.': (CAP + 4, '#'),
+    '/': (CAP, '..# ..# .#. #.. #..'),
+    '0': (CAP, '### #.# #.# #.# ###'),
+    '1': (CAP, '.#. ##. .#. .#. ###'),
+    '2': (CAP, '##. ..# .#. #.. ###'),
+    '3': (CAP, '##. ..# .#. ..# ##.'),
+    '4': (CAP, '#.# #.# ### ..# ..#'),
+    '5': (CAP, '### #.. ##. ..# ##.'),
+    '6': (CAP, '.## #.. ### #.# ###'),
+    '7': (CAP, '### ..# .#. .#. .#.'),
+    '8': (CAP, '### #.# ### #.# ###'),
+    '9': (CAP, '### #.# ### ..# ##.'),
+    ':': (CAP + 1, '# . #'),
+    ';': (CAP + 1, '.# .. .# #.'),
+    '<': (CAP, '..# .#. #.. .#. ..#'),
+    '=': (CAP + 1, '### ... ###'),
+    '>': (CAP, '#.. .#. ..# .#. #..'),
+    '?': (CAP, '##. ..# .#. ... .#.'),
+    '@': (CAP, '.##. #..# #.## #... .##.'),
+    'A': (CAP, '.#. #.# ### #.# #.#'),
+    'B': (CAP, '##. #.# ##. #.# ##.'),
+    'C': (CAP, '.## #.. #.. #.. .##'),
+    'D': (CAP, '##. #.# #.# #.# ##.'),
+    'E': (CAP, '### #.. ##. #.. ###'),
+    'F': (CAP, '### #.. ##. #.. #..'),
+    'G': (CAP, '.## #.. #.# #.# .##'),
+    'H': (CAP, '#.# #.# ### #.# #.#'),
+    'I': (CAP, '### .#. .#. .#. ###'),
+    'J': (CAP, '..# ..# ..# #.# .#.'),
+    'K': (CAP, '#.# #.# ##. #.# #.#'),
+    'L': (CAP, '#.. #.. #.. #.. ###'),
+    'M': (CAP, '#...# ##.## #.#.# #...# #...#'),
+    'N': (CAP, '#..# ##.# #.## #..# #..#'),
+    'O': (CAP, '.#. #.# #.# #.# .#.'),
+    'P': (CAP, '##. #.# ##. #.. #..'),
+    'Q': (CAP, '.#. #.# #.# ##. .##'),
+    'R': (CAP, '##. #.# ##. #.# #.#'),
+    'S': (CAP, '.## #.. .#. ..# ##.'),
+    'T': (CAP, '### .#. .#. .#. .#.'),
+    'U': (CAP, '#.# #.# #.# #.# ###'),
+    'V': (CAP, '#.# #.# #.# #.# .#.'),
+    'W': (CAP, '#...# #...# #.#.# ##.## #...#'),
+    'X': (CAP, '#.# #.# .#. #.# #.#'),
+    'Y': (CAP, '#.# #.# .#. .#. .#.'),
+    'Z': (CAP, '### ..# .#. #.. ###'),
+    '[': (CAP, '## #. #. #. ##'),
+    '\\': (CAP, '#.. #.. .#. ..# ..#'),
+    ']': (CAP, '## .# .# .# ##'),
+    '^': (CAP, '.#. #.#'),
+    '_': (CAP + 5, '###'),
+    '`': (CAP, '#. .#'),
+    'a': (X, '.## #.# .##'),
+    'b': (CAP, '#.. #.. ##. #.# ##.'),
+    'c': (X, '.## #.. .##'),
+    'd': (CAP, '..# ..# .## #.# .##'),
+    'e': (X - 1, '.#. #.# ##. .##'),
+    'f': (CAP, '.# #. ## #. #.'),
+    'g': (X, '.## #.# .## ##.'),
+    'h': (CAP, '#.. #.. ##. #.# #.#'),
+    'i': (CAP, '# . # # #'),
+    'j': (CAP, '.# .. .# .# .# #.'),
+    'k': (CAP, '#.. #.. #.# ##. #.#'),
+    'l': (CAP, '# # # # #'),
+    'm': (X, '####. #.#.# #.#.#'),
+    'n': (X, '##. #.# #.#'),
+    'o': (X, '.#. #.# .#.'),
+    'p': (X, '##. #.# ##. #..'),
+    'q': (X, '.## #.# .## ..#'),
+    'r': (X, '.## #.. #..'),
+    's': (X, '.## .#. ##.'),
+    't': (CAP + 1, '#. ## #. .#'),
+    'u': (X, '#.# #.# .##'),
+    'v': (X, '#.# #.# .#.'),
+    'w': (X, '#...# #.#.# .#.#.'),
+    'x': (X, '#.# .#. #.#'),
+    'y': (X, '#.# #.# .## ##.'),
+    'z': (X, '##. .#. .##'),
+    '{': (CAP, '.## .#. #.. .#. .##'),
+    '|': (CAP, '# # # # #'),
+    '}': (CAP, '##. .#. ..# .#. ##.'),
+    '~': (CAP + 1, '.#.# #.#.'),
+
+    # Latin-1 supplement, letters with accents are composed below
+    ' ': (CAP, '.. .. .. .. ..'),
+    '¡': (CAP, '# . # # #'),
+    '¢': (CAP, '.#. ### #.. ### .#.'),
+    '£': (CAP, '.##. .#.. ###. .#.. ####'),
+    '¤': (CAP + 1, '#.# .#. #.#'),
+    '¥': (CAP, '#.# .#. ### .#. .#.'),
+    '¦': (CAP, '# # . # #'),
+    '§': (CAP, '.## .#. #.# .#. ##.'),
+    '¨': (CAP, '#.#'),
+    '©': (CAP, '.###. #.#.# ##..# #.#.# .###.'),
+    'ª': (CAP, '.## #.# .## ... ###'),
+    '«': (X, '.#.# #.#. .#.#'),
+    '¬': (CAP + 2, '### ..#'),
+    '­': (CAP + 2, '##'),
+    '®': (CAP, '.###. ###.# ##..# ##.## .###.'),
+    '¯': (CAP, '###'),
+    '°': (CAP, '.#. #.# .#.'),
+    '±': (CAP, '.#. ### .#. ... ###'),
+    '²': (CAP - 1, '##. .#. ###'),
+    '³': (CAP - 1, '##. .## ##.'),
+    '´': (CAP, '.# #.'),
+    'µ': (X, '#.# #.# ### #..'),
+    '¶': (CAP, '.### ##.# .#.# ...# ...#'),
+    '·': (CAP + 2, '#'),
+    '¸': (CAP + 5, '##'),
+    '¹': (CAP - 1, '.#. ##. .#.'),
+    'º': (CAP, '.#. #.# .#. ... ###'),
+    '»': (X, '#.#. .#.# #.#.'),
+    '¼': (CAP, '#...# #..#. ..#.. .#.#. #..##'),
+    '½': (CAP, '#...# #..#. ..#.. .#..# #..##'),
+    '¾': (CAP, '##..# .##.. ###.. .#.#. #..##'),
+    '¿': (CAP, '.#. ... .#. #.. .##'),
+    'Æ': (CAP, '.#### #.#.. ####. #.#.. #.###'),
+    'Ð': (CAP, '.##. .#.# #### .#.# .##.'),
+    '×': (CAP + 1, '#.# .#. #.#'),
+    'Ø': (CAP, '.## #.# ### #.# ##.'),
+    'Þ': (CAP, '#.. ##. #.# ##. #..'),
+    'ß': (CAP, '.#. #.# ##. #.# ##.'),
+    'æ': (X, '.#.#. #.### .##.#'),
+    'ð': (CAP, '.#. ### .## #.# .#.'),
+    '÷': (CAP + 1, '.#. ### .#.'),
+    'ø': (X, '.## #.# ##.'),
+    'þ': (CAP, '#.. #.. ##. #.# ##. #..'),
+
+    # Cyrillic
+    'Б': (CAP, '### #.. ##. #.# ##.'),
+    'Г': (CAP, '### #.. #.. #.. #..'),
+    'Д': (CAP, '.### .#.# .#.# #### #..#'),
+    'Ж': (CAP, '#.#.# #.#.# .###. #.#.# #.#.#'),
+    'З': (CAP, '##. ..# .#. ..# ##.'),
+    'И': (CAP, '#..# #..# #.## ##.# #..#'),
+    'Л': (CAP, '.## #.# #.# #.# #.#'),
+    'П': (CAP, '### #.# #.# #.# #.#'),
+    'У': (CAP, '#.# #.# .## ..# ##.'),
+    'Ф': (CAP, '.###. #.#.# #.#.# .###. ..#..'),
+    'Ц': (CAP, '#.#. #.#. #.#. #.#. #### ...#'),
+    'Ч': (CAP, '#.# #.# .## ..# ..#'),
+    'Ш': (CAP, '#.#.# #.#.# #.#.# #.#.# #####'),
+    'Щ': (CAP, '#.#.#. #.#.#. #.#.#. #.#.#. ###### .....#'),
+    'Ъ': (CAP, '##.. .#.. .##. .#.# .##.'),
+    'Ы': (CAP, '#...# #...# ##..# #.#.# ##..#'),
+    'Ь': (CAP, '#.. #.. ##. #.# ##.'),
+    'Э': (CAP, '##. ..# .## ..# ##.'),
+    'Ю': (CAP, '#..#. #.#.# ###.# #.#.# #..#.'),
+    'Я': (CAP, '.## #.# .## #.# #.#'),
+    'Є': (CAP, '.## #.. ##. #.. .##'),
+    'Џ': (CAP, '#.# #.# #.# #.# ### .#.'),
+    'б': (CAP, '.## #.. ### #.# ###'),
+    'в': (X, '##. ### ##.'),
+    'г': (X, '### #.. #..'),
+    'д': (X, '.## .## ### #.#'),
+    'ж': (X, '#.#.# .###. #.#.#'),
+    'з': (X, '##. .## ##.'),
+    'и': (X, '#..# #.## ##.#'),
+    'к': (X, '#.# ##. #.#'),
+    'л': (X, '.## #.# #.#'),
+    'м': (X, '#...# ##.## #.#.#'),
+    'н': (X, '#.# ### #.#'),
+    'п': (X, '### #.# #.#'),
+    'т': (X, '### .#. .#.'),
+    'ф': (X - 1, '..#.. .###. #.#.# .###. ..#..'),
+    'ц': (X, '#.#. #.#. #### ...#'),
+    'ч': (X, '#.# .## ..#'),
+    'ш': (X, '#.#.# #.#.# #####'),
+    'щ': (X, '#.#.#. #.#.#. ###### .....#'),
+    'ъ': (X, '##.. .##. .##.'),
+    'ы': (X, '#..# ##.# ##.#'),
+    'ь': (X, '#.. ##. ##.'),
+    'э': (X, '##. ..# ##.'),
+    'ю': (X, '#.### ###.# #.###'),
+    'я': (X, '.## .## #.#'),
+    'є': (X, '.## ##. .##'),
+    'џ': (X, '#.# #.# ### .#.'),
+}
+
+# Cyrillic letters looking exactly like Latin ones
+SAME_AS = {
+    'А': 'A', 'В': 'B', 'Е': 'E', 'К': 'K', 'М': 'M', 'Н': 'H', 'О': 'O', 'Р': 'P', 'С': 'C',
+    'Т': 'T', 'Х': 'X', 'а': 'a', 'е': 'e', 'о': 'o', 'р': 'p', 'с': 'c', 'у': 'y', 'х': 'x',
+    'Ѕ': 'S', 'І': 'I', 'Ј': 'J', 'ѕ': 's', 'і': 'i', 'ј': 'j',
+}
+
+# Two rows put right above the base glyph
+ACCENTS = {
+    'GRAVE': '#.. .#.',
+    'ACUTE': '..# .#.',
+    'CIRCUMFLEX': '.#. #.#',
+    'TILDE': '.## ##.',
+    'DIAERESIS': '... #.#',
+    'RING ABOVE': '### #.#',
+    'BREVE': '#.# .#.',
+}
+
+RANGES = [(0x20, 0x7e), (0xa0, 0xff), (0x401, 0x45f)]
+FALLBACK = '?'
+
+
+def parse(top, art):
+    rows = art.split(' ')
+    return top, [list(r) for r in rows]
+
+
+def compose(ch):
+    """Builds accented letter (and dotless Cyrillic variants) from decomposition"""
+    decomposed = unicodedata.normalize('NFD', ch)
+    if len(decomposed) == 2:
+        base, mark = decomposed
+        accent = unicodedata.name(mark).replace('COMBINING ', '').replace(' ACCENT', '')
+        if accent == 'CEDILLA':
+            top, rows = glyph(base)
+            rows = rows + [['.'] * (len(rows[0]) - 2) + ['#', '.']]
+            return top, rows
+        if base in 'ij' and accent != 'BREVE':
+            base = 'ı' if base == 'i' else 'ȷ'
+        if accent in ACCENTS:
+            top, rows = glyph(base)
+            width = len(rows[0])
+            mark_rows = [list(r) for r in ACCENTS[accent].split(' ')]
+            pad = (width - 3) // 2
+            fitted = []
+            for r in mark_rows:
+                if width >= 3:
+                    fitted.append(['.'] * pad + r + ['.'] * (width - 3 - pad))
+                else:
+                    fitted.append([r[1]] + ['.'] * (width - 1))
+            return top - 2, fitted + rows
+    return None
+
+
+DOTLESS = {'ı': (X, '# # #'), 'ȷ': (X, '.# .# .# #.')}
+
+
+def glyph(ch):
+    if ch in GLYPHS:
+        return parse(*GLYPHS[ch])
+    if ch in SAME_AS:
+        return glyph(SAME_AS[ch])
+    if ch in DOTLESS:
+        return parse(*DOTLESS[ch])
+    return compose(ch)
+
+
+def columns(top, rows):
+    width = len(rows[0])
+    cols = []
+    for x in range(width):
+        bits = 0
+        for y, row in enumerate(rows):
+            if row[x] == '#':
+                bits |= 1 << (HEIGHT - 1 - (top + y))
+        cols.append(bits)
+    return cols
+
+
+def main():
+    data = []
+    glyphs = []
+    ranges = []
+    index = {}
+    for first, last in RANGES:
+        # Skip code points without glyphs at the range edges
+        run = None
+        for code in range(first, last + 1):
+            g = glyph(chr(code))
+            if g is None:
+                if run is not None:
+                    ranges.append(run)
+                    run = None
+                continue
+            top, rows = g
+            assert top >= 0 and top + len(rows) <= HEIGHT, chr(code)
+            assert all(len(r) == len(rows[0]) for r in rows), chr(code)
+            cols = columns(top, rows)
+            index[chr(code)] = len(glyphs)
+            glyphs.append((len(data), len(cols), chr(code)))
+            data.extend(cols)
+            if run is None:
+                run = [code, 0, len(glyphs) - 1]
+            run[1] += 1
+        if run is not None:
+            ranges.append(run)
+
+    print('/* Generated by tools/gen_font.py, do not edit */')
+    print()
+    print('#include "fonts.h"')
+    print()
+    print('static const uint8_t text_font_data[] = {')
+    for offset, width, ch in glyphs:
+        cols = ', '.join(f'0x{c:02x}' for c in data[offset:offset + width])
+        name = unicodedata.name(ch, f'U+{ord(ch):04X}')
+        print(f'    {cols},{" " * max(1, 40 - len(cols))}// {name}')
+    print('};')
+    print()
+    print('static const struct text_glyph text_font_glyphs[] = {')
+    for offset, width, ch in glyphs:
+        print(f'    {{ {offset}, {width} }},')
+    print('};')
+    print()
+    print('static const struct text_font_range text_font_ranges[] = {')
+    for first, count, g in ranges:
+        print(f'    {{ 0x{first:04x}, {count}, {g} }},')
+    print('};')
+    print()
+    print('const struct text_font text_font = {')
+    print(f'    .height = {HEIGHT},')
+    print('    .spacing = 1,')
+    print(f'    .fallback = {index[FALLBACK]},')
+    print(f'    .range_count = {len(ranges)},')
+    print('    .ranges = text_font_ranges,')
+    print('    .glyphs = text_font_glyphs,')
+    print('    .data = text_font_data')
+    print('};')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Measures input latency of a running build with the host input (see "Host build" in README):
+injects commands into its input port and reads the traced latency from /metrics. Exits with
+an error if the 99th percentile of the whole path exceeds the limit:
+
+    python3 tools/input_latency.py --command click --count 20 --max-p99 50
+
+The host build isn't verified yet, so this hasn't been run against firmware: it isn't usable
+as a regression gate until it has, and the limits above are placeholders, not measurements.
+
+Latency is traced from the moment the command is read to the first frame requested by
+its receiver, so it covers event dispatch, the app and the render task. For `left` and
+`right` the time from the switch to the first frame showing the new app is printed too.
+"""
+
+import argparse
+import re
+import socket
+import sys
+import time
+import urllib.request
+
+SERIES = re.compile(r'^(\w+)(?:\{([^}]*)\})? (\S+)$')
+
+
+def read_metrics(host, port):
+    with urllib.request.urlopen(f'http://{host}:{port}/metrics', timeout=5) as resp:
+        text = resp.read().decode()
+    metrics = {}
+    for line in text.splitlines():
+        match = SERIES.match(line)
+        if match:
+            name, labels, value = match.groups()
+            metrics[(name, labels or '')] = float(value)
+    return metrics
+
+
+def send_commands(host, port, commands, interval):
+    with socket.create_connection((host, port), timeout=5) as sock:
+        for command in commands:
+            sock.sendall(command.encode() + b'\n')
+            time.sleep(interval)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Measures input latency of a host build')
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--input-port', type=int, default=7001)
+    parser.add_argument('--http-port', type=int, default=8080)
+    parser.add_argument('--command', action='append', choices=['click', 'left', 'right'],
+                        help='command to inject, may be repeated (default: click)')
+    parser.add_argument('--count', type=int, default=10, help='how many times to send the commands')
+    parser.add_argument('--interval', type=float, default=0.5, help='delay between commands in seconds')
+    parser.add_argument('--max-p99', type=float, help='fail if p99 of the total latency exceeds this (ms)')
+    parser.add_argument('--max-switch-p99', type=float,
+                        help='fail if p99 of the switch to the first frame of the new app exceeds this (ms)')
+    args = parser.parse_args()
+
+    before = read_metrics(args.host, args.http_port)
+    send_commands(args.host, args.input_port, (args.command or ['click']) * args.count, args.interval)
+    time.sleep(args.interval)
+    after = read_metrics(args.host, args.http_port)
+
+    def delta(name, labels=''):
+        return after.get((name, labels), 0) - before.get((name, labels), 0)
+
+    def p99(stage, metric='hc_input_latency_us'):
+        """Upper bound of the bucket with the 99th percentile of this run, None without events"""
+        count = delta(f'{metric}_count', f'stage="{stage}"')
+        if count == 0:
+            return None
+        buckets = sorted((float(labels.split('le="')[1].rstrip('"')), labels) for name, labels in after
+                         if name == f'{metric}_bucket' and f'stage="{stage}",' in labels)
+        for bound, labels in buckets:
+            if delta(f'{metric}_bucket', labels) >= count * 0.99:
+                return bound
+        return None
+
+    print(f'events {delta("hc_input_events_total"):.0f}, traced {delta("hc_input_traced_total"):.0f}, '
+          f'lost {delta("hc_input_lost_total"):.0f}')
+    for stage in ('queue', 'recognize', 'app', 'render', 'total'):
+        count = delta('hc_input_latency_us_count', f'stage="{stage}"')
+        if count:
+            avg = delta('hc_input_latency_us_sum', f'stage="{stage}"') / count
+            print(f'{stage:10} avg {avg / 1000:7.2f} ms, p99 <= {p99(stage) / 1000:7.2f} ms')
+    count = delta('hc_frame_stage_us_count', 'stage="switch"')
+    if count:
+        avg = delta('hc_frame_stage_us_sum', 'stage="switch"') / count
+        print(f'{"switch":10} avg {avg / 1000:7.2f} ms, p99 <= {p99("switch", "hc_frame_stage_us") / 1000:7.2f} ms, '
+              f'timeouts {delta("hc_switch_timeouts_total"):.0f}')
+
+    switch = p99('switch', 'hc_frame_stage_us')
+    if args.max_switch_p99 is not None:
+        if switch is None:
+            sys.exit('No app switch was measured, send left or right')
+        if switch / 1000 > args.max_switch_p99:
+            sys.exit(f'p99 of switch latency {switch / 1000:.2f} ms exceeds {args.max_switch_p99} ms')
+
+    total = p99('total')
+    if total is None:
+        sys.exit('No input was traced, is CONFIG_HC_METRICS enabled?')
+    if args.max_p99 is not None and total / 1000 > args.max_p99:
+        sys.exit(f'p99 of input latency {total / 1000:.2f} ms exceeds {args.max_p99} ms')
+
+
+if __name__ == '__main__':
+    main()
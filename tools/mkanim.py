@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""Makes animated .hca image from a directory of frames (.qoi, or .png if Pillow is installed).
+
+Frames share one palette like .hci images. The first frame is stored whole, every next one
+only as spans of pixels changed since the previous frame, unless the whole frame is smaller.
+The firmware keeps a single decoded frame and applies them one by one. Layout, all numbers
+are little-endian:
+
+    header      "HCA" and version byte 1, u8 width, u8 height, u8 bits per index (1, 2, 4 or 8),
+                u8 palette size - 1, u16 frame count, u16 reserved
+    palette     RGBA per entry, alpha is not premultiplied. Transparent pixels share one entry
+    frames      u16 delay in ms, u8 type (0 - keyframe, 1 - delta), u8 reserved, u16 data size, data
+    keyframe    rows of packed indices, each row starts on a byte boundary, first pixel in the high bits
+    delta       spans: u8 y, u8 x, u8 length and length packed indices
+
+Frames are taken in the order of file names:
+
+    python3 tools/mkanim.py rain_frames fatfs_image/weather/rain.hca --delay 120
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+from mkindexed import bits_for_colors, pack_row
+from qoi import qoi_decode
+
+MAGIC = b'HCA\x01'
+HEADER = struct.Struct('<4sBBBBHH')
+FRAME = struct.Struct('<HBBH')
+SPAN = struct.Struct('<BBB')
+
+FRAME_KEY = 0
+FRAME_DELTA = 1
+
+
+def load_frame(path):
+    with open(path, 'rb') as fd:
+        data = fd.read()
+    if path.endswith('.qoi'):
+        return qoi_decode(data)
+    try:
+        from PIL import Image
+    except ImportError:
+        sys.exit(f'{path}: PNG frames need Pillow (pip install pillow)')
+    img = Image.open(path).convert('RGBA')
+    return img.width, img.height, list(img.getdata())
+
+
+def build_palette(frames):
+    palette = []
+    lookup = {}
+    for pixels in frames:
+        for px in pixels:
+            if px[3] == 0:
+                px = (0, 0, 0, 0)
+            if px not in lookup:
+                lookup[px] = len(palette)
+                palette.append(px)
+    return palette, lookup
+
+
+def delta_spans(prev, cur, width, height, bpp):
+    """Changed pixels of every row as (y, x, length), close runs are merged
+    when the gap costs less than a span header"""
+    spans = []
+    max_gap = max(1, 8 * SPAN.size // bpp)
+    for y in range(height):
+        row = y * width
+        x = 0
+        while x < width:
+            if prev[row + x] == cur[row + x]:
+                x += 1
+                continue
+            start = end = x
+            x += 1
+            while x < width and x - end <= max_gap:
+                if prev[row + x] != cur[row + x]:
+                    end = x
+                x += 1
+            x = end + 1
+            spans.append((y, start, end - start + 1))
+    return spans
+
+
+def encode_frames(width, height, frames, lookup, bpp, delay):
+    out = bytearray()
+    prev = None
+    for pixels in frames:
+        cur = [lookup[px if px[3] else (0, 0, 0, 0)] for px in pixels]
+        key = b''.join(pack_row(cur[y * width:(y + 1) * width], bpp) for y in range(height))
+        frame_type, data = FRAME_KEY, key
+        if prev is not None:
+            delta = b''.join(SPAN.pack(y, x, n) + pack_row(cur[y * width + x:y * width + x + n], bpp)
+                             for y, x, n in delta_spans(prev, cur, width, height, bpp))
+            if len(delta) < len(key):
+                frame_type, data = FRAME_DELTA, delta
+        out += FRAME.pack(delay, frame_type, 0, len(data)) + data
+        prev = cur
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Makes animated .hca image from frames')
+    parser.add_argument('frames', help='directory with .qoi or .png frames')
+    parser.add_argument('output')
+    parser.add_argument('--delay', type=int, default=100, help='delay of every frame in ms')
+    args = parser.parse_args()
+
+    names = sorted(f for f in os.listdir(args.frames) if f.endswith(('.qoi', '.png')))
+    if not names:
+        sys.exit(f'No frames in {args.frames}')
+    frames = []
+    for name in names:
+        width, height, pixels = load_frame(os.path.join(args.frames, name))
+        if frames and (width, height) != size:
+            sys.exit(f'{name} is {width}x{height}, other frames are {size[0]}x{size[1]}')
+        size = (width, height)
+        frames.append(pixels)
+    width, height = size
+    if width > 255 or height > 255:
+        sys.exit('Frames are too large')
+
+    palette, lookup = build_palette(frames)
+    bpp = bits_for_colors(len(palette))
+    if bpp is None:
+        sys.exit(f'Frames have {len(palette)} colors, at most 256 are supported')
+    data = bytearray(HEADER.pack(MAGIC, width, height, bpp, len(palette) - 1, len(frames), 0))
+    for px in palette:
+        data += bytes(px)
+    data += encode_frames(width, height, frames, lookup, bpp, args.delay)
+
+    with open(args.output, 'wb') as fd:
+        fd.write(data)
+    print(f'{len(frames)} frames {width}x{height}, {len(palette)} colors: '
+          f'{len(frames) * width * height * 4} -> {len(data)} bytes')
+
+
+if __name__ == '__main__':
+    main()
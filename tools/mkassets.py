@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""Packs images from a directory into the asset partition image.
+
+Images are decoded and converted into the blit-ready form of struct image_desc
+(premultiplied crgb pixels, inverted alpha, row bounds), so the firmware uses them
+straight from mapped flash. Images with few colors are stored palette-indexed when
+that is smaller, then pixels and alpha hold the palette. Animated .hca images (tools/mkanim.py)
+are stored as is. Layout, all numbers are little-endian:
+
+    header      magic "HCAP", u16 version, u16 entry count, u16 hash table size, u16 reserved
+    hash table  u16 per slot: entry index + 1, 0 for empty slots (FNV-1a of name, linear probing)
+    entries     u32 name offset, u32 name hash, u8 width, u8 height,
+                u16 flags (bits 0-3: bits per index, 0 for direct color; bit 4: raw file;
+                bits 8-15: palette size - 1),
+                u32 pixels offset, u32 alpha offset (0 if opaque), u32 rows offset,
+                u32 indices offset (0 for direct color)
+                raw files keep their offset in pixels and size in alpha, the rest is 0
+    data        names (NUL-terminated) and image arrays, 4-byte aligned
+
+Names are paths relative to the source directory, e.g. "weather/sunny.qoi".
+
+    python3 tools/mkassets.py fatfs_image assets.bin
+"""
+
+import os
+import struct
+import sys
+
+from mkindexed import index_image
+from qoi import qoi_decode
+
+MAGIC = b'HCAP'
+VERSION = 2
+HEADER = struct.Struct('<4sHHHH')
+ENTRY = struct.Struct('<IIBBHIIII')
+FLAG_RAW = 1 << 4
+RAW_EXTENSIONS = ('.hca',)
+
+
+def fnv1a(data):
+    h = 0x811c9dc5
+    for b in data:
+        h = ((h ^ b) * 0x01000193) & 0xffffffff
+    return h
+
+
+def mul_div255(x, y):
+    # Same rounding as mul_div255() in image_utils.h
+    v = x * y + 128
+    return (v + (v >> 8)) >> 8
+
+
+def premultiply(r, g, b, a):
+    return bytes((mul_div255(r, a), mul_div255(g, a), mul_div255(b, a)))
+
+
+def convert(width, height, pixels):
+    """Same conversion as image_from_rgba(), returns (bpp, colors, alpha, rows, indices)"""
+    colors = bytearray()
+    alpha = bytearray()
+    rows = bytearray()
+    opaque = True
+    for y in range(height):
+        x1, x2 = 1, 0
+        for x in range(width):
+            r, g, b, a = pixels[y * width + x]
+            colors += premultiply(r, g, b, a)
+            alpha.append(255 - a)
+            if a == 0:
+                continue
+            if x1 > x2:
+                x1 = x
+            x2 = x
+        row_opaque = all(alpha[y * width + x] == 0 for x in range(x1, x2 + 1))
+        rows += bytes((x1, x2, row_opaque))
+        if x1 != 0 or x2 != width - 1 or not row_opaque:
+            opaque = False
+    direct = (0, colors, None if opaque else alpha, rows, None)
+
+    indexed = index_image(width, height, pixels)
+    if indexed is None:
+        return direct
+    bpp, palette, indices = indexed
+    pal_colors = b''.join(premultiply(*px) for px in palette)
+    pal_alpha = None if opaque else bytes(255 - px[3] for px in palette)
+    if len(pal_colors) + len(pal_alpha or b'') + len(indices) >= len(colors) + len(direct[2] or b''):
+        return direct
+    return bpp, pal_colors, pal_alpha, rows, indices
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(f'usage: {sys.argv[0]} <source dir> <output>')
+    src, out = sys.argv[1:]
+
+    images = []
+    for root, _, files in os.walk(src):
+        for f in sorted(files):
+            path = os.path.join(root, f)
+            name = os.path.relpath(path, src).replace(os.sep, '/')
+            if f.endswith(RAW_EXTENSIONS):
+                with open(path, 'rb') as fd:
+                    images.append((name, 0, 0, None, fd.read(), None, None, None))
+                continue
+            if not f.endswith('.qoi'):
+                continue
+            with open(path, 'rb') as fd:
+                width, height, pixels = qoi_decode(fd.read())
+            if width > 255 or height > 255:
+                sys.exit(f'{name} is too large')
+            images.append((name, width, height, *convert(width, height, pixels)))
+    images.sort()
+
+    slots = 1
+    while slots < len(images) * 2:
+        slots *= 2
+    table = [0] * slots
+
+    data_start = HEADER.size + slots * 2 + len(images) * ENTRY.size
+    data = bytearray()
+
+    def put(blob):
+        while (data_start + len(data)) % 4:
+            data.append(0)
+        offset = data_start + len(data)
+        data.extend(blob)
+        return offset
+
+    entries = bytearray()
+    for i, (name, width, height, bpp, colors, alpha, rows, indices) in enumerate(images):
+        h = fnv1a(name.encode())
+        slot = h & (slots - 1)
+        while table[slot]:
+            slot = (slot + 1) & (slots - 1)
+        table[slot] = i + 1
+        name_off = put(name.encode() + b'\0')
+        if bpp is None:
+            entries += ENTRY.pack(name_off, h, 0, 0, FLAG_RAW, put(colors), len(colors), 0, 0)
+            continue
+        pixels_off = put(colors)
+        alpha_off = put(alpha) if alpha is not None else 0
+        rows_off = put(rows)
+        indices_off = put(indices) if indices is not None else 0
+        flags = bpp | (len(colors) // 3 - 1) << 8 if bpp else 0
+        entries += ENTRY.pack(name_off, h, width, height, flags, pixels_off, alpha_off, rows_off, indices_off)
+
+    with open(out, 'wb') as fd:
+        fd.write(HEADER.pack(MAGIC, VERSION, len(images), slots, 0))
+        fd.write(struct.pack(f'<{slots}H', *table))
+        fd.write(entries)
+        fd.write(data)
+
+
+if __name__ == '__main__':
+    main()
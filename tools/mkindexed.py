@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Converts images to the palette-indexed .hci format.
+
+Icons use a handful of colors, so storing a palette index per pixel takes 4-8 times
+less space than RGBA. Layout:
+
+    magic       "HCI" and version byte 1
+    header      u8 width, u8 height, u8 bits per pixel (1, 2, 4 or 8), u8 palette size - 1
+    palette     RGBA per entry, alpha is not premultiplied. Transparent pixels share one entry
+    indices     a row after row, each row starts on a byte boundary, first pixel in the high bits
+
+Converts a single file, or every .qoi in a directory tree (written next to the sources):
+
+    python3 tools/mkindexed.py fatfs_image
+    python3 tools/mkindexed.py fatfs_image/weather/sunny.qoi sunny.hci
+"""
+
+import os
+import struct
+import sys
+
+from qoi import qoi_decode
+
+MAGIC = b'HCI\x01'
+HEADER = struct.Struct('<4sBBBB')
+
+
+def bits_for_colors(count):
+    for bpp in (1, 2, 4, 8):
+        if count <= 1 << bpp:
+            return bpp
+    return None
+
+
+def index_image(width, height, pixels):
+    """Returns (bpp, palette, packed indices) or None if there are more than 256 colors"""
+    palette = []
+    lookup = {}
+    indices = []
+    for px in pixels:
+        if px[3] == 0:
+            px = (0, 0, 0, 0)
+        idx = lookup.get(px)
+        if idx is None:
+            if len(palette) == 256:
+                return None
+            idx = lookup[px] = len(palette)
+            palette.append(px)
+        indices.append(idx)
+
+    bpp = bits_for_colors(len(palette))
+    packed = b''.join(pack_row(indices[y * width:(y + 1) * width], bpp) for y in range(height))
+    return bpp, palette, packed
+
+
+def pack_row(indices, bpp):
+    """Packs indices starting on a byte boundary, first one in the high bits"""
+    packed = bytearray()
+    acc, nbits = 0, 0
+    for idx in indices:
+        acc = acc << bpp | idx
+        nbits += bpp
+        if nbits == 8:
+            packed.append(acc)
+            acc, nbits = 0, 0
+    if nbits:
+        packed.append(acc << (8 - nbits))
+    return bytes(packed)
+
+
+def encode(width, height, pixels):
+    indexed = index_image(width, height, pixels)
+    if indexed is None:
+        return None
+    bpp, palette, packed = indexed
+    out = bytearray(HEADER.pack(MAGIC, width, height, bpp, len(palette) - 1))
+    for px in palette:
+        out += bytes(px)
+    return bytes(out + packed)
+
+
+def convert(src, dst):
+    with open(src, 'rb') as fd:
+        width, height, pixels = qoi_decode(fd.read())
+    if width > 255 or height > 255:
+        sys.exit(f'{src} is too large')
+    data = encode(width, height, pixels)
+    if data is None:
+        sys.exit(f'{src} has more than 256 colors')
+    with open(dst, 'wb') as fd:
+        fd.write(data)
+    print(f'{src}: {width}x{height}, {width * height * 4} -> {len(data)} bytes')
+
+
+def main():
+    if len(sys.argv) == 3:
+        convert(sys.argv[1], sys.argv[2])
+    elif len(sys.argv) == 2 and os.path.isdir(sys.argv[1]):
+        for root, _, files in os.walk(sys.argv[1]):
+            for f in sorted(files):
+                if f.endswith('.qoi'):
+                    src = os.path.join(root, f)
+                    convert(src, src[:-4] + '.hci')
+    else:
+        sys.exit(f'usage: {sys.argv[0]} <source dir> | <source> <output>')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,45 @@
+"""Minimal QOI decoder for the image tools"""
+
+import struct
+
+
+def qoi_decode(data):
+    if data[:4] != b'qoif':
+        raise ValueError('not a QOI file')
+    width, height, channels, _ = struct.unpack('>IIBB', data[4:14])
+    pixels = []
+    index = [(0, 0, 0, 0)] * 64
+    r, g, b, a = 0, 0, 0, 255
+    p = 14
+    run = 0
+    end = len(data) - 8
+    for _ in range(width * height):
+        if run > 0:
+            run -= 1
+        elif p < end:
+            b1 = data[p]
+            p += 1
+            if b1 == 0xfe:
+                r, g, b = data[p:p + 3]
+                p += 3
+            elif b1 == 0xff:
+                r, g, b, a = data[p:p + 4]
+                p += 4
+            elif b1 >> 6 == 0:
+                r, g, b, a = index[b1]
+            elif b1 >> 6 == 1:
+                r = (r + ((b1 >> 4) & 3) - 2) & 0xff
+                g = (g + ((b1 >> 2) & 3) - 2) & 0xff
+                b = (b + (b1 & 3) - 2) & 0xff
+            elif b1 >> 6 == 2:
+                b2 = data[p]
+                p += 1
+                vg = (b1 & 0x3f) - 32
+                r = (r + vg - 8 + ((b2 >> 4) & 0x0f)) & 0xff
+                g = (g + vg) & 0xff
+                b = (b + vg - 8 + (b2 & 0x0f)) & 0xff
+            else:
+                run = b1 & 0x3f
+            index[(r * 3 + g * 5 + b * 7 + a * 11) % 64] = (r, g, b, a)
+        pixels.append((r, g, b, a))
+    return width, height, pixels